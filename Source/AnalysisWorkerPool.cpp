@@ -0,0 +1,301 @@
+/*
+  ==============================================================================
+
+    AnalysisWorkerPool.cpp
+
+  ==============================================================================
+*/
+
+#include "AnalysisWorkerPool.h"
+
+//==============================================================================
+class AnalysisWorkerPool::ServiceJob  : public juce::ThreadPoolJob
+{
+public:
+    explicit ServiceJob (AnalysisWorkerPool& o)
+        : juce::ThreadPoolJob ("Pocket analysis"), owner (o) {}
+
+    JobStatus runJob() override
+    {
+        // Keep draining while there's work, then sleep until notified. A wake-up
+        // that arrives while draining leaves the event set, so none is missed.
+        if (owner.drainAllClients() == 0)
+            owner.waitForWork (*this);
+
+        return shouldExit() ? jobHasFinished : jobNeedsRunningAgain;
+    }
+
+private:
+    AnalysisWorkerPool& owner;
+};
+
+//==============================================================================
+AnalysisWorkerPool::AnalysisWorkerPool() = default;
+
+AnalysisWorkerPool::~AnalysisWorkerPool()
+{
+    std::unique_ptr<juce::ThreadPool> poolToDelete;
+
+    {
+        const juce::ScopedLock sl (poolLock);
+        std::swap (poolToDelete, pool);
+    }
+
+    if (poolToDelete != nullptr)
+    {
+        // The service job only checks for exit when it wakes
+        serviceJob->signalJobShouldExit();
+        workAvailable.signal();
+        poolToDelete->removeAllJobs (true, 2000);
+    }
+}
+
+void AnalysisWorkerPool::ensurePoolExists()
+{
+    const juce::ScopedLock sl (poolLock);
+
+    if (pool != nullptr)
+        return;
+
+    // Keep at least one core free for the host's audio threads
+    const auto numThreads = juce::jlimit (1, 4, juce::SystemStats::getNumCpus() / 4);
+
+    pool = std::make_unique<juce::ThreadPool> (juce::ThreadPoolOptions{}
+                                                   .withThreadName ("Pocket analysis")
+                                                   .withNumberOfThreads (numThreads)
+                                                   .withDesiredThreadPriority (juce::Thread::Priority::low));
+    serviceJob = new ServiceJob (*this);
+    pool->addJob (serviceJob, true);
+}
+
+//==============================================================================
+void AnalysisWorkerPool::addClient (Client& client)
+{
+    {
+        const juce::ScopedLock sl (clientLock);
+        clients.addIfNotAlreadyThere (&client);
+    }
+
+    ensurePoolExists();
+}
+
+void AnalysisWorkerPool::removeClient (Client& client)
+{
+    {
+        const juce::ScopedLock sl (clientLock);
+        clients.removeFirstMatchingValue (&client);
+    }
+
+    // Once it's off the list it won't be picked again, but a pass may be draining it now
+    while (drainingClient.load() == &client)
+        clientDrained.wait (10);
+}
+
+void AnalysisWorkerPool::wakeUp()
+{
+    workPending.store (false, std::memory_order_relaxed);
+    workAvailable.signal();
+}
+
+void AnalysisWorkerPool::notifyAfter (int delayMs) noexcept
+{
+    // Zero means none is due, so a deadline that lands on it is nudged along
+    const auto dueMs = juce::jmax ((juce::uint32) 1, juce::Time::getMillisecondCounter() + (juce::uint32) juce::jmax (0, delayMs));
+    auto current = passDueMs.load (std::memory_order_relaxed);
+
+    // Keep whichever is due first (the counter wraps, so compare differences)
+    while ((current == 0 || (juce::int32) (dueMs - current) < 0)
+            && ! passDueMs.compare_exchange_weak (current, dueMs, std::memory_order_relaxed))
+    {
+    }
+}
+
+void AnalysisWorkerPool::waitForWork (const juce::ThreadPoolJob& job)
+{
+    // Polled here rather than by a message thread timer, so analysis carries on
+    // while the message thread is busy or blocked
+    while (! job.shouldExit())
+    {
+        if (workAvailable.wait (1000 / notifyCheckHz))
+            return;
+
+        if (workPending.exchange (false, std::memory_order_acquire))
+            return;
+
+        auto dueMs = passDueMs.load (std::memory_order_relaxed);
+
+        if (dueMs != 0 && (juce::int32) (juce::Time::getMillisecondCounter() - dueMs) >= 0
+             && passDueMs.compare_exchange_strong (dueMs, 0, std::memory_order_relaxed))
+            return;
+    }
+}
+
+int AnalysisWorkerPool::drainAllClients()
+{
+    juce::Array<Client*> toDrain;
+
+    {
+        const juce::ScopedLock sl (clientLock);
+        const auto numClients = clients.size();
+
+        if (numClients == 0)
+            return 0;
+
+        nextClient %= numClients;
+
+        for (int i = 0; i < numClients; ++i)
+            toDrain.add (clients.getUnchecked ((nextClient + i) % numClients));
+
+        nextClient = (nextClient + 1) % numClients;
+    }
+
+    int numHandled = 0;
+
+    for (auto* client : toDrain)
+    {
+        {
+            // Claimed under the lock, so removeClient() either sees the claim or stops it
+            const juce::ScopedLock sl (clientLock);
+
+            if (! clients.contains (client))
+                continue;
+
+            drainingClient = client;
+        }
+
+        numHandled += client->drainPending (drainBudget);
+        drainingClient = nullptr;
+        clientDrained.signal();
+    }
+
+    return numHandled;
+}
+
+//==============================================================================
+void AnalysisWorkerPool::addJob (std::function<void()> job)
+{
+    ensurePoolExists();
+
+    {
+        const juce::ScopedLock sl (poolLock);
+        pool->addJob (std::move (job));
+    }
+
+    // With a single thread, the job only runs once the sleeping service job lets go of it
+    workAvailable.signal();
+}
+
+int AnalysisWorkerPool::getNumThreads() const
+{
+    const juce::ScopedLock sl (poolLock);
+    return pool != nullptr ? pool->getNumThreads() : 0;
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class AnalysisWorkerPoolTests  : public juce::UnitTest
+{
+public:
+    AnalysisWorkerPoolTests()  : juce::UnitTest ("AnalysisWorkerPool", "Pocket") {}
+
+    void runTest() override
+    {
+        // Stands in for a plugin instance: counts what it's asked to drain
+        struct Instance  : public AnalysisWorkerPool::Client
+        {
+            int drainPending (int maxEvents) override
+            {
+                ++numCalls;
+                const auto numDrained = juce::jmin (maxEvents, pending.load());
+                pending -= numDrained;
+                return numDrained;
+            }
+
+            std::atomic<int> pending { 0 }, numCalls { 0 };
+        };
+
+        constexpr int numInstances = 150, eventsPerInstance = 2000;
+
+        AnalysisWorkerPool pool;
+        std::vector<std::unique_ptr<Instance>> instances;
+
+        for (int i = 0; i < numInstances; ++i)
+        {
+            instances.push_back (std::make_unique<Instance>());
+            pool.addClient (*instances.back());
+        }
+
+        const auto totalCalls = [&]
+        {
+            return std::accumulate (instances.begin(), instances.end(), 0, [] (int sum, const auto& i) { return sum + i->numCalls.load(); });
+        };
+
+        beginTest ("A template of " + juce::String (numInstances) + " instances shares a few threads");
+        {
+            expect (pool.getNumThreads() >= 1 && pool.getNumThreads() <= 4);
+
+            for (auto& instance : instances)
+                instance->pending = eventsPerInstance;
+
+            const auto startCpu = std::clock();
+            const auto startMs = juce::Time::getMillisecondCounterHiRes();
+            pool.wakeUp();
+
+            const auto allDrained = [&] { return std::all_of (instances.begin(), instances.end(), [] (const auto& i) { return i->pending.load() == 0; }); };
+
+            while (! allDrained() && juce::Time::getMillisecondCounterHiRes() - startMs < 10000.0)
+                juce::Thread::sleep (1);
+
+            expect (allDrained());
+            logMessage (juce::String (numInstances * eventsPerInstance) + " events from " + juce::String (numInstances) + " instances drained by "
+                        + juce::String (pool.getNumThreads()) + " threads (rather than " + juce::String (numInstances) + ") in "
+                        + juce::String (juce::Time::getMillisecondCounterHiRes() - startMs, 1) + " ms, "
+                        + juce::String (1000.0 * (double) (std::clock() - startCpu) / CLOCKS_PER_SEC, 1) + " ms of CPU");
+        }
+
+        beginTest ("Idle instances cost no wake-ups");
+        {
+            // Let the pass that found nothing finish before counting
+            juce::Thread::sleep (50);
+            const auto callsBefore = totalCalls();
+            const auto startCpu = std::clock();
+
+            juce::Thread::sleep (500);
+
+            expectEquals (totalCalls() - callsBefore, 0);
+            logMessage ("CPU while idle for 500 ms: " + juce::String (1000.0 * (double) (std::clock() - startCpu) / CLOCKS_PER_SEC, 1) + " ms");
+        }
+
+        beginTest ("A pass asked for later comes, without any events");
+        {
+            const auto callsBefore = totalCalls();
+            const auto startMs = juce::Time::getMillisecondCounterHiRes();
+            pool.notifyAfter (200);
+            pool.notifyAfter (5000);    // The earlier one still comes first
+
+            while (totalCalls() == callsBefore && juce::Time::getMillisecondCounterHiRes() - startMs < 2000.0)
+                juce::Thread::sleep (1);
+
+            const auto elapsedMs = juce::Time::getMillisecondCounterHiRes() - startMs;
+            juce::Thread::sleep (100);      // Let the pass finish
+
+            expectEquals (totalCalls() - callsBefore, numInstances);
+            expect (elapsedMs >= 190.0 && elapsedMs < 1000.0, juce::String (elapsedMs, 1) + " ms");
+        }
+
+        beginTest ("One-off jobs run while the service job sleeps");
+        {
+            juce::WaitableEvent done;
+            pool.addJob ([&done] { done.signal(); });
+            expect (done.wait (2000));
+        }
+
+        for (auto& instance : instances)
+            pool.removeClient (*instance);
+    }
+};
+
+static AnalysisWorkerPoolTests analysisWorkerPoolTests;
+
+#endif
@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    AnalysisWorkerPool.h
+
+    One small pool of background threads shared by every Pocket instance in
+    the host process.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Runs all background analysis for every plugin instance on a single, bounded
+    juce::ThreadPool, so a template with hundreds of instances still only costs a
+    couple of threads.
+
+    Share it with juce::SharedResourcePointer<AnalysisWorkerPool>. The threads are
+    only created once the first client registers.
+
+    Registered clients are drained fairly: one service job visits every client in
+    turn, giving each at most drainBudget events per visit, and starts each pass
+    with a different client. It sleeps until there's work: producers call
+    notify() after queuing events, which only sets a flag so it's safe on the
+    audio thread, and the sleeping job looks at the flag at the display rate.
+    Threads that may block can wake it at once with wakeUp(), and a client that
+    has something to finish later (without new events) can ask for a pass with
+    notifyAfter(). Other one-off work can be queued with addJob().
+*/
+class AnalysisWorkerPool
+{
+public:
+    AnalysisWorkerPool();
+    ~AnalysisWorkerPool();
+
+    //==============================================================================
+    /** A per-instance queue the service job should keep drained. */
+    class Client
+    {
+    public:
+        virtual ~Client() = default;
+
+        /** Worker thread: handles at most maxEvents pending events and returns how many it handled. */
+        virtual int drainPending (int maxEvents) = 0;
+    };
+
+    void addClient (Client&);
+
+    /** Blocks until the client is no longer being drained, so it's safe to delete afterwards. */
+    void removeClient (Client&);
+
+    /** Any thread, including the audio thread: there are events to drain. Never blocks. */
+    void notify() noexcept      { workPending.store (true, std::memory_order_release); }
+
+    /** Wakes the service job right away (not from the audio thread: it takes a lock). */
+    void wakeUp();
+
+    /** Any thread: asks for a pass over every client once delayMs have passed (or sooner,
+        if another one is due first). Never blocks.
+    */
+    void notifyAfter (int delayMs) noexcept;
+
+    //==============================================================================
+    /** Queues a one-off job on the shared threads. */
+    void addJob (std::function<void()> job);
+
+    /** Returns the number of threads in use (zero until the first client registers). */
+    int getNumThreads() const;
+
+    static constexpr int drainBudget = 256;
+
+    // How often the sleeping job checks notify() and notifyAfter(); the editors don't refresh any faster
+    static constexpr int notifyCheckHz = 30;
+
+private:
+    //==============================================================================
+    class ServiceJob;
+
+    void ensurePoolExists();
+    int drainAllClients();
+
+    // Service job: sleeps until woken, notified or a pass is due
+    void waitForWork (const juce::ThreadPoolJob&);
+
+    // Held only to change or copy the list: clients are called without it
+    juce::CriticalSection clientLock;
+    juce::Array<Client*> clients;
+    int nextClient = 0;
+    std::atomic<Client*> drainingClient { nullptr };
+    juce::WaitableEvent clientDrained;
+
+    std::atomic<bool> workPending { false };
+    std::atomic<juce::uint32> passDueMs { 0 };     // Millisecond counter; 0 when none is due
+    juce::WaitableEvent workAvailable;
+    ServiceJob* serviceJob = nullptr;
+
+    juce::CriticalSection poolLock;
+    std::unique_ptr<juce::ThreadPool> pool;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalysisWorkerPool)
+};
@@ -0,0 +1,225 @@
+/*
+  ==============================================================================
+
+    ArticulationAnalyser.cpp
+
+  ==============================================================================
+*/
+
+#include "ArticulationAnalyser.h"
+
+//==============================================================================
+void ArticulationAnalyser::process (const GridSettings& grid, const NoteDuration* durations, int numDurations)
+{
+    if (numDurations <= 0)
+        return;
+
+    Results batch;
+
+    for (int i = 0; i < numDurations; ++i)
+    {
+        const auto& d = durations[i];
+        const auto length = d.lengthPpq / grid.stepPpq;
+
+        ++batch.numNotes;
+        batch.numLegato += length >= legatoLength ? 1 : 0;
+        batch.numStaccato += length < staccatoLength ? 1 : 0;
+        batch.numSustained += d.sustained ? 1 : 0;
+        batch.sumLengths += length;
+        batch.sumSquaresLengths += length * length;
+        batch.releases.add (computeDeviationMs (d.ppq + d.lengthPpq, d.bpm, grid));
+    }
+
+    const juce::ScopedLock sl (resultsLock);
+    results.numNotes += batch.numNotes;
+    results.numLegato += batch.numLegato;
+    results.numStaccato += batch.numStaccato;
+    results.numSustained += batch.numSustained;
+    results.sumLengths += batch.sumLengths;
+    results.sumSquaresLengths += batch.sumSquaresLengths;
+    results.releases.merge (batch.releases);
+}
+
+void ArticulationAnalyser::reset()
+{
+    const juce::ScopedLock sl (resultsLock);
+    results = {};
+}
+
+ArticulationAnalyser::Results ArticulationAnalyser::getResults() const
+{
+    const juce::ScopedLock sl (resultsLock);
+    return results;
+}
+
+//==============================================================================
+double ArticulationAnalyser::Results::getMeanLength() const noexcept
+{
+    return numNotes > 0 ? sumLengths / (double) numNotes : 0.0;
+}
+
+double ArticulationAnalyser::Results::getLengthStandardDeviation() const noexcept
+{
+    if (numNotes < 2)
+        return 0.0;
+
+    const auto mean = getMeanLength();
+    return std::sqrt (juce::jmax (0.0, sumSquaresLengths / (double) numNotes - mean * mean));
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+// NoteDurationTracker lives in its header, so its tests sit with the analyser it feeds
+class NoteDurationTrackerTests  : public juce::UnitTest
+{
+public:
+    NoteDurationTrackerTests()  : juce::UnitTest ("NoteDurationTracker", "Pocket") {}
+
+    void runTest() override
+    {
+        NoteDurationTracker tracker;
+        std::vector<NoteDuration> finished;
+        const auto collect = [&finished] (const NoteDuration& d) { finished.push_back (d); };
+
+        const auto expectNote = [this] (const NoteDuration& d, int note, int channel, double ppq, double lengthPpq, bool sustained)
+        {
+            expectEquals ((int) d.note, note);
+            expectEquals ((int) d.channel, channel);
+            expectWithinAbsoluteError (d.ppq, ppq, 1.0e-9);
+            expectWithinAbsoluteError (d.lengthPpq, lengthPpq, 1.0e-9);
+            expect (d.sustained == sustained);
+        };
+
+        beginTest ("A note-off ends its note-on");
+        {
+            tracker.noteOn (1, 60, 0.0, 120.0, 3, collect);
+            expect (finished.empty());
+
+            tracker.noteOff (1, 60, 0.5, collect);
+            expectEquals ((int) finished.size(), 1);
+            expectNote (finished[0], 60, 1, 0.0, 0.5, false);
+            expectEquals (finished[0].bpm, 120.0);
+            expectEquals ((int) finished[0].take, 3);
+
+            // A note-off with nothing sounding is ignored
+            tracker.noteOff (1, 60, 1.0, collect);
+            expectEquals ((int) finished.size(), 1);
+        }
+
+        beginTest ("The sustain pedal holds released notes until it lifts");
+        {
+            finished.clear();
+            tracker.sustainPedal (1, true, 1.0, collect);
+            tracker.noteOn (1, 60, 1.0, 120.0, 1, collect);
+            tracker.noteOff (1, 60, 1.5, collect);
+
+            // Another channel's notes aren't held by this pedal
+            tracker.noteOn (2, 60, 1.0, 120.0, 1, collect);
+            tracker.noteOff (2, 60, 1.25, collect);
+            expectEquals ((int) finished.size(), 1);
+            expectNote (finished[0], 60, 2, 1.0, 0.25, false);
+
+            // A note still held by the hand when the pedal lifts goes on until its note-off
+            tracker.noteOn (1, 64, 2.0, 120.0, 1, collect);
+
+            // Repeated pedal values change nothing
+            tracker.sustainPedal (1, true, 2.5, collect);
+            tracker.sustainPedal (1, false, 3.0, collect);
+            tracker.sustainPedal (1, false, 3.5, collect);
+            expectEquals ((int) finished.size(), 2);
+            expectNote (finished[1], 60, 1, 1.0, 2.0, true);
+
+            tracker.noteOff (1, 64, 4.0, collect);
+            expectEquals ((int) finished.size(), 3);
+            expectNote (finished[2], 64, 1, 2.0, 2.0, false);
+        }
+
+        beginTest ("A note struck again before its note-off ends at the new note-on");
+        {
+            finished.clear();
+            tracker.noteOn (1, 60, 0.0, 120.0, 1, collect);
+            tracker.noteOn (1, 60, 0.25, 120.0, 1, collect);
+            expectEquals ((int) finished.size(), 1);
+            expectNote (finished[0], 60, 1, 0.0, 0.25, false);
+
+            tracker.noteOff (1, 60, 1.0, collect);
+            expectEquals ((int) finished.size(), 2);
+            expectNote (finished[1], 60, 1, 0.25, 0.75, false);
+
+            // Also while the pedal holds it
+            tracker.sustainPedal (1, true, 2.0, collect);
+            tracker.noteOn (1, 60, 2.0, 120.0, 1, collect);
+            tracker.noteOff (1, 60, 2.1, collect);
+            tracker.noteOn (1, 60, 2.5, 120.0, 1, collect);
+            expectEquals ((int) finished.size(), 3);
+            expectNote (finished[2], 60, 1, 2.0, 0.5, true);
+
+            tracker.noteOff (1, 60, 2.75, collect);
+            tracker.sustainPedal (1, false, 3.0, collect);
+            expectEquals ((int) finished.size(), 4);
+            expectNote (finished[3], 60, 1, 2.5, 0.5, true);
+        }
+
+        beginTest ("All Notes Off ends every note on its channel only");
+        {
+            finished.clear();
+            tracker.sustainPedal (2, true, 0.0, collect);
+            tracker.noteOn (2, 60, 0.0, 120.0, 1, collect);
+            tracker.noteOn (2, 64, 0.5, 120.0, 1, collect);
+            tracker.noteOff (2, 64, 0.75, collect);
+            tracker.noteOn (3, 67, 0.0, 120.0, 1, collect);
+
+            tracker.allNotesOff (2, 2.0, collect);
+            expectEquals ((int) finished.size(), 2);
+            expectNote (finished[0], 60, 2, 0.0, 2.0, false);
+            expectNote (finished[1], 64, 2, 0.5, 1.5, true);
+
+            tracker.noteOff (3, 67, 3.0, collect);
+            expectEquals ((int) finished.size(), 3);
+            expectNote (finished[2], 67, 3, 0.0, 3.0, false);
+            tracker.sustainPedal (2, false, 3.0, collect);
+        }
+
+        beginTest ("Stuck notes are dropped, not reported");
+        {
+            finished.clear();
+            tracker.noteOn (1, 60, 0.0, 120.0, 1, collect);
+            tracker.noteOff (1, 60, NoteDurationTracker::maxLengthPpq + 1.0, collect);
+            expect (finished.empty());
+
+            // The note is over all the same
+            tracker.noteOff (1, 60, NoteDurationTracker::maxLengthPpq + 2.0, collect);
+            expect (finished.empty());
+
+            tracker.noteOn (1, 60, 0.0, 120.0, 1, collect);
+            tracker.noteOff (1, 60, NoteDurationTracker::maxLengthPpq, collect);
+            expectEquals ((int) finished.size(), 1);
+        }
+
+        beginTest ("reset() forgets sounding notes and pedals");
+        {
+            finished.clear();
+            tracker.sustainPedal (1, true, 0.0, collect);
+            tracker.noteOn (1, 60, 0.0, 120.0, 1, collect);
+            tracker.noteOn (1, 62, 0.0, 120.0, 1, collect);
+            tracker.noteOff (1, 62, 0.5, collect);
+
+            tracker.reset();
+            tracker.noteOff (1, 60, 1.0, collect);
+            tracker.sustainPedal (1, false, 1.0, collect);
+            expect (finished.empty());
+
+            // The pedal is up again, so a new note ends at its note-off
+            tracker.noteOn (1, 60, 2.0, 120.0, 2, collect);
+            tracker.noteOff (1, 60, 2.5, collect);
+            expectEquals ((int) finished.size(), 1);
+            expectNote (finished[0], 60, 1, 2.0, 0.5, false);
+            expectEquals ((int) finished[0].take, 2);
+        }
+    }
+};
+
+static NoteDurationTrackerTests noteDurationTrackerTests;
+
+#endif
@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    ArticulationAnalyser.h
+
+    Statistics on how long notes are held and when they're released.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "NoteDurationTracker.h"
+#include "TimingGrid.h"
+#include "SessionStatistics.h"
+
+//==============================================================================
+/**
+    Measures finished notes against the grid: each note's length as a fraction
+    of the grid step (1.0 fills the step, so legato playing sits near or above
+    it and staccato well below), and how far its release lies from the nearest
+    grid point (or reference note).
+
+    process() must only be called from one thread (the analysis worker);
+    getResults() can be called from any thread.
+*/
+class ArticulationAnalyser
+{
+public:
+    ArticulationAnalyser() = default;
+
+    struct Results
+    {
+        juce::int64 numNotes = 0;
+        juce::int64 numLegato = 0;      // At least legatoLength of the step
+        juce::int64 numStaccato = 0;    // Shorter than staccatoLength of the step
+        juce::int64 numSustained = 0;   // Held on by the sustain pedal
+        double sumLengths = 0.0;
+        double sumSquaresLengths = 0.0;
+        SessionStatistics releases;     // Note ends against the grid
+
+        double getMeanLength() const noexcept;
+        double getLengthStandardDeviation() const noexcept;
+    };
+
+    /** Measures finished notes against the grid, after removing its latency offset. */
+    void process (const GridSettings& grid, const NoteDuration* durations, int numDurations);
+
+    /** Forgets the notes measured so far, e.g. when a new session starts. */
+    void reset();
+
+    Results getResults() const;
+
+    static constexpr double legatoLength = 0.9;
+    static constexpr double staccatoLength = 0.5;
+
+private:
+    juce::CriticalSection resultsLock;
+    Results results;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ArticulationAnalyser)
+};
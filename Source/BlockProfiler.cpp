@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    BlockProfiler.cpp
+
+  ==============================================================================
+*/
+
+#include "BlockProfiler.h"
+
+//==============================================================================
+juce::Range<double> BlockProfiler::getBinRange (int bin) noexcept
+{
+    const auto lowerEdge = [] (int b)
+    {
+        return std::ldexp (1.0 + (double) (b % binsPerOctave) / binsPerOctave, minOctave + b / binsPerOctave);
+    };
+
+    return { lowerEdge (bin), lowerEdge (bin + 1) };
+}
+
+BlockProfiler::Report BlockProfiler::getReport() const noexcept
+{
+    std::array<juce::uint32, numBins> counts;
+    juce::int64 total = 0;
+
+    for (size_t b = 0; b < counts.size(); ++b)
+        total += (counts[b] = bins[b].load (std::memory_order_relaxed));
+
+    Report report;
+    report.numBlocks = total;
+
+    if (total == 0)
+        return report;
+
+    report.max = maxFraction.load (std::memory_order_relaxed);
+    report.mean = sumFractions.load (std::memory_order_relaxed) / (double) juce::jmax ((juce::int64) 1, numBlocks.load());
+
+    // The geometric centre of the bin holding the percentile, never above the maximum
+    const auto percentile = [&] (double p)
+    {
+        const auto rank = (juce::int64) std::ceil (p * (double) total);
+        juce::int64 seen = 0;
+
+        for (int b = 0; b < numBins; ++b)
+        {
+            seen += counts[(size_t) b];
+
+            if (seen >= rank)
+            {
+                const auto range = getBinRange (b);
+                return juce::jmin (report.max, std::sqrt (range.getStart() * range.getEnd()));
+            }
+        }
+
+        return report.max;
+    };
+
+    report.p50 = percentile (0.5);
+    report.p99 = percentile (0.99);
+    return report;
+}
+
+bool BlockProfiler::exportToFile (const juce::File& file) const
+{
+    const auto report = getReport();
+
+    juce::String csv;
+    csv << "# blocks " << report.numBlocks << ", p50 " << report.p50 << ", p99 " << report.p99
+        << ", max " << report.max << ", mean " << report.mean << " (fractions of the block's duration)\n"
+        << "budget_from,budget_to,blocks\n";
+
+    for (int b = 0; b < numBins; ++b)
+        if (const auto count = bins[(size_t) b].load (std::memory_order_relaxed); count > 0)
+            csv << getBinRange (b).getStart() << "," << getBinRange (b).getEnd() << "," << (juce::int64) count << "\n";
+
+    return file.getParentDirectory().createDirectory() && file.replaceWithText (csv);
+}
@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    BlockProfiler.h
+
+    Measures how much of the real-time budget each processBlock() call uses.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <cstring>
+
+// Set to 0 to compile the block timing out of processBlock() entirely
+#ifndef POCKET_ENABLE_PROFILING
+ #define POCKET_ENABLE_PROFILING 1
+#endif
+
+//==============================================================================
+/**
+    A histogram of processBlock() cost as a fraction of the block's duration
+    (numSamples / sampleRate), the time the host allows for it.
+
+    Bins are logarithmic: eight per octave, from 2^-16 of the budget up to 16
+    times it, so every bin is about 9% wide wherever the cost lies. The bin is
+    read straight from the bits of the float fraction, so recording a block is
+    two clock reads and a few integer operations, with no locks or allocation.
+
+    record() is for the audio thread only; everything else is safe from any
+    thread. Percentiles are accurate to the width of a bin; the maximum is exact.
+*/
+class BlockProfiler
+{
+public:
+    BlockProfiler() = default;
+
+    struct Report
+    {
+        juce::int64 numBlocks = 0;
+        double p50 = 0.0, p99 = 0.0, max = 0.0, mean = 0.0;     // Fractions of the budget
+    };
+
+    /** Audio thread: one block took elapsedTicks of Time::getHighResolutionTicks(). */
+    void record (juce::int64 elapsedTicks, int numSamples, double sampleRate) noexcept
+    {
+        if (resetRequested.load (std::memory_order_relaxed)
+             && resetRequested.exchange (false, std::memory_order_acquire))
+        {
+            for (auto& bin : bins)
+                bin.store (0, std::memory_order_relaxed);
+
+            numBlocks.store (0, std::memory_order_relaxed);
+            sumFractions.store (0.0, std::memory_order_relaxed);
+            maxFraction.store (0.0f, std::memory_order_relaxed);
+        }
+
+        if (numSamples <= 0 || sampleRate <= 0.0)
+            return;
+
+        const auto fraction = (float) ((double) elapsedTicks * sampleRate / ((double) numSamples * ticksPerSecond));
+        auto& bin = bins[(size_t) getBin (fraction)];
+
+        // Only the audio thread writes, so plain loads and stores are enough
+        bin.store (bin.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        numBlocks.store (numBlocks.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sumFractions.store (sumFractions.load (std::memory_order_relaxed) + fraction, std::memory_order_relaxed);
+
+        if (fraction > maxFraction.load (std::memory_order_relaxed))
+            maxFraction.store (fraction, std::memory_order_relaxed);
+    }
+
+    /** Times the enclosing scope as one block. Use POCKET_PROFILE_BLOCK rather than
+        creating one directly, so it disappears when profiling is compiled out.
+    */
+    struct ScopedBlock
+    {
+        ScopedBlock (BlockProfiler& p, int samples, double rate) noexcept
+            : profiler (p), numSamples (samples), sampleRate (rate), start (juce::Time::getHighResolutionTicks()) {}
+
+        ~ScopedBlock() noexcept
+        {
+            profiler.record (juce::Time::getHighResolutionTicks() - start, numSamples, sampleRate);
+        }
+
+        BlockProfiler& profiler;
+        const int numSamples;
+        const double sampleRate;
+        const juce::int64 start;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedBlock)
+    };
+
+    /** Clears the histogram before the audio thread records its next block. */
+    void reset() noexcept       { resetRequested.store (true, std::memory_order_release); }
+
+    Report getReport() const noexcept;
+
+    /** Writes the report and the non-empty bins as CSV. */
+    bool exportToFile (const juce::File& file) const;
+
+    static constexpr bool isEnabled = POCKET_ENABLE_PROFILING != 0;
+
+    static constexpr int binsPerOctave = 8;
+    static constexpr int minOctave = -16, maxOctave = 4;
+    static constexpr int numBins = (maxOctave - minOctave) * binsPerOctave;
+
+    /** The range of budget fractions a bin covers. */
+    static juce::Range<double> getBinRange (int bin) noexcept;
+    juce::uint32 getBinCount (int bin) const noexcept   { return bins[(size_t) bin].load (std::memory_order_relaxed); }
+
+private:
+    static int getBin (float fraction) noexcept
+    {
+        // A float's exponent and top mantissa bits are a piecewise-linear log2
+        static_assert (binsPerOctave == 8, "Three mantissa bits per octave");
+        constexpr int firstBin = (minOctave + 127) * binsPerOctave;
+
+        if (! (fraction > 0.0f))
+            return 0;
+
+        juce::uint32 bits;
+        std::memcpy (&bits, &fraction, sizeof (bits));
+        return juce::jlimit (0, numBins - 1, (int) (bits >> 20) - firstBin);
+    }
+
+    const double ticksPerSecond = (double) juce::Time::getHighResolutionTicksPerSecond();
+
+    std::array<std::atomic<juce::uint32>, numBins> bins {};
+    std::atomic<juce::int64> numBlocks { 0 };
+    std::atomic<double> sumFractions { 0.0 };
+    std::atomic<float> maxFraction { 0.0f };
+    std::atomic<bool> resetRequested { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BlockProfiler)
+};
+
+#if POCKET_ENABLE_PROFILING
+ #define POCKET_PROFILE_BLOCK(profiler, numSamples, sampleRate) \
+    const BlockProfiler::ScopedBlock JUCE_JOIN_MACRO (profiledBlock, __LINE__) (profiler, numSamples, sampleRate)
+#else
+ #define POCKET_PROFILE_BLOCK(profiler, numSamples, sampleRate)
+#endif
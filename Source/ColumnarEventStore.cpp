@@ -0,0 +1,422 @@
+/*
+  ==============================================================================
+
+    ColumnarEventStore.cpp
+
+  ==============================================================================
+*/
+
+#include "ColumnarEventStore.h"
+
+//==============================================================================
+bool EventFilter::matchesEverything() const noexcept
+{
+    return notes.all() && minVelocity <= 0 && maxVelocity >= 127
+        && firstBar == std::numeric_limits<int>::min() && lastBar == std::numeric_limits<int>::max()
+        && take < 0 && type == Type::all;
+}
+
+EventFilter EventFilter::fromString (const juce::String& text)
+{
+    EventFilter filter;
+
+    for (auto term : juce::StringArray::fromTokens (text.toLowerCase(), " ", {}))
+    {
+        if (term.startsWith ("note="))
+        {
+            filter.notes.reset();
+
+            for (const auto& n : juce::StringArray::fromTokens (term.fromFirstOccurrenceOf ("=", false, false), ",", {}))
+                if (juce::isPositiveAndBelow (n.getIntValue(), 128))
+                    filter.notes.set ((size_t) n.getIntValue());
+        }
+        else if (term.startsWith ("vel>="))  filter.minVelocity = term.substring (5).getIntValue();
+        else if (term.startsWith ("vel<="))  filter.maxVelocity = term.substring (5).getIntValue();
+        else if (term.startsWith ("vel>"))   filter.minVelocity = term.substring (4).getIntValue() + 1;
+        else if (term.startsWith ("vel<"))   filter.maxVelocity = term.substring (4).getIntValue() - 1;
+        else if (term.startsWith ("take="))  filter.take = term.substring (5).getIntValue();
+        else if (term == "type=notes")       filter.type = Type::notes;
+        else if (term == "type=pedals")      filter.type = Type::pedals;
+        else if (term == "type=all")         filter.type = Type::all;
+        else if (term.startsWith ("bars="))
+        {
+            // Bars are shown 1-based, but stored 0-based
+            const auto range = term.substring (5);
+            filter.firstBar = range.upToFirstOccurrenceOf ("-", false, false).getIntValue() - 1;
+            filter.lastBar = range.containsChar ('-') ? range.fromFirstOccurrenceOf ("-", false, false).getIntValue() - 1
+                                                      : filter.firstBar;
+        }
+    }
+
+    return filter;
+}
+
+//==============================================================================
+void ColumnarEventStore::append (const TimingEvent* events, const float* deviations, const float* inferredDeviations, int numEvents)
+{
+    for (int i = 0; i < numEvents; ++i)
+    {
+        const auto& e = events[i];
+        sampleTime.push_back (e.sampleTime);
+        ppq.push_back (e.ppq);
+        bpm.push_back (e.bpm);
+        deviationMs.push_back (deviations[i]);
+        inferredDeviationMs.push_back (inferredDeviations[i]);
+        bar.push_back (e.bar);
+        note.push_back (e.note);
+        velocity.push_back (e.velocity);
+        take.push_back (e.take);
+        isController.push_back (e.isController ? 1 : 0);
+    }
+}
+
+void ColumnarEventStore::clear()
+{
+    sampleTime.clear();
+    ppq.clear();
+    bpm.clear();
+    deviationMs.clear();
+    inferredDeviationMs.clear();
+    bar.clear();
+    note.clear();
+    velocity.clear();
+    take.clear();
+    isController.clear();
+}
+
+//==============================================================================
+SessionStatistics ColumnarEventStore::query (const EventFilter& filter) const
+{
+    SessionStatistics result;
+
+    const auto filterNotes = ! filter.notes.all();
+    const auto filterVelocity = filter.minVelocity > 0 || filter.maxVelocity < 127;
+    const auto filterBars = filter.firstBar != std::numeric_limits<int>::min()
+                         || filter.lastBar != std::numeric_limits<int>::max();
+    const auto filterTake = filter.take >= 0;
+    const auto filterType = filter.type != EventFilter::Type::all;
+
+    std::array<juce::uint8, 256> noteMatches {};
+
+    for (size_t n = 0; n < 128; ++n)
+        noteMatches[n] = filter.notes[n] ? 1 : 0;
+
+    std::array<juce::uint8, blockSize> mask, bins;
+    const auto numEvents = size();
+
+    for (size_t start = 0; start < numEvents; start += blockSize)
+    {
+        const auto length = juce::jmin (blockSize, numEvents - start);
+        std::fill (mask.begin(), mask.begin() + (ptrdiff_t) length, (juce::uint8) 1);
+
+        // One branch-free pass per active predicate
+        if (filterNotes)
+        {
+            const auto* column = note.data() + start;
+
+            for (size_t i = 0; i < length; ++i)
+                mask[i] &= noteMatches[column[i]];
+        }
+
+        if (filterVelocity)
+        {
+            const auto* column = velocity.data() + start;
+            const auto lo = filter.minVelocity, hi = filter.maxVelocity;
+
+            for (size_t i = 0; i < length; ++i)
+                mask[i] &= (juce::uint8) ((column[i] >= lo) & (column[i] <= hi));
+        }
+
+        if (filterBars)
+        {
+            const auto* column = bar.data() + start;
+            const auto lo = filter.firstBar, hi = filter.lastBar;
+
+            for (size_t i = 0; i < length; ++i)
+                mask[i] &= (juce::uint8) ((column[i] >= lo) & (column[i] <= hi));
+        }
+
+        if (filterTake)
+        {
+            const auto* column = take.data() + start;
+            const auto wanted = filter.take;
+
+            for (size_t i = 0; i < length; ++i)
+                mask[i] &= (juce::uint8) (column[i] == wanted);
+        }
+
+        if (filterType)
+        {
+            const auto* column = isController.data() + start;
+            const auto wanted = filter.type == EventFilter::Type::pedals ? 1 : 0;
+
+            for (size_t i = 0; i < length; ++i)
+                mask[i] &= (juce::uint8) (column[i] == wanted);
+        }
+
+        // Aggregates, weighted by the mask rather than branching on it. Each runs as
+        // its own pass; the float sums are kept in separate lanes so they can be
+        // vectorised without reassociating floating point additions.
+        const auto* deviation = deviationMs.data() + start;
+        const auto vectorLength = length - length % lanes;
+        std::array<float, lanes> sum {}, sumSquares {};
+        int blockCount = 0, blockEarly = 0, blockLate = 0;
+
+        for (size_t i = 0; i < length; ++i)
+            blockCount += mask[i];
+
+        if (blockCount == 0)
+            continue;
+
+        for (size_t i = 0; i < length; ++i)
+        {
+            blockEarly += mask[i] & (deviation[i] < 0.0f);
+            blockLate += mask[i] & (deviation[i] > 0.0f);
+        }
+
+        for (size_t i = 0; i < vectorLength; i += lanes)
+        {
+            for (size_t l = 0; l < lanes; ++l)
+            {
+                const auto d = deviation[i + l] * (float) mask[i + l];
+                sum[l] += d;
+                sumSquares[l] += d * d;
+            }
+        }
+
+        for (size_t i = vectorLength; i < length; ++i)
+        {
+            const auto d = deviation[i] * (float) mask[i];
+            sum[0] += d;
+            sumSquares[0] += d * d;
+        }
+
+        for (size_t l = 0; l < lanes; ++l)
+        {
+            result.sumMs += sum[l];
+            result.sumSquaresMs += sumSquares[l];
+        }
+
+        result.numEarly += blockEarly;
+        result.numLate += blockLate;
+        result.numNotes += blockCount;
+
+        // Histogram: work out every row's bin in one pass (unmatched rows go to a
+        // spare bin that's thrown away), then count them into interleaved copies so
+        // consecutive increments of the same bin don't wait on each other.
+        constexpr auto binsPerMs = (float) SessionStatistics::numHistogramBins / (2.0f * (float) SessionStatistics::histogramRangeMs);
+        constexpr auto maxBin = (float) SessionStatistics::numHistogramBins - 0.5f;
+
+        for (size_t i = 0; i < length; ++i)
+        {
+            const auto position = juce::jlimit (0.0f, maxBin, (deviation[i] + (float) SessionStatistics::histogramRangeMs) * binsPerMs);
+            const auto m = mask[i];
+            bins[i] = (juce::uint8) (m * (int) position + (1 - m) * SessionStatistics::numHistogramBins);
+        }
+
+        std::array<std::array<int, SessionStatistics::numHistogramBins + 1>, 4> counts {};
+
+        for (size_t i = 0; i < vectorLength; i += 4)
+            for (size_t c = 0; c < 4; ++c)
+                ++counts[c][bins[i + c]];
+
+        for (size_t i = vectorLength; i < length; ++i)
+            ++counts[0][bins[i]];
+
+        for (size_t b = 0; b < (size_t) SessionStatistics::numHistogramBins; ++b)
+            result.histogram[b] += counts[0][b] + counts[1][b] + counts[2][b] + counts[3][b];
+    }
+
+    return result;
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class ColumnarEventStoreTests  : public juce::UnitTest
+{
+public:
+    ColumnarEventStoreTests()  : juce::UnitTest ("ColumnarEventStore", "Pocket") {}
+
+    void runTest() override
+    {
+        auto random = getRandom();
+
+        beginTest ("Queries match a plain filter loop");
+        {
+            // Around the block size and the lane and histogram interleaving widths, then anything
+            for (auto numRows : { 0, 1, 3, 7, 8, 9, 4095, 4096, 4097, 8195, 10003, random.nextInt (20000), random.nextInt (20000) })
+            {
+                std::vector<TimingEvent> events ((size_t) numRows);
+                std::vector<float> deviations ((size_t) numRows);
+
+                for (int i = 0; i < numRows; ++i)
+                {
+                    auto& e = events[(size_t) i];
+                    e.note = (juce::uint8) random.nextInt (128);
+                    e.velocity = (juce::uint8) random.nextInt (128);
+                    e.bar = random.nextInt ({ -1, 64 });
+                    e.take = (juce::uint16) random.nextInt ({ 1, 5 });
+                    e.isController = random.nextInt (8) == 0;
+                    deviations[(size_t) i] = randomDeviation (random);
+                }
+
+                ColumnarEventStore store;
+                store.append (events.data(), deviations.data(), deviations.data(), numRows);
+                expectEquals ((int) store.size(), numRows);
+
+                for (int f = 0; f < 50; ++f)
+                {
+                    const auto filter = f == 0 ? EventFilter() : randomFilter (random);
+                    const auto actual = store.query (filter);
+                    SessionStatistics expected;
+
+                    for (int i = 0; i < numRows; ++i)
+                    {
+                        const auto& e = events[(size_t) i];
+
+                        const auto typeMatches = filter.type == EventFilter::Type::all
+                                                  || e.isController == (filter.type == EventFilter::Type::pedals);
+
+                        if (filter.notes[e.note] && e.velocity >= filter.minVelocity && e.velocity <= filter.maxVelocity
+                             && e.bar >= filter.firstBar && e.bar <= filter.lastBar && (filter.take < 0 || e.take == filter.take)
+                             && typeMatches)
+                            expected.add (deviations[(size_t) i]);
+                    }
+
+                    expectEquals (actual.numNotes, expected.numNotes);
+                    expectEquals (actual.numEarly, expected.numEarly);
+                    expectEquals (actual.numLate, expected.numLate);
+                    expect (actual.histogram == expected.histogram, "histogram differs for " + juce::String (numRows) + " rows");
+
+                    // The lanes add up floats, so the sums can be a little off
+                    const auto tolerance = 1.0e-5 * (double) expected.numNotes * 100.0 + 1.0e-9;
+                    expectWithinAbsoluteError (actual.sumMs, expected.sumMs, tolerance);
+                    expectWithinAbsoluteError (actual.sumSquaresMs, expected.sumSquaresMs, tolerance * 100.0);
+                }
+            }
+        }
+
+        beginTest ("Pedal crossings are only matched when asked for");
+        {
+            // A sustain press (CC64, value 127) and E4 (note 64) played at 127
+            std::array<TimingEvent, 2> events;
+            events[0].note = 64;
+            events[0].velocity = 127;
+            events[0].isController = true;
+            events[1].note = 64;
+            events[1].velocity = 127;
+            const std::array<float, 2> deviations { -40.0f, 10.0f };
+
+            ColumnarEventStore store;
+            store.append (events.data(), deviations.data(), deviations.data(), 2);
+
+            expectEquals (store.query (EventFilter::fromString ("note=64")).numNotes, (juce::int64) 1);
+            expectEquals (store.query (EventFilter::fromString ("note=64")).sumMs, 10.0);
+            expectEquals (store.query (EventFilter::fromString ("vel>100")).numNotes, (juce::int64) 1);
+            expectEquals (store.query (EventFilter::fromString ("note=64 type=pedals")).sumMs, -40.0);
+            expectEquals (store.query (EventFilter::fromString ("type=all")).numNotes, (juce::int64) 2);
+            expect (EventFilter::fromString ("type=all").matchesEverything());
+            expect (! EventFilter().matchesEverything());
+        }
+
+        beginTest ("Ten million rows are queried quickly");
+        {
+            constexpr size_t numRows = 10000000;
+
+            // Only the columns a query reads are filled (the row count comes from ppq)
+            ColumnarEventStore store;
+            store.ppq.resize (numRows);
+            store.deviationMs.resize (numRows);
+            store.bar.resize (numRows);
+            store.note.resize (numRows);
+            store.velocity.resize (numRows);
+            store.take.resize (numRows);
+            store.isController.resize (numRows);
+
+            for (size_t i = 0; i < numRows; ++i)
+            {
+                store.deviationMs[i] = randomDeviation (random);
+                store.bar[i] = (juce::int32) (i / 32);
+                store.note[i] = (juce::uint8) (36 + random.nextInt (12));
+                store.velocity[i] = (juce::uint8) random.nextInt (128);
+                store.take[i] = (juce::uint16) (1 + i / 1000000);
+            }
+
+            for (const auto* text : { "", "note=38", "note=38 vel>100 bars=33-64", "note=36,38,42 vel>=64 take=3" })
+            {
+                const auto filter = EventFilter::fromString (text);
+                auto bestMs = std::numeric_limits<double>::max();
+                juce::int64 numMatched = 0;
+
+                for (int run = 0; run < 3; ++run)
+                {
+                    const auto startMs = juce::Time::getMillisecondCounterHiRes();
+                    numMatched = store.query (filter).numNotes;
+                    bestMs = juce::jmin (bestMs, juce::Time::getMillisecondCounterHiRes() - startMs);
+                }
+
+                logMessage ("\"" + juce::String (text) + "\" matched " + juce::String (numMatched) + " of " + juce::String ((juce::int64) numRows)
+                            + " rows in " + juce::String (bestMs, 1) + " ms");
+
+                // Generous, so it holds in a debug build
+                expectLessThan (bestMs, 2000.0);
+            }
+        }
+    }
+
+private:
+    // Kept clear of the histogram's bin edges, so float and double binning agree; some
+    // are exactly on time and some are beyond the histogram's range
+    static float randomDeviation (juce::Random& random)
+    {
+        switch (random.nextInt (20))
+        {
+            case 0:  return 0.0f;
+            case 1:  return (random.nextBool() ? 1.0f : -1.0f) * (60.0f + 100.0f * random.nextFloat());
+            default: break;
+        }
+
+        const auto binWidthMs = 2.0f * (float) SessionStatistics::histogramRangeMs / (float) SessionStatistics::numHistogramBins;
+        const auto binCentreMs = -(float) SessionStatistics::histogramRangeMs + binWidthMs * ((float) random.nextInt (SessionStatistics::numHistogramBins) + 0.5f);
+        return binCentreMs + binWidthMs * 0.8f * (random.nextFloat() - 0.5f);
+    }
+
+    // Each kind of term is used about half the time
+    static EventFilter randomFilter (juce::Random& random)
+    {
+        EventFilter filter;
+
+        if (random.nextBool())
+        {
+            filter.notes.reset();
+
+            for (int i = random.nextInt ({ 0, 6 }); --i >= 0;)
+                filter.notes.set ((size_t) random.nextInt (128));
+        }
+
+        if (random.nextBool())
+        {
+            filter.minVelocity = random.nextInt (128);
+            filter.maxVelocity = random.nextInt ({ filter.minVelocity, 128 });
+        }
+
+        if (random.nextBool())
+        {
+            filter.firstBar = random.nextInt ({ -1, 64 });
+            filter.lastBar = random.nextInt ({ filter.firstBar, 65 });
+        }
+
+        if (random.nextBool())
+            filter.take = random.nextInt ({ 0, 6 });
+
+        if (random.nextBool())
+            filter.type = (EventFilter::Type) random.nextInt (3);
+
+        return filter;
+    }
+};
+
+static ColumnarEventStoreTests columnarEventStoreTests;
+
+#endif
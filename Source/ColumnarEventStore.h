@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    ColumnarEventStore.h
+
+    In-memory note store laid out column by column, with filter queries.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <bitset>
+#include "TimingEvent.h"
+#include "SessionStatistics.h"
+
+//==============================================================================
+/**
+    Selects a subset of the stored notes. A default-constructed filter matches
+    every note, but no pedal crossings: their controller numbers and values would
+    otherwise pass for note numbers and velocities.
+
+    fromString() accepts space-separated terms, e.g. "note=38 vel>100 bars=33-64":
+        note=36,38      only these note numbers (controller numbers with type=pedals)
+        vel>N, vel<N    velocity range (also vel>=N, vel<=N)
+        bars=A-B        bar range, 1-based and inclusive (or bars=A for a single bar)
+        take=N          a single take, 1-based
+        type=pedals     pedal crossings instead of notes (type=all for both)
+*/
+struct EventFilter
+{
+    enum class Type : juce::uint8 { notes, pedals, all };
+
+    std::bitset<128> notes;
+    int minVelocity = 0, maxVelocity = 127;
+    int firstBar = std::numeric_limits<int>::min();
+    int lastBar = std::numeric_limits<int>::max();
+    int take = -1;      // -1 matches every take
+    Type type = Type::notes;
+
+    EventFilter()       { notes.set(); }
+
+    bool matchesEverything() const noexcept;
+
+    bool operator== (const EventFilter& other) const noexcept
+    {
+        return notes == other.notes && minVelocity == other.minVelocity && maxVelocity == other.maxVelocity
+            && firstBar == other.firstBar && lastBar == other.lastBar && take == other.take && type == other.type;
+    }
+
+    bool operator!= (const EventFilter& other) const noexcept   { return ! operator== (other); }
+
+    /** Parses the syntax described above; unknown terms are ignored. */
+    static EventFilter fromString (const juce::String& text);
+};
+
+//==============================================================================
+/**
+    Structure-of-arrays storage of every note in a session.
+
+    Each field lives in its own contiguous column, so a query only streams the
+    columns it actually filters on. Queries work in fixed-size blocks: each
+    predicate is applied to a whole block as a branch-free pass that writes a
+    byte mask, and the aggregates are accumulated from the mask without
+    branching, which lets the compiler vectorise every loop.
+
+    Not thread-safe by itself; SessionAnalyser guards it with a read-write lock.
+*/
+class ColumnarEventStore
+{
+public:
+    ColumnarEventStore() = default;
+
+    void append (const TimingEvent* events, const float* deviationsMs, const float* inferredDeviationsMs, int numEvents);
+    void clear();
+
+    size_t size() const noexcept                    { return ppq.size(); }
+
+    /** Returns statistics over the deviations of every note that matches the filter. */
+    SessionStatistics query (const EventFilter& filter) const;
+
+    //==============================================================================
+    std::vector<juce::int64> sampleTime;
+    std::vector<double> ppq;
+    std::vector<double> bpm;
+    std::vector<float> deviationMs;     // Against the current grid; rewritten on re-analysis
+    std::vector<float> inferredDeviationMs;    // Against the note's inferred subdivision, once it's decided
+    std::vector<juce::int32> bar;
+    std::vector<juce::uint8> note;
+    std::vector<juce::uint8> velocity;
+    std::vector<juce::uint16> take;
+    std::vector<juce::uint8> isController;     // 1 for a pedal crossing, whose note is the controller number
+
+private:
+    static constexpr size_t blockSize = 4096;
+    static constexpr size_t lanes = 8;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ColumnarEventStore)
+};
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    ControllerTriggers.h
+
+    Turns controller movements, such as a hi-hat pedal chick or the sustain
+    pedal going down, into timed onsets.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+//==============================================================================
+/**
+    Watches configured controllers for their value rising past a threshold, e.g.
+    CC4 (hi-hat pedal) closing or CC64 (sustain) going down. Each crossing is an
+    onset that can be timed like a note.
+
+    Every controller on every channel has a small state machine: unknown until
+    its first value, then below or above the threshold. A crossing upwards
+    triggers; it re-arms only once the value falls hysteresis below the threshold
+    again, so a continuous pedal hovering around the threshold doesn't chatter.
+    Until its first value, a controller's state is only learned, so a pedal that's
+    already down when tracking starts doesn't trigger.
+
+    Controllers that aren't configured cost a single table lookup. Audio thread only.
+*/
+class ControllerTriggers
+{
+public:
+    ControllerTriggers() = default;
+
+    /** Triggers when the controller rises to threshold (1 to 127); 0 stops watching it. */
+    void setThreshold (int controller, int threshold) noexcept
+    {
+        thresholds[(size_t) (controller & 127)] = (juce::uint8) juce::jlimit (0, 127, threshold);
+    }
+
+    /** Returns true if this value is an upward crossing. Channels are 1 to 16. */
+    bool process (int channel, int controller, int value) noexcept
+    {
+        const auto threshold = (int) thresholds[(size_t) (controller & 127)];
+
+        if (threshold == 0)
+            return false;
+
+        auto& state = states[(size_t) (juce::jlimit (1, 16, channel) - 1)][(size_t) (controller & 127)];
+
+        if (state != State::above && value >= threshold)
+        {
+            const auto triggered = state == State::below;
+            state = State::above;
+            return triggered;
+        }
+
+        if (state != State::below && value < threshold - hysteresis)
+            state = State::below;
+
+        return false;
+    }
+
+    /** Forgets every controller's position, e.g. when the transport stops. */
+    void reset() noexcept
+    {
+        for (auto& channelStates : states)
+            channelStates.fill (State::unknown);
+    }
+
+    static constexpr int hiHatPedal = 4;
+    static constexpr int hiHatThreshold = 90;       // Closed enough to chick
+    static constexpr int sustainPedal = 64;
+    static constexpr int sustainThreshold = 64;     // The MIDI spec's "on"
+    static constexpr int hysteresis = 10;
+
+private:
+    enum class State : juce::uint8 { unknown, below, above };
+
+    std::array<juce::uint8, 128> thresholds {};
+    std::array<std::array<State, 128>, 16> states {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ControllerTriggers)
+};
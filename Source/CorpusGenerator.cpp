@@ -0,0 +1,317 @@
+/*
+  ==============================================================================
+
+    CorpusGenerator.cpp
+
+  ==============================================================================
+*/
+
+#include "CorpusGenerator.h"
+
+namespace
+{
+    struct PatternNote
+    {
+        int noteNumber, velocity, channel;
+        double lengthPpq;
+    };
+
+    bool isOnGrid (double barPpq, double stepPpq) noexcept
+    {
+        const auto steps = barPpq / stepPpq;
+        return std::abs (steps - std::round (steps)) < 1.0e-6;
+    }
+
+    // The notes a player means to play at a grid step (barPpq is the unswung position in the bar)
+    std::vector<PatternNote> getPatternNotes (CorpusGenerator::Style style, int bar, double barPpq, double stepPpq)
+    {
+        const auto onBeat = isOnGrid (barPpq, 1.0);
+        const auto offbeatOnGrid = isOnGrid (2.5, stepPpq);
+        std::vector<PatternNote> result;
+
+        switch (style)
+        {
+            case CorpusGenerator::Style::drums:
+            {
+                constexpr int kick = 36, snare = 38, closedHat = 42, drumChannel = 10;
+                result.push_back ({ closedHat, onBeat ? 85 : 65, drumChannel, stepPpq * 0.5 });
+
+                if (barPpq == 0.0 || barPpq == (offbeatOnGrid ? 2.5 : 2.0))
+                    result.push_back ({ kick, 105, drumChannel, stepPpq * 0.5 });
+
+                if (barPpq == 1.0 || barPpq == 3.0)
+                    result.push_back ({ snare, 110, drumChannel, stepPpq * 0.5 });
+
+                break;
+            }
+
+            case CorpusGenerator::Style::bass:
+            {
+                constexpr int roots[] = { 40, 45, 41, 43 };    // E, A, F, G
+                const auto root = roots[bar % 4];
+
+                if (onBeat)
+                    result.push_back ({ root, barPpq == 0.0 ? 110 : 95, 2, 0.8 });
+                else if (barPpq == 3.5 && isOnGrid (3.5, stepPpq))
+                    result.push_back ({ root + 12, 90, 2, 0.4 });
+
+                break;
+            }
+
+            case CorpusGenerator::Style::keys:
+            {
+                constexpr int chords[4][3] = { { 60, 64, 67 }, { 57, 60, 64 }, { 53, 57, 60 }, { 55, 59, 62 } };
+
+                if (barPpq == 0.0 || barPpq == (offbeatOnGrid ? 2.5 : 2.0))
+                    for (auto noteNumber : chords[bar % 4])
+                        result.push_back ({ noteNumber, barPpq == 0.0 ? 95 : 80, 1, 1.5 });
+
+                break;
+            }
+        }
+
+        return result;
+    }
+}
+
+//==============================================================================
+CorpusGenerator::CorpusGenerator (const Settings& s)
+    : settings (s)
+{
+    settings.numBars = juce::jmax (1, settings.numBars);
+    settings.division = juce::jlimit (0, GridSettings::referenceDivision - 1, settings.division);
+    generate();
+}
+
+void CorpusGenerator::generate()
+{
+    juce::Random random (settings.seed);
+
+    const auto gaussian = [&random]
+    {
+        const auto u1 = 1.0 - random.nextDouble();
+        const auto u2 = random.nextDouble();
+        return std::sqrt (-2.0 * std::log (u1)) * std::cos (juce::MathConstants<double>::twoPi * u2);
+    };
+
+    // The tempo map, with the lead-in bar at the start tempo and a bar after the end to let notes ring
+    const auto numTempoBars = leadInBars + settings.numBars + 1;
+
+    for (int bar = 0; bar < numTempoBars; ++bar)
+    {
+        const auto position = juce::jlimit (0.0, 1.0, (double) (bar - leadInBars) / juce::jmax (1, settings.numBars - 1));
+        auto bpm = settings.startBpm + (settings.endBpm - settings.startBpm) * position;
+
+        if (bar >= leadInBars)
+            bpm += settings.tempoWobbleBpm * gaussian();
+
+        barBpm.push_back (juce::jlimit (20.0, 400.0, bpm));
+        barStartSeconds.push_back (bar == 0 ? 0.0 : barStartSeconds.back() + 240.0 / barBpm[(size_t) bar - 1]);
+    }
+
+    const auto stepPpq = GridSettings::getDivisionStepPpq (settings.division);
+    const auto stepsPerBar = juce::roundToInt (4.0 / stepPpq);
+
+    // The drift keeps 95% of itself from onset to onset, scaled so its spread stays at driftMs
+    constexpr double driftMemory = 0.95;
+    auto drift = 0.0;
+
+    const auto addNote = [this] (Label label, const PatternNote& p, double intendedPpq, double bpm, double offsetMs)
+    {
+        Note note;
+        note.label = label;
+        note.noteNumber = p.noteNumber;
+        note.channel = p.channel;
+        note.velocity = p.velocity;
+        note.intendedPpq = intendedPpq;
+        note.playedPpq = intendedPpq + offsetMs * bpm / 60000.0;
+        note.lengthPpq = p.lengthPpq;
+        note.bpm = bpm;
+        note.offsetMs = offsetMs;
+        notes.push_back (note);
+    };
+
+    for (int bar = leadInBars; bar < leadInBars + settings.numBars; ++bar)
+    {
+        const auto bpm = barBpm[(size_t) bar];
+
+        for (int step = 0; step < stepsPerBar; ++step)
+        {
+            const auto barPpq = step * stepPpq;
+            auto pattern = getPatternNotes (settings.style, bar - leadInBars, barPpq, stepPpq);
+
+            if (pattern.empty())
+                continue;
+
+            // Swing moves every second step of a pair, as the grid does
+            const auto pairStart = (step / 2) * 2.0 * stepPpq;
+            const auto intendedPpq = 4.0 * bar + (step % 2 == 0 ? barPpq : pairStart + 2.0 * stepPpq * settings.swing);
+
+            drift = driftMemory * drift + std::sqrt (1.0 - driftMemory * driftMemory) * settings.driftMs * gaussian();
+            const auto isOutlier = random.nextDouble() < settings.outlierShare;
+            const auto onsetOffsetMs = settings.biasMs + drift + settings.jitterMs * (isOutlier ? 3.0 : 1.0) * gaussian();
+
+            const auto isRolled = settings.style == Style::keys && random.nextDouble() < settings.flamShare;
+
+            for (size_t i = 0; i < pattern.size(); ++i)
+            {
+                auto& p = pattern[i];
+                p.velocity = juce::jlimit (1, 127, p.velocity + random.nextInt ({ -8, 9 }));
+
+                auto offsetMs = onsetOffsetMs + (pattern.size() > 1 ? 0.25 * settings.jitterMs * gaussian() : 0.0);
+                auto label = random.nextDouble() < settings.missShare ? Label::missed : Label::played;
+
+                if (isRolled && pattern.size() > 1)
+                {
+                    // Rolled up to the last note, which lands with the onset
+                    offsetMs -= settings.flamMs * (double) (pattern.size() - 1 - i) / (double) (pattern.size() - 1);
+
+                    if (label == Label::played && i + 1 < pattern.size())
+                        label = Label::flam;
+                }
+                else if (settings.style == Style::drums && label == Label::played && random.nextDouble() < settings.flamShare)
+                {
+                    addNote (Label::flam, { p.noteNumber, juce::jmax (1, p.velocity * 35 / 100), p.channel, p.lengthPpq },
+                             intendedPpq, bpm, offsetMs - settings.flamMs);
+                }
+
+                addNote (label, p, intendedPpq, bpm, offsetMs);
+            }
+
+            // An unplanned note somewhere between this step and the next, measured from the closer one
+            if (random.nextDouble() < settings.extraShare)
+            {
+                const auto fraction = 0.2 + 0.6 * random.nextDouble();
+                const auto closestPpq = intendedPpq + (fraction < 0.5 ? 0.0 : stepPpq);
+                const auto playedPpq = intendedPpq + fraction * stepPpq;
+                const auto& p = pattern.front();
+
+                addNote (Label::extra, { p.noteNumber, juce::jmax (1, p.velocity / 2), p.channel, p.lengthPpq },
+                         closestPpq, bpm, (playedPpq - closestPpq) * 60000.0 / bpm);
+            }
+        }
+    }
+
+    std::stable_sort (notes.begin(), notes.end(), [] (const Note& a, const Note& b) { return a.playedPpq < b.playedPpq; });
+
+    // Note-offs go before note-ons at the same time, so a repeated note isn't cut short
+    for (const auto& note : notes)
+    {
+        if (note.label == Label::missed)
+            continue;
+
+        const auto channelBits = (juce::uint8) ((note.channel - 1) & 0x0f);
+        messages.push_back ({ getSecondsAtPpq (note.playedPpq), { (juce::uint8) (0x90 | channelBits), (juce::uint8) note.noteNumber, (juce::uint8) note.velocity } });
+        messages.push_back ({ getSecondsAtPpq (note.playedPpq + note.lengthPpq), { (juce::uint8) (0x80 | channelBits), (juce::uint8) note.noteNumber, 0 } });
+    }
+
+    std::stable_sort (messages.begin(), messages.end(), [] (const TimedMessage& a, const TimedMessage& b)
+    {
+        return a.seconds < b.seconds || (a.seconds == b.seconds && (a.data[0] & 0xf0) < (b.data[0] & 0xf0));
+    });
+}
+
+//==============================================================================
+double CorpusGenerator::getBpmAtPpq (double ppq) const noexcept
+{
+    return barBpm[(size_t) juce::jlimit (0, (int) barBpm.size() - 1, (int) std::floor (ppq / 4.0))];
+}
+
+double CorpusGenerator::getSecondsAtPpq (double ppq) const noexcept
+{
+    const auto bar = juce::jlimit (0, (int) barBpm.size() - 1, (int) std::floor (ppq / 4.0));
+    return barStartSeconds[(size_t) bar] + (ppq - 4.0 * bar) * 60.0 / barBpm[(size_t) bar];
+}
+
+double CorpusGenerator::getPpqAtSeconds (double seconds) const noexcept
+{
+    const auto next = std::upper_bound (barStartSeconds.begin(), barStartSeconds.end(), seconds);
+    const auto bar = juce::jlimit (0, (int) barStartSeconds.size() - 1, (int) (next - barStartSeconds.begin()) - 1);
+    return 4.0 * bar + (seconds - barStartSeconds[(size_t) bar]) * barBpm[(size_t) bar] / 60.0;
+}
+
+void CorpusGenerator::renderBlock (juce::MidiBuffer& midi, juce::int64 blockStartSample, int numSamples, double sampleRate) const
+{
+    // A message belongs to the sample its time falls in, so consecutive blocks never share or skip one
+    const auto sampleAt = [sampleRate] (double seconds) { return (juce::int64) std::floor (seconds * sampleRate); };
+
+    auto it = std::lower_bound (messages.begin(), messages.end(), blockStartSample,
+                                [&] (const TimedMessage& m, juce::int64 sample) { return sampleAt (m.seconds) < sample; });
+
+    for (; it != messages.end() && sampleAt (it->seconds) < blockStartSample + numSamples; ++it)
+        midi.addEvent (it->data, 3, (int) (sampleAt (it->seconds) - blockStartSample));
+}
+
+//==============================================================================
+juce::MidiFile CorpusGenerator::createMidiFile() const
+{
+    constexpr int ticksPerQuarter = 960;
+    juce::MidiMessageSequence sequence;
+
+    sequence.addEvent (juce::MidiMessage::timeSignatureMetaEvent (4, 4));
+
+    for (size_t bar = 0; bar < barBpm.size(); ++bar)
+        sequence.addEvent (juce::MidiMessage::tempoMetaEvent (juce::roundToInt (60.0e6 / barBpm[bar])),
+                           4.0 * (double) bar * ticksPerQuarter);
+
+    for (const auto& note : notes)
+    {
+        if (note.label == Label::missed)
+            continue;
+
+        const auto start = note.playedPpq * ticksPerQuarter;
+        sequence.addEvent (juce::MidiMessage::noteOn (note.channel, note.noteNumber, (juce::uint8) note.velocity), start);
+        sequence.addEvent (juce::MidiMessage::noteOff (note.channel, note.noteNumber), start + note.lengthPpq * ticksPerQuarter);
+    }
+
+    sequence.updateMatchedPairs();
+
+    juce::MidiFile file;
+    file.setTicksPerQuarterNote (ticksPerQuarter);
+    file.addTrack (sequence);
+    return file;
+}
+
+juce::String CorpusGenerator::createGroundTruth() const
+{
+    constexpr const char* labels[] = { "played", "flam", "missed", "extra" };
+
+    juce::String csv;
+    csv << "# " << getStyleNames()[(int) settings.style] << ", " << settings.numBars << " bars, "
+        << settings.startBpm << " to " << settings.endBpm << " bpm (wobble " << settings.tempoWobbleBpm << "), grid "
+        << GridSettings::getDivisionNames()[settings.division] << ", swing " << settings.swing
+        << ", bias " << settings.biasMs << " ms, jitter " << settings.jitterMs << " ms, drift " << settings.driftMs
+        << " ms, outliers " << settings.outlierShare << ", flams " << settings.flamShare << " (" << settings.flamMs
+        << " ms), missed " << settings.missShare << ", extra " << settings.extraShare << ", seed " << settings.seed << "\n"
+        << "label,note,channel,velocity,intended_ppq,played_ppq,bpm,offset_ms,played_seconds\n";
+
+    for (const auto& note : notes)
+        csv << labels[(int) note.label] << "," << note.noteNumber << "," << note.channel << "," << note.velocity << ","
+            << juce::String (note.intendedPpq, 6) << "," << juce::String (note.playedPpq, 6) << ","
+            << juce::String (note.bpm, 3) << "," << juce::String (note.offsetMs, 3) << ","
+            << juce::String (getSecondsAtPpq (note.playedPpq), 6) << "\n";
+
+    return csv;
+}
+
+bool CorpusGenerator::writeFiles (const juce::File& midiFile) const
+{
+    if (! midiFile.getParentDirectory().createDirectory())
+        return false;
+
+    {
+        juce::FileOutputStream out (midiFile);
+
+        if (out.failedToOpen())
+            return false;
+
+        out.setPosition (0);
+        out.truncate();
+
+        if (! createMidiFile().writeTo (out))
+            return false;
+    }
+
+    return midiFile.getSiblingFile (midiFile.getFileNameWithoutExtension() + ".truth.csv")
+                   .replaceWithText (createGroundTruth());
+}
@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+    CorpusGenerator.h
+
+    Humanised performances with known timing, for measuring how accurately
+    and how fast the timing engine works.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "TimingGrid.h"
+
+//==============================================================================
+/**
+    Plays a drum, bass or keys pattern on a grid and humanises it, keeping the
+    exact offset given to every note as ground truth.
+
+    Each onset is moved by the player's bias, a slow push and pull (an AR(1)
+    drift, as in real timing) and note-to-note jitter, with an occasional outlier
+    at three times the jitter. Notes of one onset share its offset plus a little
+    scatter of their own. On top of that, notes can be missed, extra notes can be
+    played between the steps, and drum hits can be flammed or keys chords rolled.
+    The tempo can ramp and wobble from bar to bar; everything starts after one
+    empty bar.
+
+    The result can be written as a .mid file with a CSV sidecar holding the
+    truth for every note, or fed to a processor block by block with
+    renderBlock() and getPpqAtSeconds(). The same settings and seed always give
+    the same performance.
+*/
+class CorpusGenerator
+{
+public:
+    enum class Style { drums, bass, keys };
+
+    static juce::StringArray getStyleNames()    { return { "drums", "bass", "keys" }; }
+
+    struct Settings
+    {
+        Style style = Style::drums;
+        int numBars = 64;
+        double startBpm = 100.0, endBpm = 100.0;    // The tempo ramps between these across the bars
+        double tempoWobbleBpm = 0.0;                // Random tempo change of each bar on top of the ramp
+
+        int division = 2;               // Index into GridSettings::getDivisionNames(), fixed grids only
+        double swing = 0.5;
+
+        double biasMs = 0.0;            // The player's average offset (positive = late)
+        double jitterMs = 8.0;          // Standard deviation of the note-to-note scatter
+        double driftMs = 5.0;           // Standard deviation of the slow push and pull
+        double outlierShare = 0.01;     // Onsets with three times the jitter
+
+        double flamShare = 0.0;         // Drum hits with a grace note, or keys chords rolled
+        double flamMs = 25.0;           // How far ahead the grace note (or the whole roll) is
+        double missShare = 0.0;         // Notes left out
+        double extraShare = 0.0;        // Onsets followed by an unplanned note between the steps
+
+        juce::int64 seed = 1;
+    };
+
+    enum class Label { played, flam, missed, extra };
+
+    struct Note
+    {
+        Label label = Label::played;
+        int noteNumber = 0, channel = 1, velocity = 100;
+        double intendedPpq = 0.0;       // The grid point meant (for extra notes, the closest one)
+        double playedPpq = 0.0;         // Where it was played (or would have been, if missed)
+        double lengthPpq = 0.25;
+        double bpm = 120.0;             // The tempo at the note
+        double offsetMs = 0.0;          // playedPpq - intendedPpq at that tempo
+    };
+
+    explicit CorpusGenerator (const Settings&);
+
+    const Settings& getSettings() const noexcept        { return settings; }
+
+    /** Every note in time order, including the missed ones (which aren't played). */
+    const std::vector<Note>& getNotes() const noexcept  { return notes; }
+
+    double getLengthPpq() const noexcept                { return 4.0 * (leadInBars + settings.numBars + 1); }
+    double getLengthSeconds() const noexcept            { return getSecondsAtPpq (getLengthPpq()); }
+
+    //==============================================================================
+    /** The tempo map: one tempo per 4/4 bar. */
+    double getBpmAtPpq (double ppq) const noexcept;
+    double getSecondsAtPpq (double ppq) const noexcept;
+    double getPpqAtSeconds (double seconds) const noexcept;
+
+    /** Adds the note-ons and note-offs that fall within a block, at the sample
+        positions a host would give them. Doesn't allocate beyond what the
+        MidiBuffer needs.
+    */
+    void renderBlock (juce::MidiBuffer& midi, juce::int64 blockStartSample, int numSamples, double sampleRate) const;
+
+    //==============================================================================
+    juce::MidiFile createMidiFile() const;
+
+    /** One CSV line per note: label, note, channel, velocity, intended and played
+        PPQ, tempo, offset and the played time in seconds.
+    */
+    juce::String createGroundTruth() const;
+
+    /** Writes the .mid file, and the ground truth next to it as <name>.truth.csv. */
+    bool writeFiles (const juce::File& midiFile) const;
+
+    static constexpr int leadInBars = 1;
+
+private:
+    void generate();
+
+    struct TimedMessage
+    {
+        double seconds = 0.0;
+        juce::uint8 data[3] {};
+    };
+
+    Settings settings;
+    std::vector<Note> notes;
+    std::vector<double> barBpm, barStartSeconds;
+    std::vector<TimedMessage> messages;     // Note-ons and -offs of the played notes, in time order
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CorpusGenerator)
+};
@@ -0,0 +1,243 @@
+/*
+  ==============================================================================
+
+    DiagnosticsPanel.cpp
+
+  ==============================================================================
+*/
+
+#include "DiagnosticsPanel.h"
+#include "CorpusGenerator.h"
+
+//==============================================================================
+DiagnosticsPanel::DiagnosticsPanel (PocketAudioProcessor& p)
+    : audioProcessor (p)
+{
+    reportLabel.setFont (juce::FontOptions (13.0f));
+    reportLabel.setJustificationType (juce::Justification::topLeft);
+    addAndMakeVisible (reportLabel);
+
+    exportButton.setTooltip ("Save the block timing histogram as CSV");
+    exportButton.onClick = [this] { exportButtonClicked(); };
+    addAndMakeVisible (exportButton);
+
+    resetButton.onClick = [this] { audioProcessor.getBlockProfiler().reset(); };
+    addAndMakeVisible (resetButton);
+
+    traceButton.setClickingTogglesState (true);
+    traceButton.setToggleState (audioProcessor.getTraceRecorder().isTracing(), juce::dontSendNotification);
+    traceButton.setTooltip ("Record what every thread is doing; press again to save the trace");
+    traceButton.onClick = [this] { traceButtonClicked(); };
+    addAndMakeVisible (traceButton);
+
+    corpusButton.setTooltip ("Write humanised MIDI files with the truth about every note's timing");
+    corpusButton.onClick = [this] { corpusButtonClicked(); };
+    addAndMakeVisible (corpusButton);
+
+   #if JUCE_UNIT_TESTS
+    testsButton.setTooltip ("Run the unit tests and benchmarks; details go to the debug log");
+    testsButton.onClick = [this] { testsButtonClicked(); };
+    addAndMakeVisible (testsButton);
+   #endif
+
+    exportButton.setEnabled (BlockProfiler::isEnabled);
+    resetButton.setEnabled (BlockProfiler::isEnabled);
+    traceButton.setEnabled (BlockProfiler::isEnabled);
+}
+
+void DiagnosticsPanel::update()
+{
+    if (! BlockProfiler::isEnabled)
+    {
+        reportLabel.setText ("Block timing is compiled out (POCKET_ENABLE_PROFILING=0)", juce::dontSendNotification);
+        return;
+    }
+
+    const auto& profiler = audioProcessor.getBlockProfiler();
+    const auto report = profiler.getReport();
+
+    const auto percent = [] (double fraction) { return juce::String (fraction * 100.0, fraction < 0.1 ? 2 : 1) + "%"; };
+
+    juce::String text;
+    text << "processBlock cost, share of the real-time budget (" << report.numBlocks << " blocks)\n"
+         << "p50 " << percent (report.p50) << " | p99 " << percent (report.p99)
+         << " | max " << percent (report.max) << " | mean " << percent (report.mean);
+
+    if (const auto& tracer = audioProcessor.getTraceRecorder(); tracer.isTracing())
+        text << " | tracing: " << tracer.getNumEvents() << " events";
+
+    reportLabel.setText (text, juce::dontSendNotification);
+
+    for (int b = 0; b < BlockProfiler::numBins; ++b)
+        binCounts[(size_t) b] = profiler.getBinCount (b);
+
+    repaint();
+}
+
+//==============================================================================
+void DiagnosticsPanel::paint (juce::Graphics& g)
+{
+    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId).darker (0.2f));
+
+    const auto maxCount = *std::max_element (binCounts.begin(), binCounts.end());
+
+    if (maxCount == 0)
+        return;
+
+    // Budget fractions from 0.01% to 200% on a log axis, with the budget itself marked
+    const auto chart = getLocalBounds().withTrimmedTop (36).reduced (4).toFloat();
+    const auto minLog = std::log (1.0e-4), maxLog = std::log (2.0);
+    const auto fractionToX = [&] (double fraction)
+    {
+        return chart.getX() + chart.getWidth() * (float) ((std::log (fraction) - minLog) / (maxLog - minLog));
+    };
+
+    // Square-root heights, so the rare slow blocks stay visible next to the typical ones
+    g.setColour (juce::Colours::lightblue.withAlpha (0.8f));
+
+    for (int b = 0; b < BlockProfiler::numBins; ++b)
+    {
+        if (binCounts[(size_t) b] == 0)
+            continue;
+
+        const auto range = BlockProfiler::getBinRange (b);
+        const auto x1 = juce::jlimit (chart.getX(), chart.getRight(), fractionToX (range.getStart()));
+        const auto x2 = juce::jlimit (chart.getX(), chart.getRight(), fractionToX (range.getEnd()));
+        const auto height = chart.getHeight() * std::sqrt ((float) binCounts[(size_t) b] / (float) maxCount);
+        g.fillRect (x1, chart.getBottom() - height, juce::jmax (1.0f, x2 - x1), height);
+    }
+
+    g.setColour (juce::Colours::orange);
+    g.drawVerticalLine (juce::roundToInt (fractionToX (1.0)), chart.getY(), chart.getBottom());
+
+    g.setColour (juce::Colours::grey);
+    g.setFont (11.0f);
+
+    for (auto fraction : { 0.001, 0.01, 0.1, 1.0 })
+        g.drawText (juce::String (fraction * 100.0) + "%", juce::Rectangle<float> (fractionToX (fraction) + 2.0f, chart.getY(), 40.0f, 12.0f),
+                    juce::Justification::topLeft);
+}
+
+void DiagnosticsPanel::resized()
+{
+    auto top = getLocalBounds().removeFromTop (36).reduced (4, 2);
+    corpusButton.setBounds (top.removeFromRight (65).withSizeKeepingCentre (60, 22));
+
+    if (testsButton.isVisible())
+        testsButton.setBounds (top.removeFromRight (55).withSizeKeepingCentre (50, 22));
+
+    traceButton.setBounds (top.removeFromRight (55).withSizeKeepingCentre (50, 22));
+    resetButton.setBounds (top.removeFromRight (55).withSizeKeepingCentre (55, 22));
+    exportButton.setBounds (top.removeFromRight (60).withSizeKeepingCentre (55, 22));
+    reportLabel.setBounds (top);
+}
+
+void DiagnosticsPanel::exportButtonClicked()
+{
+    const auto name = "Block profile " + juce::Time::getCurrentTime().formatted ("%Y-%m-%d %H-%M-%S");
+    const auto file = SessionRecorder::createDefaultFile().getParentDirectory()
+                          .getNonexistentChildFile (name, ".csv", false);
+
+    if (onMessage != nullptr)
+        onMessage (audioProcessor.getBlockProfiler().exportToFile (file) ? "Saved " + file.getFileName()
+                                                                         : "Couldn't save " + file.getFileName());
+}
+
+void DiagnosticsPanel::traceButtonClicked()
+{
+    auto& tracer = audioProcessor.getTraceRecorder();
+
+    if (traceButton.getToggleState())
+    {
+        tracer.start();
+        return;
+    }
+
+    const auto name = "Trace " + juce::Time::getCurrentTime().formatted ("%Y-%m-%d %H-%M-%S");
+    const auto file = SessionRecorder::createDefaultFile().getParentDirectory()
+                          .getNonexistentChildFile (name, ".json", false);
+
+    const auto saved = tracer.stop (file);
+
+    if (onMessage != nullptr)
+        onMessage (saved ? "Saved " + file.getFileName() + " (" + juce::String (tracer.getNumEvents()) + " events)"
+                         : "Couldn't save " + file.getFileName());
+}
+
+void DiagnosticsPanel::corpusButtonClicked()
+{
+    const auto name = "Corpus " + juce::Time::getCurrentTime().formatted ("%Y-%m-%d %H-%M-%S");
+    const auto folder = SessionRecorder::createDefaultFile().getParentDirectory().getNonexistentChildFile (name, {}, false);
+
+    // Each style steady and tight, then ramping, loose and untidy
+    int numWritten = 0, numFiles = 0;
+
+    for (int style = 0; style < CorpusGenerator::getStyleNames().size(); ++style)
+    {
+        CorpusGenerator::Settings steady;
+        steady.style = (CorpusGenerator::Style) style;
+        steady.seed = style + 1;
+
+        auto untidy = steady;
+        untidy.startBpm = 90.0;
+        untidy.endBpm = 130.0;
+        untidy.tempoWobbleBpm = 1.0;
+        untidy.swing = 0.6;
+        untidy.biasMs = 10.0;
+        untidy.jitterMs = 15.0;
+        untidy.outlierShare = 0.03;
+        untidy.flamShare = 0.05;
+        untidy.missShare = 0.03;
+        untidy.extraShare = 0.03;
+
+        const auto styleName = CorpusGenerator::getStyleNames()[style];
+
+        for (const auto& [settings, suffix] : { std::pair { steady, " steady" }, std::pair { untidy, " untidy" } })
+        {
+            ++numFiles;
+
+            if (CorpusGenerator (settings).writeFiles (folder.getChildFile (styleName + suffix + ".mid")))
+                ++numWritten;
+        }
+    }
+
+    if (onMessage != nullptr)
+        onMessage (numWritten == numFiles ? "Saved " + juce::String (numFiles) + " performances in " + folder.getFileName()
+                                          : "Couldn't save " + folder.getFileName());
+}
+
+void DiagnosticsPanel::testsButtonClicked()
+{
+    testsButton.setEnabled (false);
+
+    if (onMessage != nullptr)
+        onMessage ("Running tests...");
+
+    // The tests build their own processors and pools, so they can run beside this one
+    juce::Thread::launch ([safeThis = juce::Component::SafePointer<DiagnosticsPanel> (this)]
+    {
+        juce::UnitTestRunner runner;
+        runner.setAssertOnFailure (false);
+        runner.runTestsInCategory ("Pocket");
+
+        int numPasses = 0, numFailures = 0;
+
+        for (int i = 0; i < runner.getNumResults(); ++i)
+        {
+            numPasses += runner.getResult (i)->passes;
+            numFailures += runner.getResult (i)->failures;
+        }
+
+        juce::MessageManager::callAsync ([safeThis, numPasses, numFailures]
+        {
+            if (safeThis == nullptr)
+                return;
+
+            safeThis->testsButton.setEnabled (true);
+
+            if (safeThis->onMessage != nullptr)
+                safeThis->onMessage (numFailures == 0 ? "All " + juce::String (numPasses) + " checks passed"
+                                                      : juce::String (numFailures) + " checks failed (see the debug log)");
+        });
+    });
+}
@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    DiagnosticsPanel.h
+
+    Hidden panel with the plugin's own performance figures.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//==============================================================================
+/**
+    Shows how much of the real-time budget processBlock() takes: p50, p99 and
+    maximum, with the histogram behind them drawn on a logarithmic axis.
+    Export writes the figures as CSV next to the session logs. Trace records a
+    timeline of every thread until it's pressed again, then saves it as JSON for
+    Perfetto (ui.perfetto.dev) or chrome://tracing. Corpus writes humanised
+    drum, bass and keys performances with their ground truth, for checking
+    the timing analysis against known offsets. In builds with JUCE_UNIT_TESTS,
+    Tests runs the plugin's unit tests and benchmarks in the background.
+
+    The editor shows it in place of the log viewer when asked to (double-click
+    the playhead line, or press Ctrl/Cmd+Shift+D) and calls update() from its
+    timer while it's visible.
+*/
+class DiagnosticsPanel  : public juce::Component
+{
+public:
+    explicit DiagnosticsPanel (PocketAudioProcessor&);
+
+    void update();
+
+    /** Called with a short message for the status line, e.g. where a file was saved. */
+    std::function<void (const juce::String&)> onMessage;
+
+    //==============================================================================
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+private:
+    void exportButtonClicked();
+    void traceButtonClicked();
+    void corpusButtonClicked();
+    void testsButtonClicked();
+
+    PocketAudioProcessor& audioProcessor;
+
+    juce::Label reportLabel;
+    juce::TextButton exportButton { "Export" }, resetButton { "Reset" }, traceButton { "Trace" },
+                     corpusButton { "Corpus" }, testsButton { "Tests" };
+
+    std::array<juce::uint32, BlockProfiler::numBins> binCounts {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DiagnosticsPanel)
+};
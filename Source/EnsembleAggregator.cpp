@@ -0,0 +1,218 @@
+/*
+  ==============================================================================
+
+    EnsembleAggregator.cpp
+
+  ==============================================================================
+*/
+
+#include "EnsembleAggregator.h"
+
+//==============================================================================
+int EnsembleAggregator::addMember (const juce::String& name, std::function<bool()> isAnchor)
+{
+    auto member = std::make_unique<Member>();
+    member->name = name;
+    member->isAnchor = std::move (isAnchor);
+
+    const juce::ScopedLock sl (lock);
+    member->id = nextMemberId++;
+    members.push_back (std::move (member));
+    return members.back()->id;
+}
+
+void EnsembleAggregator::removeMember (int memberId)
+{
+    const juce::ScopedLock sl (lock);
+    members.erase (std::remove_if (members.begin(), members.end(),
+                                   [memberId] (const auto& m) { return m->id == memberId; }),
+                   members.end());
+}
+
+void EnsembleAggregator::setMemberName (int memberId, const juce::String& name)
+{
+    const juce::ScopedLock sl (lock);
+
+    if (auto* member = findMember (memberId))
+        member->name = name;
+}
+
+EnsembleAggregator::Member* EnsembleAggregator::findMember (int memberId) const
+{
+    for (auto& m : members)
+        if (m->id == memberId)
+            return m.get();
+
+    return nullptr;
+}
+
+//==============================================================================
+void EnsembleAggregator::Member::add (const TimingEvent& event) noexcept
+{
+    // A sustain press lands just after the beat, which says nothing about where the player sits
+    if (event.bar < 0 || event.isController)
+        return;
+
+    if (event.take != take)
+    {
+        bars.fill ({});
+        take = event.take;
+    }
+
+    auto& slot = bars[(size_t) (event.bar % historyBars)];
+
+    if (slot.bar != event.bar)
+        slot = { event.bar, 0.0, 0 };
+
+    slot.sumMs += event.deviationMs;
+    ++slot.count;
+}
+
+void EnsembleAggregator::addEvents (int memberId, const TimingEvent* events, int numEvents)
+{
+    const juce::ScopedLock sl (lock);
+
+    if (auto* member = findMember (memberId))
+        for (int i = 0; i < numEvents; ++i)
+            member->add (events[i]);
+}
+
+//==============================================================================
+EnsembleAggregator::Snapshot EnsembleAggregator::getSnapshot() const
+{
+    Snapshot snapshot;
+    const juce::ScopedLock sl (lock);
+    snapshot.numMembers = (int) members.size();
+
+    const auto anchorIt = std::find_if (members.begin(), members.end(),
+                                        [] (const auto& m) { return m->isAnchor != nullptr && m->isAnchor(); });
+
+    if (anchorIt == members.end())
+        return snapshot;
+
+    const auto& anchor = **anchorIt;
+    snapshot.anchorName = anchor.name;
+
+    for (const auto& member : members)
+    {
+        if (member.get() == &anchor)
+            continue;
+
+        const auto& player = *member;
+        PlayerOffset offset;
+        offset.name = player.name;
+
+        double sumMs = 0.0;
+        int latestBar = -1;
+
+        for (size_t s = 0; s < (size_t) historyBars; ++s)
+        {
+            const auto& a = anchor.bars[s];
+            const auto& p = player.bars[s];
+
+            if (a.bar < 0 || a.bar != p.bar || a.count == 0 || p.count == 0)
+                continue;
+
+            const auto barOffset = p.getMeanMs() - a.getMeanMs();
+            sumMs += barOffset;
+            ++offset.numBars;
+
+            if (a.bar > latestBar)
+            {
+                latestBar = a.bar;
+                offset.lastBarMs = barOffset;
+            }
+        }
+
+        if (offset.numBars > 0)
+            offset.averageMs = sumMs / offset.numBars;
+
+        snapshot.players.add (offset);
+    }
+
+    return snapshot;
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class EnsembleAggregatorTests  : public juce::UnitTest
+{
+public:
+    EnsembleAggregatorTests()  : juce::UnitTest ("EnsembleAggregator", "Pocket") {}
+
+    void runTest() override
+    {
+        beginTest ("A new take replaces the bars of the old one");
+
+        EnsembleAggregator aggregator;
+        const auto anchor = aggregator.addMember ("Kick", [] { return true; });
+        const auto player = aggregator.addMember ("Bass", [] { return false; });
+
+        // Four bars per take, as when the host loops over bars 5-8
+        const auto playTake = [&] (juce::uint16 take, double playerOffsetMs)
+        {
+            for (int bar = 5; bar < 9; ++bar)
+            {
+                TimingEvent event;
+                event.bar = bar;
+                event.take = take;
+
+                aggregator.addEvents (anchor, &event, 1);
+                event.deviationMs = playerOffsetMs;
+                aggregator.addEvents (player, &event, 1);
+            }
+        };
+
+        playTake (1, 20.0);
+        playTake (2, -10.0);
+
+        auto snapshot = aggregator.getSnapshot();
+        expectEquals (snapshot.anchorName, juce::String ("Kick"));
+        expectEquals (snapshot.players.size(), 1);
+        expectEquals (snapshot.players[0].numBars, 4);
+        expectWithinAbsoluteError (snapshot.players[0].averageMs, -10.0, 1.0e-9);
+        expectWithinAbsoluteError (snapshot.players[0].lastBarMs, -10.0, 1.0e-9);
+
+        beginTest ("Pedal crossings between the notes are left out");
+        {
+            EnsembleAggregator pedalled;
+            const auto kick = pedalled.addMember ("Kick", [] { return true; });
+            const auto keys = pedalled.addMember ("Keys", [] { return false; });
+
+            for (int bar = 0; bar < 4; ++bar)
+            {
+                TimingEvent note;
+                note.bar = bar;
+                note.take = 1;
+
+                pedalled.addEvents (kick, &note, 1);
+
+                note.deviationMs = 5.0;
+                auto pedal = note;
+                pedal.note = 64;
+                pedal.deviationMs = 60.0;
+                pedal.isController = true;
+
+                const TimingEvent batch[] = { note, pedal, note };
+                pedalled.addEvents (keys, batch, 3);
+            }
+
+            const auto offsets = pedalled.getSnapshot();
+            expectEquals (offsets.players[0].numBars, 4);
+            expectWithinAbsoluteError (offsets.players[0].averageMs, 5.0, 1.0e-9);
+        }
+
+        beginTest ("Bars of one take still add up");
+
+        playTake (2, -30.0);
+
+        snapshot = aggregator.getSnapshot();
+        expectEquals (snapshot.players[0].numBars, 4);
+        expectWithinAbsoluteError (snapshot.players[0].averageMs, -20.0, 1.0e-9);
+    }
+};
+
+static EnsembleAggregatorTests ensembleAggregatorTests;
+
+#endif
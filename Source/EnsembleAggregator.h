@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    EnsembleAggregator.h
+
+    Process-wide hub that every Pocket instance registers with, so that the
+    timing of several players can be compared bar by bar.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TimingEvent.h"
+
+//==============================================================================
+/**
+    Collects the note events of all Pocket instances in the host process and
+    works out how far each player sits from the anchor, typically the kick or
+    click track. The anchor is chosen by the user, with the Ensemble Anchor
+    parameter of that track's instance: each member is registered with a
+    function saying whether it's asked to be the anchor. If several are, the
+    one registered first wins; if none is, no offsets are reported.
+
+    Bars are numbered by the instances themselves (from the host's bar count
+    or last bar start where it reports them), so all instances of one host
+    agree on them, whatever the meter. Each player's bars are remembered for its
+    current take only: when the host loops back or records again, bar 5 of the
+    new take replaces bar 5 of the old one, rather than being added onto it.
+
+    Share it with juce::SharedResourcePointer<EnsembleAggregator>. The audio
+    threads never call into the aggregator: each instance's notes travel through
+    its own TimingEventFifo and are merged here by the shared analysis workers,
+    so the lock below is only ever taken by worker and message threads.
+*/
+class EnsembleAggregator
+{
+public:
+    EnsembleAggregator() = default;
+
+    //==============================================================================
+    /** Registers a player and returns the id to report its events under.
+        isAnchor is called on the message thread, and must be safe to call there.
+    */
+    int addMember (const juce::String& name, std::function<bool()> isAnchor);
+    void removeMember (int memberId);
+    void setMemberName (int memberId, const juce::String& name);
+
+    /** Worker thread: merges a batch of one player's notes into the per-bar statistics.
+        Pedal crossings in the batch are skipped.
+    */
+    void addEvents (int memberId, const TimingEvent* events, int numEvents);
+
+    //==============================================================================
+    /** Where one player sits relative to the anchor. Positive = behind. */
+    struct PlayerOffset
+    {
+        juce::String name;
+        double lastBarMs = 0.0;     // Offset in the most recent bar both players played in
+        double averageMs = 0.0;     // Mean offset across the remembered bars
+        int numBars = 0;            // How many shared bars the average is based on
+    };
+
+    struct Snapshot
+    {
+        juce::String anchorName;            // Empty if no member is the anchor
+        juce::Array<PlayerOffset> players;
+        int numMembers = 0;
+    };
+
+    /** Message thread: returns the current offsets of every player against the anchor. */
+    Snapshot getSnapshot() const;
+
+private:
+    //==============================================================================
+    static constexpr int historyBars = 32;
+
+    struct BarSlot
+    {
+        int bar = -1;
+        double sumMs = 0.0;
+        int count = 0;
+
+        double getMeanMs() const noexcept   { return count > 0 ? sumMs / count : 0.0; }
+    };
+
+    struct Member
+    {
+        int id = 0;
+        juce::String name;
+        std::function<bool()> isAnchor;
+        std::array<BarSlot, historyBars> bars;
+        int take = -1;                      // The take the bars belong to
+
+        void add (const TimingEvent&) noexcept;
+    };
+
+    Member* findMember (int memberId) const;
+
+    juce::CriticalSection lock;
+    std::vector<std::unique_ptr<Member>> members;
+    int nextMemberId = 1;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EnsembleAggregator)
+};
@@ -0,0 +1,256 @@
+/*
+  ==============================================================================
+
+    GrooveDetector.cpp
+
+  ==============================================================================
+*/
+
+#include "GrooveDetector.h"
+
+namespace
+{
+    // Division indices from coarsest to finest step
+    constexpr std::array<int, 5> coarseToFine { 0, 1, 3, 2, 4 };
+
+    // Grows each new note's weight so that older notes count half as much after halfLifeNotes
+    const float weightGrowth = std::pow (2.0f, 1.0f / (float) GrooveDetector::halfLifeNotes);
+}
+
+//==============================================================================
+void GrooveDetector::addNotes (const TimingEvent* events, int numEvents, double latencyMs)
+{
+    if (numEvents <= 0)
+        return;
+
+    for (int i = 0; i < numEvents; ++i)
+    {
+        // Sustain presses tend to land just after the beat, which isn't where the grid is
+        if (events[i].isController)
+            continue;
+
+        addNote (events[i].ppq - latencyMs * events[i].bpm / 60000.0);
+    }
+
+    updateEstimate();
+}
+
+void GrooveDetector::reset()
+{
+    for (auto& histogram : histograms)
+        histogram.fill (0.0f);
+
+    noteWeight = 1.0f;
+    totalWeight = 0.0f;
+    division = -1;
+    swing = 0.5;
+    confidence = 0.0f;
+}
+
+GrooveDetector::Estimate GrooveDetector::getEstimate() const noexcept
+{
+    return { division.load(), swing.load(), confidence.load() };
+}
+
+//==============================================================================
+void GrooveDetector::addNote (double ppq)
+{
+    for (int d = 0; d < numDivisions; ++d)
+    {
+        const auto pairLength = 2.0 * GridSettings::getDivisionStepPpq (d);
+        const auto phase = ppq / pairLength - std::floor (ppq / pairLength);
+        // Round to the nearest bin, so that notes on a grid point land in the middle of its bin
+        histograms[(size_t) d][(size_t) ((int) std::floor (phase * numBins + 0.5) % numBins)] += noteWeight;
+    }
+
+    totalWeight += noteWeight;
+    noteWeight *= weightGrowth;
+
+    // Rescale now and then rather than let the weights overflow
+    if (noteWeight > 1.0e6f)
+    {
+        for (auto& histogram : histograms)
+            for (auto& bin : histogram)
+                bin /= noteWeight;
+
+        totalWeight /= noteWeight;
+        noteWeight = 1.0f;
+    }
+}
+
+void GrooveDetector::updateEstimate()
+{
+    // Roughly how many recent notes the histograms hold
+    const auto effectiveNotes = totalWeight / noteWeight;
+
+    if (effectiveNotes < 8.0f)
+        return;
+
+    // Grid points catch notes within 10% of the pair, i.e. 20% of a step
+    constexpr int tolerance = numBins / 10;
+
+    for (auto d : coarseToFine)
+    {
+        const auto& histogram = histograms[(size_t) d];
+
+        const auto binAt = [&histogram] (int b) { return histogram[(size_t) ((b + numBins) % numBins)]; };
+
+        const auto windowSum = [&binAt] (int centre)
+        {
+            auto sum = 0.0f;
+
+            for (int b = centre - tolerance; b <= centre + tolerance; ++b)
+                sum += binAt (b);
+
+            return sum;
+        };
+
+        // The swung step lies between 50% (straight) and 75% of the pair
+        auto swungBin = numBins / 2;
+
+        for (int b = numBins / 2 + 1; b <= numBins * 3 / 4; ++b)
+            if (windowSum (b) > windowSum (swungBin))
+                swungBin = b;
+
+        const auto fit = (windowSum (0) + windowSum (swungBin)) / totalWeight;
+
+        if (fit < requiredFit)
+            continue;
+
+        // Refine the swing to the centre of mass around the peak
+        auto weightedSum = 0.0f, weight = 0.0f;
+
+        for (int b = swungBin - tolerance; b <= swungBin + tolerance; ++b)
+        {
+            weightedSum += binAt (b) * (float) b;
+            weight += binAt (b);
+        }
+
+        const auto newSwing = juce::jlimit (0.5, 0.75, (double) (weightedSum / juce::jmax (weight, 1.0e-6f)) / numBins);
+        const auto newConfidence = fit * juce::jmin (1.0f, effectiveNotes / 32.0f);
+
+        confidence = newConfidence;
+
+        if (newConfidence >= minConfidence
+             && (d != division.load() || std::abs (newSwing - swing.load()) >= swingHysteresis))
+        {
+            swing = std::round (newSwing * 200.0) / 200.0;
+            division = d;
+        }
+
+        return;
+    }
+
+    confidence = 0.0f;
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class GrooveDetectorTests  : public juce::UnitTest
+{
+public:
+    GrooveDetectorTests()  : juce::UnitTest ("GrooveDetector", "Pocket") {}
+
+    void runTest() override
+    {
+        const auto divisionNames = GridSettings::getDivisionNames();
+
+        // Plays numPairs pairs of steps of the given length, the second one delayed to swing
+        const auto detect = [] (double stepPpq, double swingRatio, int numPairs)
+        {
+            std::vector<TimingEvent> events;
+
+            for (int i = 0; i < numPairs; ++i)
+            {
+                for (auto phase : { 0.0, swingRatio })
+                {
+                    TimingEvent event;
+                    event.ppq = 2.0 * stepPpq * (i + phase);
+                    event.bpm = 120.0;
+                    events.push_back (event);
+                }
+            }
+
+            GrooveDetector detector;
+            detector.addNotes (events.data(), (int) events.size(), 0.0);
+            return detector.getEstimate();
+        };
+
+        beginTest ("Quantised straight eighths");
+        {
+            const auto estimate = detect (0.5, 0.5, 128);
+            expectEquals (divisionNames[estimate.division], juce::String ("1/8"));
+            expectEquals (estimate.swing, 0.5);
+            expectGreaterOrEqual (estimate.confidence, 0.9f);
+        }
+
+        beginTest ("Swung sixteenths");
+        {
+            const auto estimate = detect (0.25, 0.6, 128);
+            expectEquals (divisionNames[estimate.division], juce::String ("1/16"));
+            expectWithinAbsoluteError (estimate.swing, 0.6, 0.0051);
+        }
+
+        beginTest ("Eighth-note triplets");
+        {
+            // Three notes per beat: straight on the triplet grid, not a heavily swung 1/8
+            std::vector<TimingEvent> events;
+
+            for (int i = 0; i < 256; ++i)
+            {
+                TimingEvent event;
+                event.ppq = i / 3.0;
+                event.bpm = 120.0;
+                events.push_back (event);
+            }
+
+            GrooveDetector detector;
+            detector.addNotes (events.data(), (int) events.size(), 0.0);
+            const auto estimate = detector.getEstimate();
+
+            expectEquals (divisionNames[estimate.division], juce::String ("1/8T"));
+            expectEquals (estimate.swing, 0.5);
+        }
+
+        beginTest ("Pedal crossings between the notes are left out");
+        {
+            // Straight eighths, with a sustain press a 32nd after every beat
+            std::vector<TimingEvent> events;
+
+            for (int i = 0; i < 256; ++i)
+            {
+                TimingEvent note;
+                note.ppq = i * 0.5;
+                note.bpm = 120.0;
+                events.push_back (note);
+
+                if (i % 2 == 0)
+                {
+                    auto pedal = note;
+                    pedal.ppq += 0.125;
+                    pedal.note = 64;
+                    pedal.isController = true;
+                    events.push_back (pedal);
+                }
+            }
+
+            GrooveDetector detector;
+            detector.addNotes (events.data(), (int) events.size(), 0.0);
+            const auto estimate = detector.getEstimate();
+
+            expectEquals (divisionNames[estimate.division], juce::String ("1/8"));
+            expectEquals (estimate.swing, 0.5);
+            expectGreaterOrEqual (estimate.confidence, 0.9f);
+        }
+
+        beginTest ("Too few notes give no estimate");
+        {
+            expectEquals (detect (0.5, 0.5, 3).division, -1);
+        }
+    }
+};
+
+static GrooveDetectorTests grooveDetectorTests;
+
+#endif
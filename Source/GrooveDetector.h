@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    GrooveDetector.h
+
+    Works out the grid and swing being played from the notes themselves.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include "TimingEvent.h"
+#include "TimingGrid.h"
+
+//==============================================================================
+/**
+    Estimates which grid division is being played and how much it swings, for
+    the "Auto" grid setting.
+
+    For every division, notes are folded onto one pair of grid steps (the unit
+    swing works on) and counted in a circular phase histogram. Older notes fade
+    out with a half-life of halfLifeNotes, so the estimate follows changes in
+    the music. Adding a note touches one bin per division, so it's O(1).
+
+    The estimate reads the histograms: for each division it finds the swung
+    second step (the peak between 50% and 75% of the pair), then how much of the
+    weight lies close to the two grid points. The coarsest division that explains
+    nearly all notes wins, since a finer grid fits anything a coarser one does.
+
+    addNotes() must only be called from one thread (the analysis worker);
+    getEstimate() is lock-free and safe anywhere, including the audio thread.
+*/
+class GrooveDetector
+{
+public:
+    GrooveDetector() = default;
+
+    struct Estimate
+    {
+        int division = -1;          // Index into GridSettings::getDivisionNames(), or -1 if unsure
+        double swing = 0.5;
+        float confidence = 0.0f;    // 0 to 1
+    };
+
+    /** Adds notes and updates the estimate. The latency offset is removed first,
+        and pedal crossings are skipped.
+    */
+    void addNotes (const TimingEvent* events, int numEvents, double latencyMs);
+
+    /** Forgets the playing so far, e.g. when a new session starts. Same thread as addNotes(). */
+    void reset();
+
+    /** The last estimate that was confident enough. Changes only when the division
+        changes or the swing moves by a noticeable amount, so a grid built from it
+        doesn't keep triggering re-analysis.
+    */
+    Estimate getEstimate() const noexcept;
+
+    static constexpr int numBins = 96;
+    static constexpr int halfLifeNotes = 64;
+
+private:
+    void addNote (double ppq);
+    void updateEstimate();
+
+    static constexpr int numDivisions = 5;
+    std::array<std::array<float, numBins>, numDivisions> histograms {};
+    float noteWeight = 1.0f;        // Grows instead of decaying every bin
+    float totalWeight = 0.0f;
+
+    std::atomic<int> division { -1 };
+    std::atomic<double> swing { 0.5 };
+    std::atomic<float> confidence { 0.0f };
+
+    static constexpr float requiredFit = 0.8f;
+    static constexpr float minConfidence = 0.5f;
+    static constexpr double swingHysteresis = 0.02;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GrooveDetector)
+};
@@ -0,0 +1,239 @@
+/*
+  ==============================================================================
+
+    LatencyCalibrator.cpp
+
+  ==============================================================================
+*/
+
+#include "LatencyCalibrator.h"
+
+//==============================================================================
+void LatencyCalibrator::process (juce::AudioBuffer<float>& buffer, juce::int64 blockStartSample, double sampleRate) noexcept
+{
+    if (cancelRequested.exchange (false))
+        active = false;
+
+    if (startRequested.exchange (false))
+    {
+        currentSampleRate = sampleRate;
+        samplesPerBeat = sampleRate * 60.0 / bpm;
+        clickLength = (int) (0.03 * sampleRate);
+
+        // Leave a moment before the first click
+        firstClickSample = blockStartSample + (juce::int64) (0.5 * sampleRate);
+        lastClickSample = firstClickSample
+                            + (juce::int64) (samplesPerBeat * (countInBeats + std::floor (durationSeconds * bpm / 60.0)));
+        nextClick = 0;
+        numTaps = 0;
+        progress = 0.0f;
+        finished = false;
+        active = true;
+    }
+
+    if (! active.load())
+        return;
+
+    const auto blockEnd = blockStartSample + buffer.getNumSamples();
+    auto nextClickSample = getClickSample (nextClick);
+
+    for (int i = 0; i < buffer.getNumSamples(); ++i)
+    {
+        if (blockStartSample + i == nextClickSample && nextClickSample <= lastClickSample)
+        {
+            clickSamplesLeft = clickLength;
+            clickPhase = 0.0;
+            nextClickSample = getClickSample (++nextClick);
+        }
+
+        if (clickSamplesLeft > 0)
+        {
+            const auto envelope = (float) clickSamplesLeft / (float) clickLength;
+            const auto value = 0.5f * envelope * envelope * (float) std::sin (clickPhase);
+            clickPhase += juce::MathConstants<double>::twoPi * 1000.0 / currentSampleRate;
+            --clickSamplesLeft;
+
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                buffer.addSample (channel, i, value);
+        }
+    }
+
+    progress = (float) juce::jlimit (0.0, 1.0, (double) (blockEnd - firstClickSample) / (double) (lastClickSample - firstClickSample));
+
+    // Allow half a beat after the last click for its tap
+    if (blockEnd > lastClickSample + (juce::int64) (samplesPerBeat / 2))
+    {
+        active = false;
+        finished = true;
+    }
+}
+
+juce::int64 LatencyCalibrator::getClickSample (int click) const noexcept
+{
+    return firstClickSample + (juce::int64) std::round (click * samplesPerBeat);
+}
+
+void LatencyCalibrator::addTap (juce::int64 sampleTime) noexcept
+{
+    if (! active.load())
+        return;
+
+    const auto beat = (double) (sampleTime - firstClickSample) / samplesPerBeat;
+    const auto nearestBeat = std::round (beat);
+
+    if (nearestBeat < countInBeats || nearestBeat > (double) (lastClickSample - firstClickSample) / samplesPerBeat)
+        return;
+
+    if (const auto n = numTaps.load (std::memory_order_relaxed); n < (int) tapOffsetsMs.size())
+    {
+        tapOffsetsMs[(size_t) n] = (float) ((beat - nearestBeat) * samplesPerBeat * 1000.0 / currentSampleRate);
+        numTaps.store (n + 1, std::memory_order_release);
+    }
+}
+
+//==============================================================================
+LatencyCalibrator::Result LatencyCalibrator::getResult() const
+{
+    Result result;
+    result.numTaps = numTaps.load (std::memory_order_acquire);
+
+    if (result.numTaps == 0)
+        return result;
+
+    std::vector<float> offsets (tapOffsetsMs.begin(), tapOffsetsMs.begin() + result.numTaps);
+
+    const auto median = [] (std::vector<float>& values)
+    {
+        const auto middle = values.begin() + (std::ptrdiff_t) (values.size() / 2);
+        std::nth_element (values.begin(), middle, values.end());
+        auto m = (double) *middle;
+
+        if (values.size() % 2 == 0)
+            m = 0.5 * (m + (double) *std::max_element (values.begin(), middle));
+
+        return m;
+    };
+
+    result.offsetMs = median (offsets);
+
+    for (auto& offset : offsets)
+        offset = std::abs (offset - (float) result.offsetMs);
+
+    result.spreadMs = 1.4826 * median (offsets);
+
+    // The median's standard error is about 1.25 times that of the mean
+    result.standardErrorMs = 1.2533 * result.spreadMs / std::sqrt ((double) result.numTaps);
+    return result;
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class LatencyCalibratorTests  : public juce::UnitTest
+{
+public:
+    LatencyCalibratorTests()  : juce::UnitTest ("LatencyCalibrator", "Pocket") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 512;
+        constexpr auto samplesPerMs = sampleRate / 1000.0;
+        const auto samplesPerBeat = sampleRate * 60.0 / LatencyCalibrator::bpm;
+
+        // The first click falls half a second after the block that starts the calibration
+        constexpr juce::int64 startSample = 1000;
+        const auto firstClickSample = startSample + (juce::int64) (0.5 * sampleRate);
+
+        const auto tapTime = [&] (int beat, double offsetMs)
+        {
+            return firstClickSample + (juce::int64) std::round (beat * samplesPerBeat + offsetMs * samplesPerMs);
+        };
+
+        // Starts a calibration, taps the given offsets from the first counted beat on, and runs it to the end
+        const auto calibrate = [&] (LatencyCalibrator& calibrator, const std::vector<double>& offsetsMs)
+        {
+            juce::AudioBuffer<float> buffer (2, blockSize);
+            buffer.clear();
+
+            calibrator.start();
+            calibrator.process (buffer, startSample, sampleRate);
+            expect (calibrator.isActive());
+
+            // Count-in taps, however far off, aren't counted
+            for (int beat = 0; beat < LatencyCalibrator::countInBeats; ++beat)
+                calibrator.addTap (tapTime (beat, 40.0));
+
+            for (size_t i = 0; i < offsetsMs.size(); ++i)
+                calibrator.addTap (tapTime (LatencyCalibrator::countInBeats + (int) i, offsetsMs[i]));
+
+            float peak = 0.0f;
+
+            for (auto sample = startSample + blockSize; ! calibrator.isFinished(); sample += blockSize)
+            {
+                expect (sample < firstClickSample + (juce::int64) ((LatencyCalibrator::durationSeconds + 10.0) * sampleRate));
+                buffer.clear();
+                calibrator.process (buffer, sample, sampleRate);
+                peak = juce::jmax (peak, buffer.getMagnitude (0, blockSize));
+            }
+
+            expect (! calibrator.isActive());
+            expectEquals (calibrator.getProgress(), 1.0f);
+            expect (peak > 0.1f, "The clicks reach the output");
+
+            return calibrator.getResult();
+        };
+
+        beginTest ("An odd number of taps");
+        {
+            LatencyCalibrator calibrator;
+
+            // Taps before a calibration starts are ignored
+            calibrator.addTap (firstClickSample);
+            expectEquals (calibrator.getResult().numTaps, 0);
+
+            // Sorted: -2, 4, 4, 5, 6, 7, 8, 9, 40 (one stray tap) - median 6.
+            // Deviations sorted: 0, 1, 1, 2, 2, 2, 3, 8, 34 - median 2.
+            const auto result = calibrate (calibrator, { 4.0, 9.0, -2.0, 6.0, 40.0, 5.0, 8.0, 4.0, 7.0 });
+
+            expectEquals (result.numTaps, 9);
+            expectWithinAbsoluteError (result.offsetMs, 6.0, 1.0e-3);
+            expectWithinAbsoluteError (result.spreadMs, 1.4826 * 2.0, 1.0e-3);
+            expectWithinAbsoluteError (result.standardErrorMs, 1.2533 * 1.4826 * 2.0 / 3.0, 1.0e-3);
+        }
+
+        beginTest ("An even number of taps averages the middle two");
+        {
+            LatencyCalibrator calibrator;
+
+            // Median (3 + 5) / 2 = 4; deviations 1, 1, 3, 7 - median 2
+            const auto result = calibrate (calibrator, { 11.0, 3.0, 1.0, 5.0 });
+
+            expectEquals (result.numTaps, 4);
+            expectWithinAbsoluteError (result.offsetMs, 4.0, 1.0e-3);
+            expectWithinAbsoluteError (result.spreadMs, 1.4826 * 2.0, 1.0e-3);
+            expectWithinAbsoluteError (result.standardErrorMs, 1.2533 * 1.4826 * 2.0 / 2.0, 1.0e-3);
+        }
+
+        beginTest ("Early taps and a restart");
+        {
+            LatencyCalibrator calibrator;
+            calibrate (calibrator, { 20.0, 20.0, 20.0 });
+
+            // A new calibration forgets the last one's taps
+            const auto result = calibrate (calibrator, { -12.0, -10.0, -10.0, -10.0, -8.0 });
+
+            expectEquals (result.numTaps, 5);
+            expectWithinAbsoluteError (result.offsetMs, -10.0, 1.0e-3);
+            expectWithinAbsoluteError (result.spreadMs, 0.0, 1.0e-3);
+
+            // Taps after the calibration has finished aren't counted
+            calibrator.addTap (tapTime (LatencyCalibrator::countInBeats + 10, 0.0));
+            expectEquals (calibrator.getResult().numTaps, 5);
+        }
+    }
+};
+
+static LatencyCalibratorTests latencyCalibratorTests;
+
+#endif
@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    LatencyCalibrator.h
+
+    Measures the fixed latency between the player hearing a click and their
+    note reaching the plugin.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+//==============================================================================
+/**
+    Plays a click on the audio output and times the player's taps against it.
+
+    The offset between a tap and its nearest click includes everything the
+    deviations are biased by: the audio output reaching the player's ears, the
+    controller or e-kit, and the MIDI interface. Its median over the calibration
+    is a robust estimate of that latency (stray taps barely move it), and the
+    median absolute deviation gives its spread.
+
+    Clicks are placed on the processor's sample clock, so calibration works with
+    the host's transport stopped, and taps are timed on the same clock.
+
+    start(), isFinished() and getResult() are for the message thread; everything
+    else is called on the audio thread.
+*/
+class LatencyCalibrator
+{
+public:
+    LatencyCalibrator() = default;
+
+    struct Result
+    {
+        double offsetMs = 0.0;          // Median tap lateness (positive = late)
+        double spreadMs = 0.0;          // Robust standard deviation of the taps (1.4826 x MAD)
+        double standardErrorMs = 0.0;   // Uncertainty of the offset itself
+        int numTaps = 0;
+    };
+
+    /** Message thread: asks the audio thread to start a new calibration. */
+    void start() noexcept           { finished = false; startRequested = true; }
+    void cancel() noexcept          { cancelRequested = true; }
+
+    bool isActive() const noexcept  { return active.load(); }
+    bool isFinished() const noexcept    { return finished.load(); }
+
+    /** 0 to 1 through the calibration. */
+    float getProgress() const noexcept  { return progress.load(); }
+
+    /** Message thread, once isFinished(): the estimate from the taps so far. */
+    Result getResult() const;
+
+    //==============================================================================
+    /** Audio thread: starts or stops as requested, and adds this block's clicks. */
+    void process (juce::AudioBuffer<float>& buffer, juce::int64 blockStartSample, double sampleRate) noexcept;
+
+    /** Audio thread: a note-on arrived at this sample time. */
+    void addTap (juce::int64 sampleTime) noexcept;
+
+    static constexpr double bpm = 100.0;
+    static constexpr int countInBeats = 4;      // Clicked, but taps aren't counted yet
+    static constexpr double durationSeconds = 30.0;
+    static constexpr int minTaps = 8;
+
+private:
+    juce::int64 getClickSample (int click) const noexcept;
+
+    std::atomic<bool> startRequested { false }, cancelRequested { false };
+    std::atomic<bool> active { false }, finished { false };
+    std::atomic<float> progress { 0.0f };
+
+    // Written by the audio thread while active; read by the message thread once finished
+    std::array<float, 256> tapOffsetsMs {};
+    std::atomic<int> numTaps { 0 };
+
+    juce::int64 firstClickSample = 0, lastClickSample = 0;
+    double samplesPerBeat = 0.0, currentSampleRate = 44100.0;
+    int nextClick = 0;
+    int clickSamplesLeft = 0, clickLength = 0;
+    double clickPhase = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LatencyCalibrator)
+};
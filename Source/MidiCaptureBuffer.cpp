@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+    MidiCaptureBuffer.cpp
+
+  ==============================================================================
+*/
+
+#include "MidiCaptureBuffer.h"
+
+static_assert (juce::isPowerOfTwo (MidiCaptureBuffer::capacity), "The ring index is masked");
+
+//==============================================================================
+MidiCaptureBuffer::MidiCaptureBuffer()
+    : events ((size_t) capacity)
+{
+}
+
+void MidiCaptureBuffer::add (const juce::uint8* data, int numBytes, juce::int64 sampleTime) noexcept
+{
+    if (numBytes != 3)
+        return;
+
+    const auto type = data[0] & 0xf0;
+
+    if (type != 0x80 && type != 0x90 && ! (type == 0xb0 && data[1] == 64))
+        return;
+
+    // Only the audio thread writes, so a relaxed load of our own counter is enough
+    const auto index = numWritten.load (std::memory_order_relaxed);
+    auto& event = events[(size_t) (index & (capacity - 1))];
+    event.sampleTime = sampleTime;
+    std::memcpy (event.data, data, 3);
+
+    numWritten.store (index + 1, std::memory_order_release);
+}
+
+std::vector<MidiCaptureBuffer::Event> MidiCaptureBuffer::getRecentEvents (double seconds) const
+{
+    const auto end = numWritten.load (std::memory_order_acquire);
+    const auto begin = juce::jmax ((juce::int64) 0, end - capacity);
+
+    std::vector<Event> result;
+    result.reserve ((size_t) (end - begin));
+
+    for (auto i = begin; i < end; ++i)
+        result.push_back (events[(size_t) (i & (capacity - 1))]);
+
+    // Anything the audio thread wrapped around onto while we were copying (including
+    // a slot it may be half-way through writing) can't be trusted, so drop it. The
+    // fence keeps the copy's reads from moving after the counter is read again.
+    std::atomic_thread_fence (std::memory_order_acquire);
+    const auto endAfterCopy = numWritten.load (std::memory_order_relaxed);
+    const auto firstIntact = juce::jlimit (begin, end, endAfterCopy + 1 - capacity);
+    result.erase (result.begin(), result.begin() + (ptrdiff_t) (firstIntact - begin));
+
+    if (result.empty())
+        return result;
+
+    const auto cutoff = result.back().sampleTime - (juce::int64) (seconds * sampleRate.load());
+    const auto first = std::lower_bound (result.begin(), result.end(), cutoff,
+                                         [] (const Event& e, juce::int64 t) { return e.sampleTime < t; });
+    result.erase (result.begin(), first);
+    return result;
+}
+
+//==============================================================================
+juce::MidiFile MidiCaptureBuffer::createMidiFile (const std::vector<Event>& events, double sampleRate)
+{
+    constexpr int ticksPerQuarter = 960;
+    constexpr double ticksPerSecond = ticksPerQuarter * 2.0;    // At 120 bpm
+
+    juce::MidiMessageSequence sequence;
+    sequence.addEvent (juce::MidiMessage::tempoMetaEvent (500000));
+
+    if (! events.empty())
+    {
+        const auto start = events.front().sampleTime;
+
+        for (const auto& e : events)
+        {
+            const auto ticks = (double) (e.sampleTime - start) / sampleRate * ticksPerSecond;
+            sequence.addEvent (juce::MidiMessage (e.data, 3, ticks));
+        }
+    }
+
+    sequence.updateMatchedPairs();
+
+    juce::MidiFile file;
+    file.setTicksPerQuarterNote (ticksPerQuarter);
+    file.addTrack (sequence);
+    return file;
+}
+
+bool MidiCaptureBuffer::exportToFile (const juce::File& file, double seconds) const
+{
+    const auto midiFile = createMidiFile (getRecentEvents (seconds), sampleRate.load());
+
+    if (! file.getParentDirectory().createDirectory())
+        return false;
+
+    juce::FileOutputStream out (file);
+
+    if (out.failedToOpen())
+        return false;
+
+    out.setPosition (0);
+    out.truncate();
+    return midiFile.writeTo (out);
+}
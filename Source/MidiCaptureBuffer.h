@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    MidiCaptureBuffer.h
+
+    Always-on capture of the most recent notes, whether or not the host's
+    transport is running.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+//==============================================================================
+/**
+    A fixed-size ring that keeps the last few minutes of note-on, note-off and
+    sustain pedal messages, each stamped with the processor's sample clock.
+
+    The ring is allocated once up front; add() just copies a few bytes, so it's
+    safe to call for every incoming message on the audio thread. The oldest
+    events are overwritten once the ring is full.
+
+    getRecentEvents() may be called from any other thread while the audio thread
+    keeps adding: it copies the ring and discards anything that was overwritten
+    during the copy.
+*/
+class MidiCaptureBuffer
+{
+public:
+    MidiCaptureBuffer();
+
+    struct Event
+    {
+        juce::int64 sampleTime = 0;
+        juce::uint8 data[3] {};
+    };
+
+    /** Ignores everything except note-ons, note-offs and CC64. Audio thread only. */
+    void add (const juce::uint8* data, int numBytes, juce::int64 sampleTime) noexcept;
+
+    /** The sample rate used to turn sample times into seconds (call from prepareToPlay). */
+    void setSampleRate (double newSampleRate) noexcept     { sampleRate = newSampleRate; }
+    double getSampleRate() const noexcept                   { return sampleRate.load(); }
+
+    /** Copies the captured events from the last `seconds` before the newest one, oldest first. */
+    std::vector<Event> getRecentEvents (double seconds) const;
+
+    /** The total number of events captured so far, including overwritten ones. */
+    juce::int64 getNumEventsCaptured() const noexcept       { return numWritten.load(); }
+
+    //==============================================================================
+    /** Builds a single-track MIDI file (960 ticks per quarter at 120 bpm) with the
+        first event at time zero.
+    */
+    static juce::MidiFile createMidiFile (const std::vector<Event>& events, double sampleRate);
+
+    /** Writes the last `seconds` of capture to a .mid file. */
+    bool exportToFile (const juce::File& file, double seconds) const;
+
+    static constexpr int capacity = 1 << 16;           // ~27 minutes at 20 notes (on + off) per second
+    static constexpr double defaultWindowSeconds = 10.0 * 60.0;
+
+private:
+    std::vector<Event> events;
+    std::atomic<juce::int64> numWritten { 0 };
+    std::atomic<double> sampleRate { 44100.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiCaptureBuffer)
+};
@@ -0,0 +1,217 @@
+/*
+  ==============================================================================
+
+    MidiTimestampMonitor.cpp
+
+  ==============================================================================
+*/
+
+#include "MidiTimestampMonitor.h"
+#include <numeric>
+
+//==============================================================================
+void MidiTimestampMonitor::addNote (int samplePosition, int blockSize) noexcept
+{
+    if (blockSize <= 0)
+        return;
+
+    // Only the audio thread writes, so plain load/store pairs are enough
+    const auto relaxed = std::memory_order_relaxed;
+    const auto notes = numNotes.load (relaxed) + 1;
+    auto atStart = numAtBlockStart.load (relaxed);
+
+    if (samplePosition <= 0)
+        numAtBlockStart.store (++atStart, relaxed);
+    else
+        granularity.store (std::gcd (granularity.load (relaxed), samplePosition), relaxed);
+
+    largestBlock.store (juce::jmax (largestBlock.load (relaxed), blockSize), relaxed);
+
+    auto& bin = positions[(size_t) juce::jlimit (0, (int) positions.size() - 1, samplePosition * (int) positions.size() / blockSize)];
+    bin.store (bin.load (relaxed) + 1, relaxed);
+
+    numNotes.store (notes, relaxed);
+    snapping.store (notes >= minNotes && (float) atStart >= snappingShare * (float) notes, relaxed);
+}
+
+void MidiTimestampMonitor::reset (double newSampleRate) noexcept
+{
+    sampleRate = newSampleRate;
+    numNotes = 0;
+    numAtBlockStart = 0;
+    granularity = 0;
+    largestBlock = 0;
+    snapping = false;
+
+    for (auto& bin : positions)
+        bin = 0;
+}
+
+MidiTimestampMonitor::Diagnosis MidiTimestampMonitor::getDiagnosis() const noexcept
+{
+    Diagnosis d;
+    d.numNotes = numNotes.load();
+    d.granularitySamples = granularity.load();
+
+    for (size_t i = 0; i < positions.size(); ++i)
+        d.positions[i] = positions[i].load();
+
+    if (d.numNotes == 0)
+        return d;
+
+    d.blockStartShare = (float) numAtBlockStart.load() / (float) d.numNotes;
+
+    if (d.numNotes < minNotes)
+        return d;
+
+    const auto msPerSample = 1000.0 / sampleRate.load();
+
+    if (isSnapping())
+    {
+        d.issue = Issue::blockStartSnapping;
+        d.worstCaseErrorMs = largestBlock.load() * msPerSample;
+    }
+    else if (d.granularitySamples >= coarseGranularitySamples && d.numNotes - numAtBlockStart.load() >= minNotes)
+    {
+        d.issue = Issue::coarseGranularity;
+        d.worstCaseErrorMs = d.granularitySamples * msPerSample;
+    }
+
+    return d;
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class MidiTimestampMonitorTests  : public juce::UnitTest
+{
+public:
+    MidiTimestampMonitorTests()  : juce::UnitTest ("MidiTimestampMonitor", "Pocket") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 512;
+        constexpr auto msPerSample = 1000.0 / sampleRate;
+        using Issue = MidiTimestampMonitor::Issue;
+
+        MidiTimestampMonitor monitor;
+
+        beginTest ("Notes snapped to the block start");
+        {
+            monitor.reset (sampleRate);
+
+            for (int i = 0; i < MidiTimestampMonitor::minNotes - 1; ++i)
+                monitor.addNote (0, i % 2 == 0 ? blockSize : blockSize / 2);
+
+            // Too few notes to tell yet
+            auto d = monitor.getDiagnosis();
+            expect (d.issue == Issue::none);
+            expect (! monitor.isSnapping());
+            expectEquals (d.blockStartShare, 1.0f);
+            expectEquals ((int) d.numNotes, MidiTimestampMonitor::minNotes - 1);
+
+            monitor.addNote (0, blockSize);
+            d = monitor.getDiagnosis();
+            expect (d.issue == Issue::blockStartSnapping);
+            expect (monitor.isSnapping());
+            expectEquals (d.granularitySamples, 0);
+            expectEquals ((int) d.positions[0], MidiTimestampMonitor::minNotes);
+
+            // A note can be late by up to the largest block
+            expectWithinAbsoluteError (d.worstCaseErrorMs, blockSize * msPerSample, 1.0e-9);
+        }
+
+        beginTest ("Snapping needs 90% of the notes at the block start");
+        {
+            const auto run = [&] (int atStart, int elsewhere)
+            {
+                monitor.reset (sampleRate);
+
+                for (int i = 0; i < atStart; ++i)
+                    monitor.addNote (0, blockSize);
+
+                for (int i = 0; i < elsewhere; ++i)
+                    monitor.addNote (37 + 101 * i, blockSize);
+
+                return monitor.getDiagnosis();
+            };
+
+            auto d = run (36, 4);
+            expect (d.issue == Issue::blockStartSnapping);
+            expectWithinAbsoluteError (d.blockStartShare, 0.9f, 1.0e-6f);
+
+            d = run (35, 5);
+            expect (d.issue == Issue::none);
+            expect (! monitor.isSnapping());
+            expectWithinAbsoluteError (d.blockStartShare, 0.875f, 1.0e-6f);
+            expectEquals (d.worstCaseErrorMs, 0.0);
+        }
+
+        beginTest ("Notes on 64-sample steps");
+        {
+            monitor.reset (sampleRate);
+
+            // Half the notes at the block start: not snapping, and too few others to judge the step
+            for (int i = 0; i < MidiTimestampMonitor::minNotes; ++i)
+                monitor.addNote (i % 2 == 0 ? 0 : 64 * (1 + i % 7), blockSize);
+
+            auto d = monitor.getDiagnosis();
+            expectEquals (d.granularitySamples, 64);
+            expect (d.issue == Issue::none);
+
+            while (monitor.getDiagnosis().numNotes < 2 * MidiTimestampMonitor::minNotes)
+                monitor.addNote (64 * (1 + (int) monitor.getDiagnosis().numNotes % 7), blockSize);
+
+            d = monitor.getDiagnosis();
+            expect (d.issue == Issue::coarseGranularity);
+            expectEquals (d.granularitySamples, 64);
+            expectWithinAbsoluteError (d.worstCaseErrorMs, 64 * msPerSample, 1.0e-9);
+
+            // The step is the gcd of every position so far
+            monitor.addNote (96, blockSize);
+            d = monitor.getDiagnosis();
+            expectEquals (d.granularitySamples, 32);
+            expect (d.issue == Issue::coarseGranularity);
+
+            monitor.addNote (48, blockSize);
+            d = monitor.getDiagnosis();
+            expectEquals (d.granularitySamples, 16);
+            expect (d.issue == Issue::none);
+            expectEquals (d.worstCaseErrorMs, 0.0);
+        }
+
+        beginTest ("Notes anywhere in the block");
+        {
+            monitor.reset (sampleRate);
+            juce::Random random (3);
+
+            for (int i = 0; i < 400; ++i)
+                monitor.addNote (random.nextInt (blockSize), blockSize);
+
+            const auto d = monitor.getDiagnosis();
+            expect (d.issue == Issue::none);
+            expectEquals (d.granularitySamples, 1);
+            expect (d.blockStartShare < 0.05f);
+            expectEquals (d.worstCaseErrorMs, 0.0);
+
+            juce::uint32 total = 0;
+
+            for (auto count : d.positions)
+            {
+                expect (count > 0, "Every part of the block gets notes");
+                total += count;
+            }
+
+            expectEquals ((int) total, 400);
+
+            monitor.reset (sampleRate);
+            expectEquals ((int) monitor.getDiagnosis().numNotes, 0);
+            expectEquals (monitor.getDiagnosis().granularitySamples, 0);
+        }
+    }
+};
+
+static MidiTimestampMonitorTests midiTimestampMonitorTests;
+
+#endif
@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    MidiTimestampMonitor.h
+
+    Detects hosts that deliver live MIDI with coarse timestamps, which would
+    otherwise look like the player's timing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+//==============================================================================
+/**
+    Watches where notes land within the host's blocks.
+
+    Played live, notes should land anywhere in a block. Some hosts instead put
+    every live note at the start of the block it's delivered in, making each one
+    late by up to a block; others use timestamps far coarser than a sample. Both
+    add an error the player didn't make, so they're reported rather than blamed on
+    the player.
+
+    The monitor counts notes at sample 0, keeps the greatest common divisor of all
+    other positions (the timestamp granularity), and a histogram of positions as a
+    fraction of the block. addNote() is called from the audio thread; everything
+    else is safe from any thread.
+*/
+class MidiTimestampMonitor
+{
+public:
+    MidiTimestampMonitor() = default;
+
+    enum class Issue
+    {
+        none,
+        blockStartSnapping,     // (Nearly) every note at the start of its block
+        coarseGranularity       // Positions are all multiples of a large step
+    };
+
+    struct Diagnosis
+    {
+        Issue issue = Issue::none;
+        double worstCaseErrorMs = 0.0;      // How late a note can appear because of it
+        int granularitySamples = 0;         // 0 until two notes away from the block start arrive
+        float blockStartShare = 0.0f;       // Of all notes
+        juce::int64 numNotes = 0;
+        std::array<juce::uint32, 16> positions {};  // Histogram of position / block size
+    };
+
+    /** Audio thread: a note arrived at samplePosition in a block of blockSize samples. */
+    void addNote (int samplePosition, int blockSize) noexcept;
+
+    /** Forgets everything; call from prepareToPlay, when the sample rate or block size may change. */
+    void reset (double newSampleRate) noexcept;
+
+    Diagnosis getDiagnosis() const noexcept;
+
+    /** Cheap enough for every block: true once block-start snapping is established. */
+    bool isSnapping() const noexcept        { return snapping.load (std::memory_order_relaxed); }
+
+    static constexpr int minNotes = 32;
+    static constexpr float snappingShare = 0.9f;
+    static constexpr int coarseGranularitySamples = 32;
+
+private:
+    std::atomic<double> sampleRate { 44100.0 };
+    std::atomic<juce::int64> numNotes { 0 }, numAtBlockStart { 0 };
+    std::atomic<int> granularity { 0 }, largestBlock { 0 };
+    std::array<std::atomic<juce::uint32>, 16> positions {};
+    std::atomic<bool> snapping { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiTimestampMonitor)
+};
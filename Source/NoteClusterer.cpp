@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    NoteClusterer.cpp
+
+  ==============================================================================
+*/
+
+#include "NoteClusterer.h"
+
+//==============================================================================
+void NoteClusterer::setSampleRate (double newSampleRate) noexcept
+{
+    sampleRate = newSampleRate;
+    windowSamples = (juce::int64) std::round (currentWindowMs * 0.001 * sampleRate);
+}
+
+void NoteClusterer::setWindowMs (double windowMs) noexcept
+{
+    currentWindowMs = juce::jlimit (0.0, maxWindowMs, windowMs);
+    windowSamples = (juce::int64) std::round (currentWindowMs * 0.001 * sampleRate);
+}
+
+bool NoteClusterer::addNote (juce::int64 sampleTime, double deviationMs, Cluster& finished) noexcept
+{
+    // A zero window keeps even notes on the same sample apart
+    if (numNotes > 0 && windowSamples > 0 && sampleTime - firstSample <= windowSamples)
+    {
+        lastSample = sampleTime;
+        ++numNotes;
+        return false;
+    }
+
+    const auto finishedPrevious = numNotes > 0;
+
+    if (finishedPrevious)
+        finish (finished);
+
+    firstSample = lastSample = sampleTime;
+    firstDeviationMs = deviationMs;
+    numNotes = 1;
+    return finishedPrevious;
+}
+
+bool NoteClusterer::advanceTo (juce::int64 sampleTime, Cluster& finished) noexcept
+{
+    if (numNotes == 0 || sampleTime - firstSample <= windowSamples)
+        return false;
+
+    finish (finished);
+    numNotes = 0;
+    return true;
+}
+
+void NoteClusterer::finish (Cluster& finished) noexcept
+{
+    finished.onsetDeviationMs = firstDeviationMs;
+    finished.spreadMs = (double) (lastSample - firstSample) * 1000.0 / sampleRate;
+    finished.numNotes = numNotes;
+}
@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+    NoteClusterer.h
+
+    Groups near-simultaneous notes (chords, flams) into a single onset.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Groups note-ons that start within a short window of each other into one
+    cluster, so a chord or a flam is judged as a single onset rather than as
+    several notes a few ms apart.
+
+    A cluster starts with its first note and takes every note that arrives within
+    `window` samples of it; it's reported once a later note or the end of a block
+    shows that nothing more can join. Its onset deviation is that of its first
+    note, and its spread is the time from the first to the last note.
+
+    Only the open cluster's first and last notes are kept, in a fixed-size state,
+    so adding a note is a few comparisons. Audio thread only.
+*/
+class NoteClusterer
+{
+public:
+    NoteClusterer() = default;
+
+    struct Cluster
+    {
+        double onsetDeviationMs = 0.0;  // Of the first note (negative = early)
+        double spreadMs = 0.0;          // From the first to the last note
+        int numNotes = 0;
+    };
+
+    void setSampleRate (double newSampleRate) noexcept;
+
+    /** Notes within this many ms of a cluster's first note join it; 0 keeps every note on its own. */
+    void setWindowMs (double windowMs) noexcept;
+
+    /** Adds a note; returns true and fills `finished` if the note closed the previous cluster. */
+    bool addNote (juce::int64 sampleTime, double deviationMs, Cluster& finished) noexcept;
+
+    /** Call once the notes up to `sampleTime` are added; returns true and fills
+        `finished` if the open cluster can no longer grow.
+    */
+    bool advanceTo (juce::int64 sampleTime, Cluster& finished) noexcept;
+
+    /** Forgets the open cluster, e.g. when the transport stops. */
+    void reset() noexcept                   { numNotes = 0; }
+
+    static constexpr double defaultWindowMs = 25.0;
+    static constexpr double maxWindowMs = 60.0;
+
+private:
+    void finish (Cluster& finished) noexcept;
+
+    double sampleRate = 44100.0, currentWindowMs = 0.0;
+    juce::int64 windowSamples = 0;
+
+    juce::int64 firstSample = 0, lastSample = 0;
+    double firstDeviationMs = 0.0;
+    int numNotes = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NoteClusterer)
+};
@@ -0,0 +1,160 @@
+/*
+  ==============================================================================
+
+    NoteDurationTracker.h
+
+    Pairs note-ons with their note-offs on the audio thread, so note lengths
+    can be analysed as well as onsets.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include "TimingEvent.h"
+
+//==============================================================================
+/** A finished note: where it started and how long it sounded. */
+struct NoteDuration
+{
+    double ppq = 0.0;           // Host position of the note-on, in quarter notes
+    double lengthPpq = 0.0;     // Until its note-off, or until the pedal lifted if it held the note
+    double bpm = 0.0;           // Tempo at the note-on
+    juce::uint16 take = 0;
+    juce::uint8 note = 0;
+    juce::uint8 channel = 0;
+    bool sustained = false;     // Kept sounding past its note-off by the sustain pedal (CC64)
+};
+
+using NoteDurationFifo = EventFifo<NoteDuration, 1024>;
+
+//==============================================================================
+/**
+    Keeps the start of every sounding note in a fixed 16 x 128 table (channel by
+    note number), and reports each note once it stops sounding. Nothing is ever
+    allocated, so every call is safe on the audio thread.
+
+    A note-off while the channel's sustain pedal is down leaves the note sounding
+    until the pedal lifts. Hanging notes are cut off where they can be: a note
+    that's struck again before its note-off ends at the new note-on, and All
+    Notes Off / All Sound Off end every note on the channel. Notes longer than
+    maxLengthPpq are dropped as stuck rather than reported.
+
+    Finished notes are passed to a handler, e.g. to push them into a
+    NoteDurationFifo. Audio thread only.
+*/
+class NoteDurationTracker
+{
+public:
+    NoteDurationTracker() = default;
+
+    // Channels are 1 to 16, as returned by juce::MidiMessage::getChannel()
+    template <typename Handler>
+    void noteOn (int channel, int note, double ppq, double bpm, juce::uint16 take, Handler&& onFinished) noexcept
+    {
+        auto& active = getNote (channel, note);
+
+        // Struck again before its note-off (or while the pedal holds it)
+        if (active.state != State::off)
+            finish (active, channel, note, ppq, onFinished);
+
+        active = { ppq, bpm, take, State::held };
+    }
+
+    template <typename Handler>
+    void noteOff (int channel, int note, double ppq, Handler&& onFinished) noexcept
+    {
+        auto& active = getNote (channel, note);
+
+        if (active.state != State::held)
+            return;
+
+        if (pedalDown[(size_t) getChannelIndex (channel)])
+            active.state = State::sustained;
+        else
+            finish (active, channel, note, ppq, onFinished);
+    }
+
+    template <typename Handler>
+    void sustainPedal (int channel, bool isDown, double ppq, Handler&& onFinished) noexcept
+    {
+        auto& wasDown = pedalDown[(size_t) getChannelIndex (channel)];
+
+        // Continuous pedals send a stream of CC64 values; only the crossings matter
+        if (isDown == wasDown)
+            return;
+
+        wasDown = isDown;
+
+        if (! isDown)
+            for (int note = 0; note < 128; ++note)
+                if (auto& active = getNote (channel, note); active.state == State::sustained)
+                    finish (active, channel, note, ppq, onFinished);
+    }
+
+    template <typename Handler>
+    void allNotesOff (int channel, double ppq, Handler&& onFinished) noexcept
+    {
+        for (int note = 0; note < 128; ++note)
+            if (auto& active = getNote (channel, note); active.state != State::off)
+                finish (active, channel, note, ppq, onFinished);
+    }
+
+    /** Forgets every sounding note without reporting it, e.g. when the transport stops. */
+    void reset() noexcept
+    {
+        for (auto& channelNotes : notes)
+            for (auto& active : channelNotes)
+                active.state = State::off;
+
+        pedalDown.fill (false);
+    }
+
+    static constexpr double maxLengthPpq = 32.0;
+
+private:
+    enum class State : juce::uint8 { off, held, sustained };
+
+    struct ActiveNote
+    {
+        double ppq = 0.0;
+        double bpm = 0.0;
+        juce::uint16 take = 0;
+        State state = State::off;
+    };
+
+    static int getChannelIndex (int channel) noexcept   { return juce::jlimit (1, 16, channel) - 1; }
+
+    ActiveNote& getNote (int channel, int note) noexcept
+    {
+        return notes[(size_t) getChannelIndex (channel)][(size_t) (note & 127)];
+    }
+
+    template <typename Handler>
+    static void finish (ActiveNote& active, int channel, int note, double endPpq, Handler& onFinished) noexcept
+    {
+        const auto lengthPpq = endPpq - active.ppq;
+
+        if (lengthPpq > 0.0 && lengthPpq <= maxLengthPpq)
+        {
+            NoteDuration duration;
+            duration.ppq = active.ppq;
+            duration.lengthPpq = lengthPpq;
+            duration.bpm = active.bpm;
+            duration.take = active.take;
+            duration.note = (juce::uint8) note;
+            duration.channel = (juce::uint8) channel;
+            duration.sustained = active.state == State::sustained;
+            onFinished (duration);
+        }
+
+        active.state = State::off;
+    }
+
+    std::array<std::array<ActiveNote, 128>, 16> notes {};
+    std::array<bool, 16> pedalDown {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NoteDurationTracker)
+};
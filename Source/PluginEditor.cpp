@@ -9,9 +9,13 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+#if JucePlugin_Build_Standalone
+ #include <juce_audio_plugin_client/Standalone/juce_StandaloneFilterWindow.h>
+#endif
+
 //==============================================================================
 PocketAudioProcessorEditor::PocketAudioProcessorEditor (PocketAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), audioProcessor (p), diagnosticsPanel (p)
 {
     // Setup the timing labels and divider
     // timingLabel.setText ("-- ms", juce::dontSendNotification); // <-- REMOVED
@@ -20,46 +24,269 @@ PocketAudioProcessorEditor::PocketAudioProcessorEditor (PocketAudioProcessor& p)
     // addAndMakeVisible (timingLabel); // <-- REMOVED
 
     earlyMsLabel.setText ("", juce::dontSendNotification);
-    earlyMsLabel.setFont (juce::Font (18.0f));
+    earlyMsLabel.setFont (juce::FontOptions (18.0f));
     earlyMsLabel.setJustificationType (juce::Justification::centredRight); // Align to right
     addAndMakeVisible (earlyMsLabel);
 
     dividerLabel.setText ("|", juce::dontSendNotification);
-    dividerLabel.setFont (juce::Font (18.0f));
+    dividerLabel.setFont (juce::FontOptions (18.0f));
     dividerLabel.setJustificationType (juce::Justification::centred);
     addAndMakeVisible (dividerLabel);
 
     lateMsLabel.setText ("", juce::dontSendNotification);
-    lateMsLabel.setFont (juce::Font (18.0f));
+    lateMsLabel.setFont (juce::FontOptions (18.0f));
     lateMsLabel.setJustificationType (juce::Justification::centredLeft); // Align to left
     addAndMakeVisible (lateMsLabel);
 
     // Setup the playhead label
     playheadLabel.setText ("Stopped", juce::dontSendNotification);
-    playheadLabel.setFont (juce::Font (14.0f));
+    playheadLabel.setFont (juce::FontOptions (14.0f));
     playheadLabel.setJustificationType (juce::Justification::centred);
     addAndMakeVisible (playheadLabel);
 
+    // Setup the ensemble label
+    ensembleLabel.setFont (juce::FontOptions (13.0f));
+    ensembleLabel.setJustificationType (juce::Justification::centred);
+    addAndMakeVisible (ensembleLabel);
+
+    anchorButton.setClickingTogglesState (true);
+    anchorButton.setTooltip ("Compare the other Pocket instances with this one");
+    addAndMakeVisible (anchorButton);
+    anchorAttachment = std::make_unique<ButtonAttachment> (audioProcessor.parameters, "ensembleAnchor", anchorButton);
+
+    // Setup the grid controls
+    gridBox.addItemList (GridSettings::getDivisionNames(), 1);
+    gridBox.setTooltip ("Grid");
+    addAndMakeVisible (gridBox);
+    gridAttachment = std::make_unique<ComboBoxAttachment> (audioProcessor.parameters, "grid", gridBox);
+
+    for (auto* slider : { &swingSlider, &latencySlider, &chordWindowSlider })
+    {
+        slider->setSliderStyle (juce::Slider::LinearHorizontal);
+        slider->setTextBoxStyle (juce::Slider::TextBoxRight, false, 55, 20);
+        addAndMakeVisible (slider);
+    }
+
+    swingSlider.setTooltip ("Swing");
+    swingSlider.setTextValueSuffix (" %");
+    swingAttachment = std::make_unique<SliderAttachment> (audioProcessor.parameters, "swing", swingSlider);
+
+    latencySlider.setTooltip ("Latency offset");
+    latencySlider.setTextValueSuffix (" ms");
+    latencyAttachment = std::make_unique<SliderAttachment> (audioProcessor.parameters, "latency", latencySlider);
+
+    chordWindowSlider.setTooltip ("Chord window: notes this close together count as one chord or flam");
+    chordWindowSlider.setTextValueSuffix (" ms");
+    chordWindowAttachment = std::make_unique<SliderAttachment> (audioProcessor.parameters, "chordWindow", chordWindowSlider);
+
+    loadReferenceButton.setTooltip ("Measure against a reference performance (.mid or .pocketlog) instead of the grid");
+    loadReferenceButton.onClick = [this] { loadReferenceButtonClicked(); };
+    addAndMakeVisible (loadReferenceButton);
+
+    sessionStatsLabel.setFont (juce::FontOptions (13.0f));
+    sessionStatsLabel.setJustificationType (juce::Justification::centred);
+    addAndMakeVisible (sessionStatsLabel);
+
+    filterEditor.setTextToShowWhenEmpty ("Filter, e.g. note=38 vel>100 bars=33-64", juce::Colours::grey);
+    filterEditor.onTextChange = [this]
+    {
+        sessionFilter = EventFilter::fromString (filterEditor.getText());
+    };
+    addAndMakeVisible (filterEditor);
+
+    for (auto* button : { &hiHatButton, &pedalButton, &snapCompensationButton })
+    {
+        button->setClickingTogglesState (true);
+        addAndMakeVisible (button);
+    }
+
+    hiHatButton.setTooltip ("Time hi-hat pedal chicks (CC4) like notes");
+    hiHatAttachment = std::make_unique<ButtonAttachment> (audioProcessor.parameters, "hiHatTiming", hiHatButton);
+
+    pedalButton.setTooltip ("Time sustain pedal presses (CC64) like notes");
+    pedalAttachment = std::make_unique<ButtonAttachment> (audioProcessor.parameters, "pedalTiming", pedalButton);
+
+    snapCompensationButton.setTooltip ("If the host moves live notes to the start of each block, move them back by half a block");
+    snapCompensationAttachment = std::make_unique<ButtonAttachment> (audioProcessor.parameters, "snapCompensation", snapCompensationButton);
+
+    // Setup the session recorder controls
+    recordButton.setClickingTogglesState (true);
+    recordButton.setToggleState (audioProcessor.getRecorder().isRecording(), juce::dontSendNotification);
+    recordButton.onClick = [this] { recordButtonClicked(); };
+    addAndMakeVisible (recordButton);
+
+    newSessionButton.setTooltip ("Start the session statistics over (the session so far is added to the progress history)");
+    newSessionButton.onClick = [this]
+    {
+        audioProcessor.startNewSession();
+        showMessage ("New session");
+    };
+    addAndMakeVisible (newSessionButton);
+
+    recordStatusLabel.setFont (juce::FontOptions (13.0f));
+    recordStatusLabel.setJustificationType (juce::Justification::centredLeft);
+    addAndMakeVisible (recordStatusLabel);
+
+    // Setup the session log viewer
+    addAndMakeVisible (logView);
+
+    openLogButton.onClick = [this] { openLogButtonClicked(); };
+    addAndMakeVisible (openLogButton);
+
+    goToBarLabel.setText ("Bar", juce::dontSendNotification);
+    goToBarLabel.setFont (juce::FontOptions (13.0f));
+    goToBarLabel.setEditable (true);
+    goToBarLabel.setTooltip ("Type a bar number to jump to it");
+    goToBarLabel.onTextChange = [this]
+    {
+        // Bars are shown 1-based, but stored 0-based
+        if (! logView.showBar (goToBarLabel.getText().getIntValue() - 1))
+            goToBarLabel.setText ("Bar", juce::dontSendNotification);
+    };
+    addAndMakeVisible (goToBarLabel);
+
+    // Setup the progress chart
+    addChildComponent (progressView);
+
+    progressButton.setClickingTogglesState (true);
+    progressButton.setTooltip ("Show past sessions");
+    progressButton.onClick = [this]
+    {
+        const auto showProgress = progressButton.getToggleState();
+
+        if (showProgress)
+            progressView.refresh();
+
+        progressView.setVisible (showProgress);
+        logView.setVisible (! showProgress);
+    };
+    addAndMakeVisible (progressButton);
+
+    // Setup the retroactive capture export
+    saveCaptureButton.setTooltip ("Save the last 10 minutes of notes as a MIDI file");
+    saveCaptureButton.onClick = [this] { saveCaptureButtonClicked(); };
+    addAndMakeVisible (saveCaptureButton);
+
+    // Setup the standalone practice controls
+    if (audioProcessor.getPracticeSession() != nullptr)
+    {
+        practiceButton.setClickingTogglesState (true);
+        practiceButton.setToggleState (audioProcessor.getPracticeSession()->isRunning(), juce::dontSendNotification);
+        practiceButton.setTooltip ("Start the metronome and time notes from the MIDI devices directly");
+        practiceButton.onClick = [this] { practiceButtonClicked(); };
+        addAndMakeVisible (practiceButton);
+
+        practiceBpmSlider.setSliderStyle (juce::Slider::LinearHorizontal);
+        practiceBpmSlider.setTextBoxStyle (juce::Slider::TextBoxRight, false, 55, 20);
+        practiceBpmSlider.setRange (40.0, 240.0, 1.0);
+        practiceBpmSlider.setValue (100.0, juce::dontSendNotification);
+        practiceBpmSlider.setTextValueSuffix (" bpm");
+        practiceBpmSlider.onDragEnd = [this]
+        {
+            // A new tempo restarts the clock on a downbeat
+            if (practiceButton.getToggleState())
+                practiceButtonClicked();
+        };
+        addAndMakeVisible (practiceBpmSlider);
+    }
+
+    // Setup the hidden diagnostics panel
+    diagnosticsPanel.onMessage = [this] (const juce::String& message) { showMessage (message); };
+    addChildComponent (diagnosticsPanel);
+    playheadLabel.addMouseListener (this, false);
+    setWantsKeyboardFocus (true);
+
+    // Setup the latency calibration controls
+    latencyProfileBox.setEditableText (true);
+    latencyProfileBox.setTooltip ("Input device to calibrate; choose a stored one to apply its latency");
+    latencyProfileBox.onChange = [this]
+    {
+        if (audioProcessor.applyLatencyProfile (latencyProfileBox.getText()))
+            updateCalibration();
+    };
+    addAndMakeVisible (latencyProfileBox);
+
+    calibrateButton.setClickingTogglesState (true);
+    calibrateButton.setTooltip ("Tap along to a click for 30 seconds to measure the input latency");
+    calibrateButton.onClick = [this] { calibrateButtonClicked(); };
+    addAndMakeVisible (calibrateButton);
+
+    calibrationLabel.setFont (juce::FontOptions (13.0f));
+    calibrationLabel.setJustificationType (juce::Justification::centredLeft);
+    addAndMakeVisible (calibrationLabel);
+
+    refreshLatencyProfiles();
+    updateCalibration();
+
     // Set editor size
-    setSize (400, 120);
+    setSize (470, 445);
 
+    audioProcessor.addDisplayConsumer();
     startTimerHz(30);
 }
 
 PocketAudioProcessorEditor::~PocketAudioProcessorEditor()
 {
     stopTimer();
+    audioProcessor.removeDisplayConsumer();
 }
 
 //==============================================================================
 void PocketAudioProcessorEditor::paint (juce::Graphics& g)
 {
+    POCKET_TRACE_SCOPE (audioProcessor.getTraceRecorder(), "editor paint");
     g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
 }
 
 void PocketAudioProcessorEditor::resized()
 {
     auto bounds = getLocalBounds();
+
+    auto recordArea = bounds.removeFromBottom (30).reduced (4, 2);
+    recordButton.setBounds (recordArea.removeFromLeft (70));
+    openLogButton.setBounds (recordArea.removeFromLeft (70));
+    progressButton.setBounds (recordArea.removeFromLeft (70));
+    saveCaptureButton.setBounds (recordArea.removeFromLeft (70));
+    newSessionButton.setBounds (recordArea.removeFromLeft (45));
+    goToBarLabel.setBounds (recordArea.removeFromLeft (50));
+    recordStatusLabel.setBounds (recordArea);
+
+    const auto chartArea = bounds.removeFromBottom (120).reduced (4, 0);
+    logView.setBounds (chartArea);
+    progressView.setBounds (chartArea);
+    diagnosticsPanel.setBounds (chartArea);
+
+    auto ensembleArea = bounds.removeFromBottom (30);
+
+    if (practiceButton.isVisible())
+    {
+        auto practiceArea = ensembleArea.removeFromLeft (230).reduced (4, 3);
+        practiceButton.setBounds (practiceArea.removeFromLeft (70));
+        practiceBpmSlider.setBounds (practiceArea);
+    }
+
+    anchorButton.setBounds (ensembleArea.removeFromRight (60).reduced (0, 3).withTrimmedRight (4));
+    ensembleLabel.setBounds (ensembleArea);
+
+    auto calibrationArea = bounds.removeFromBottom (30).reduced (4, 3);
+    latencyProfileBox.setBounds (calibrationArea.removeFromLeft (150));
+    calibrateButton.setBounds (calibrationArea.removeFromLeft (70).withTrimmedLeft (4));
+    calibrationLabel.setBounds (calibrationArea.withTrimmedLeft (4));
+
+    sessionStatsLabel.setBounds (bounds.removeFromBottom (55));
+    auto filterArea = bounds.removeFromBottom (30).reduced (4, 3);
+    snapCompensationButton.setBounds (filterArea.removeFromRight (60));
+    pedalButton.setBounds (filterArea.removeFromRight (60));
+    hiHatButton.setBounds (filterArea.removeFromRight (65));
+    filterEditor.setBounds (filterArea.withTrimmedRight (4));
+
+    auto gridArea = bounds.removeFromBottom (30).reduced (4, 2);
+    gridBox.setBounds (gridArea.removeFromLeft (90));
+    loadReferenceButton.setBounds (gridArea.removeFromLeft (65));
+    const auto sliderWidth = gridArea.getWidth() / 3;
+    swingSlider.setBounds (gridArea.removeFromLeft (sliderWidth));
+    latencySlider.setBounds (gridArea.removeFromLeft (sliderWidth));
+    chordWindowSlider.setBounds (gridArea);
     auto timingArea = bounds.removeFromTop(bounds.getHeight() / 2);
     playheadLabel.setBounds (bounds); // Playhead takes bottom half
 
@@ -74,6 +301,8 @@ void PocketAudioProcessorEditor::resized()
 
 void PocketAudioProcessorEditor::timerCallback()
 {
+    POCKET_TRACE_SCOPE (audioProcessor.getTraceRecorder(), "editor timer");
+
     // --- Update Timing Labels ---
     double differenceMs = audioProcessor.lastTimingDifferenceMs.load();
     juce::String earlyString = "";
@@ -110,7 +339,370 @@ void PocketAudioProcessorEditor::timerCallback()
     {
         playheadString = "Stopped";
     }
+
+    if (const auto clusterSize = audioProcessor.lastClusterSize.load(); clusterSize > 1 && ppq >= 0.0)
+        playheadString << " | " << clusterSize << " notes, "
+                       << juce::String (audioProcessor.lastClusterSpreadMs.load(), 1) << " ms spread";
+
+    if (gridBox.getSelectedItemIndex() == GridSettings::autoDivision)
+    {
+        const auto estimate = audioProcessor.getGrooveDetector().getEstimate();
+
+        if (estimate.division >= 0)
+            playheadString << " | Auto: " << GridSettings::getDivisionNames()[estimate.division]
+                           << ", " << juce::roundToInt (estimate.swing * 100.0) << "% swing ("
+                           << juce::roundToInt (estimate.confidence * 100.0f) << "% sure)";
+        else
+            playheadString << " | Auto: listening...";
+    }
+    else if (gridBox.getSelectedItemIndex() == GridSettings::inferredDivision)
+    {
+        if (const auto division = audioProcessor.getRhythmTranscriber().getLatestDivision(); division >= 0)
+            playheadString << " | Inferred: " << GridSettings::getDivisionNames()[division];
+    }
+
     juce::MessageManager::callAsync([this, playheadString]() {
          playheadLabel.setText(playheadString, juce::dontSendNotification);
     });
+
+    // --- Update Ensemble Label ---
+    const auto snapshot = audioProcessor.getEnsemble().getSnapshot();
+    juce::StringArray offsets;
+
+    for (const auto& player : snapshot.players)
+    {
+        if (player.numBars == 0)
+            continue;
+
+        const auto ms = player.averageMs;
+        offsets.add (player.name + " " + juce::String (std::abs (ms), 1) + " ms "
+                       + (ms >= 0.0 ? "behind " : "ahead of ") + snapshot.anchorName);
+    }
+
+    if (snapshot.anchorName.isEmpty() && snapshot.numMembers > 1)
+        offsets.add ("Press Anchor on the instance to compare the others with");
+
+    // Host timestamp problems come first: they make every deviation suspect
+    const auto diagnosis = audioProcessor.getTimestampMonitor().getDiagnosis();
+
+    if (diagnosis.issue == MidiTimestampMonitor::Issue::blockStartSnapping)
+        offsets.insert (0, "Warning: host puts live notes at block start (up to "
+                             + juce::String (diagnosis.worstCaseErrorMs, 1) + " ms late)");
+    else if (diagnosis.issue == MidiTimestampMonitor::Issue::coarseGranularity)
+        offsets.insert (0, "Warning: host MIDI timestamps in " + juce::String (diagnosis.granularitySamples)
+                             + "-sample steps (up to " + juce::String (diagnosis.worstCaseErrorMs, 1) + " ms off)");
+
+    ensembleLabel.setText (offsets.joinIntoString (" | "), juce::dontSendNotification);
+
+    // --- Update Session Statistics ---
+    auto& analyser = audioProcessor.getSessionAnalyser();
+    juce::String statsString;
+
+    // Filtered queries scan the whole store, so they run on the workers, and only when something
+    // changed. Without a filter, the running statistics (pedal crossings included) are shown.
+    if (filterEditor.isEmpty() || sessionFilter.matchesEverything())
+    {
+        sessionStats = analyser.getStatistics();
+    }
+    else
+    {
+        analyser.requestQuery (sessionFilter);
+        sessionStats = analyser.getQueryResult();
+    }
+
+    const auto& stats = sessionStats;
+
+    if (analyser.getProgress() < 1.0)
+        statsString = "Re-analysing... " + juce::String (juce::roundToInt (analyser.getProgress() * 100.0)) + "%";
+    else if (stats.numNotes > 0)
+        statsString = juce::String (stats.numNotes) + " notes | mean " + juce::String (stats.getMeanMs(), 1)
+                        + " ms | sd " + juce::String (stats.getStandardDeviationMs(), 1) + " ms | "
+                        + juce::String (juce::roundToInt (100.0 * (double) stats.numEarly / (double) stats.numNotes)) + "% early";
+
+    // Second line: the alignment with the reference, or the inferred subdivisions
+    if (audioProcessor.getGridSettings().reference != nullptr)
+    {
+        const auto alignment = audioProcessor.getScoreFollower().getResults();
+
+        if (alignment.numMatched + alignment.numExtra > 0)
+            statsString << "\nAligned: " << (int) alignment.numMatched << " matched, " << (int) alignment.numMissed
+                        << " missed, " << (int) alignment.numExtra << " extra";
+    }
+    else if (const auto inferred = audioProcessor.getRhythmTranscriber().getResults(); inferred.deviations.numNotes > 0)
+    {
+        const auto& counts = inferred.notesPerDivision;
+        const auto mostPlayed = (int) std::distance (counts.begin(), std::max_element (counts.begin(), counts.end()));
+
+        statsString << "\nInferred: mostly " << GridSettings::getDivisionNames()[mostPlayed]
+                    << " | mean " << juce::String (inferred.deviations.getMeanMs(), 1)
+                    << " ms | sd " << juce::String (inferred.deviations.getStandardDeviationMs(), 1) << " ms";
+    }
+
+    // Third line: how long notes are held, and when they're released
+    if (const auto articulation = audioProcessor.getArticulationAnalyser().getResults(); articulation.numNotes > 0)
+    {
+        const auto percentOf = [&articulation] (juce::int64 count)
+        {
+            return juce::String (juce::roundToInt (100.0 * (double) count / (double) articulation.numNotes)) + "%";
+        };
+
+        statsString << "\nLength: " << juce::String (articulation.getMeanLength(), 2) << " steps (sd "
+                    << juce::String (articulation.getLengthStandardDeviation(), 2) << ") | "
+                    << percentOf (articulation.numLegato) << " legato, " << percentOf (articulation.numStaccato)
+                    << " staccato | release " << juce::String (articulation.releases.getMeanMs(), 1) << " ms";
+    }
+
+    sessionStatsLabel.setText (statsString, juce::dontSendNotification);
+
+    if (diagnosticsPanel.isVisible())
+        diagnosticsPanel.update();
+
+    // --- Update Calibration ---
+    if (calibrateButton.getToggleState())
+        updateCalibration();
+
+    // --- Update Recorder Status ---
+    const auto& recorder = audioProcessor.getRecorder();
+    juce::String recordStatus;
+
+    if (ticksToShowMessage > 0)
+    {
+        --ticksToShowMessage;
+        recordStatus = statusMessage;
+    }
+    else if (recorder.isRecording())
+    {
+        recordStatus = recorder.getFile().getFileName() + ": " + juce::String (recorder.getNumEventsWritten()) + " notes";
+    }
+    else if (const auto error = recorder.getError(); error.isNotEmpty())
+    {
+        // The recorder stops by itself when the disk refuses a write
+        recordButton.setToggleState (false, juce::dontSendNotification);
+        recordStatus = error;
+    }
+
+    if (const auto dropped = audioProcessor.getNumDroppedEvents(); dropped > 0)
+        recordStatus << " (" << (int) dropped << " dropped)";
+
+    recordStatusLabel.setText (recordStatus, juce::dontSendNotification);
+}
+
+bool PocketAudioProcessorEditor::keyPressed (const juce::KeyPress& key)
+{
+    if (key == juce::KeyPress ('d', juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier, 0))
+    {
+        toggleDiagnostics();
+        return true;
+    }
+
+    return false;
+}
+
+void PocketAudioProcessorEditor::mouseDoubleClick (const juce::MouseEvent& e)
+{
+    if (e.eventComponent == &playheadLabel)
+        toggleDiagnostics();
+}
+
+void PocketAudioProcessorEditor::toggleDiagnostics()
+{
+    diagnosticsPanel.setVisible (! diagnosticsPanel.isVisible());
+
+    if (diagnosticsPanel.isVisible())
+        diagnosticsPanel.update();
+}
+
+void PocketAudioProcessorEditor::showMessage (const juce::String& message)
+{
+    statusMessage = message;
+    ticksToShowMessage = 90;
+    recordStatusLabel.setText (message, juce::dontSendNotification);
+}
+
+void PocketAudioProcessorEditor::recordButtonClicked()
+{
+    if (! recordButton.getToggleState())
+    {
+        audioProcessor.stopRecording();
+        return;
+    }
+
+    if (! audioProcessor.startRecording (SessionRecorder::createDefaultFile()))
+    {
+        recordButton.setToggleState (false, juce::dontSendNotification);
+        showMessage ("Couldn't create session log");
+    }
+}
+
+void PocketAudioProcessorEditor::openLogButtonClicked()
+{
+    fileChooser = std::make_unique<juce::FileChooser> ("Open session log",
+                                                       SessionRecorder::createDefaultFile().getParentDirectory(),
+                                                       juce::String ("*") + SessionLogFormat::fileExtension);
+
+    fileChooser->launchAsync (juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                              [this] (const juce::FileChooser& chooser)
+                              {
+                                  const auto file = chooser.getResult();
+
+                                  if (file == juce::File())
+                                      return;
+
+                                  if (! logView.openLog (file))
+                                      showMessage ("Couldn't read " + file.getFileName());
+
+                                  // Switch back from the progress chart to show the log
+                                  progressButton.setToggleState (false, juce::sendNotificationSync);
+                              });
+}
+
+void PocketAudioProcessorEditor::saveCaptureButtonClicked()
+{
+    const auto& capture = audioProcessor.getCapture();
+
+    if (capture.getNumEventsCaptured() == 0)
+    {
+        showMessage ("No notes captured yet");
+        return;
+    }
+
+    const auto name = "Capture " + juce::Time::getCurrentTime().formatted ("%Y-%m-%d %H-%M-%S");
+    const auto file = SessionRecorder::createDefaultFile().getParentDirectory()
+                          .getNonexistentChildFile (name, ".mid", false);
+
+    showMessage (capture.exportToFile (file, MidiCaptureBuffer::defaultWindowSeconds)
+                     ? "Saved " + file.getFileName()
+                     : "Couldn't save " + file.getFileName());
+}
+
+void PocketAudioProcessorEditor::practiceButtonClicked()
+{
+    auto* practice = audioProcessor.getPracticeSession();
+
+    if (! practiceButton.getToggleState())
+    {
+        practice->stop();
+        showMessage ("Practice stopped");
+        return;
+    }
+
+   #if JucePlugin_Build_Standalone
+    // The clicks have to be rendered early by however long the device takes to play them
+    if (auto* holder = juce::StandalonePluginHolder::getInstance())
+        if (auto* device = holder->deviceManager.getCurrentAudioDevice())
+            practice->setOutputLatencyMs (device->getOutputLatencyInSamples() * 1000.0 / device->getCurrentSampleRate());
+   #endif
+
+    const auto numInputs = practice->start (practiceBpmSlider.getValue());
+    showMessage (numInputs > 0 ? "Practising with " + juce::String (numInputs) + " MIDI input" + (numInputs > 1 ? "s" : "")
+                               : "Metronome only: no MIDI inputs found");
+}
+
+void PocketAudioProcessorEditor::calibrateButtonClicked()
+{
+    auto& calibrator = audioProcessor.getCalibrator();
+
+    if (! calibrateButton.getToggleState())
+    {
+        calibrator.cancel();
+        updateCalibration();
+        return;
+    }
+
+    if (latencyProfileBox.getText().trim().isEmpty())
+        latencyProfileBox.setText ("Default", juce::dontSendNotification);
+
+    calibrator.start();
+    calibrationLabel.setText ("Tap along from the fifth click...", juce::dontSendNotification);
+}
+
+void PocketAudioProcessorEditor::updateCalibration()
+{
+    const auto& calibrator = audioProcessor.getCalibrator();
+
+    if (calibrateButton.getToggleState())
+    {
+        if (calibrator.isActive())
+        {
+            calibrationLabel.setText ("Tap along from the fifth click... "
+                                        + juce::String (juce::roundToInt (calibrator.getProgress() * 100.0f)) + "%",
+                                      juce::dontSendNotification);
+            return;
+        }
+
+        if (! calibrator.isFinished())
+            return;     // Not started by the audio thread yet
+
+        calibrateButton.setToggleState (false, juce::dontSendNotification);
+        const auto result = calibrator.getResult();
+
+        if (result.numTaps < LatencyCalibrator::minTaps)
+        {
+            showMessage ("Only " + juce::String (result.numTaps) + " taps; latency not changed");
+            return;
+        }
+
+        audioProcessor.storeLatencyProfile (latencyProfileBox.getText().trim(), result);
+        refreshLatencyProfiles();
+    }
+
+    const auto device = audioProcessor.getCurrentLatencyProfile();
+
+    if (device.isEmpty() || ! audioProcessor.getLatencyProfileNames().contains (device))
+    {
+        calibrationLabel.setText ("Not calibrated", juce::dontSendNotification);
+        return;
+    }
+
+    const auto result = audioProcessor.getLatencyProfile (device);
+    calibrationLabel.setText (juce::String (result.offsetMs, 1) + " ms +/- " + juce::String (result.standardErrorMs, 1)
+                                + " (" + juce::String (result.numTaps) + " taps, spread "
+                                + juce::String (result.spreadMs, 1) + " ms)",
+                              juce::dontSendNotification);
+}
+
+void PocketAudioProcessorEditor::refreshLatencyProfiles()
+{
+    const auto names = audioProcessor.getLatencyProfileNames();
+    latencyProfileBox.clear (juce::dontSendNotification);
+    latencyProfileBox.addItemList (names, 1);
+
+    // Offer the first MIDI input by name until a profile has been stored
+    auto device = audioProcessor.getCurrentLatencyProfile();
+
+    if (device.isEmpty())
+    {
+        const auto inputs = juce::MidiInput::getAvailableDevices();
+        device = inputs.isEmpty() ? juce::String ("Default") : inputs.getFirst().name;
+    }
+
+    latencyProfileBox.setText (device, juce::dontSendNotification);
+}
+
+void PocketAudioProcessorEditor::loadReferenceButtonClicked()
+{
+    fileChooser = std::make_unique<juce::FileChooser> ("Load reference performance",
+                                                       SessionRecorder::createDefaultFile().getParentDirectory(),
+                                                       juce::String ("*.mid;*.midi;*") + SessionLogFormat::fileExtension);
+
+    fileChooser->launchAsync (juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                              [this] (const juce::FileChooser& chooser)
+                              {
+                                  const auto file = chooser.getResult();
+
+                                  if (file == juce::File())
+                                      return;
+
+                                  if (! audioProcessor.loadReference (file))
+                                  {
+                                      showMessage ("No notes in " + file.getFileName());
+                                      return;
+                                  }
+
+                                  const auto* reference = audioProcessor.getReference();
+                                  showMessage ("Reference: " + reference->getName() + " (" + juce::String (reference->getNumNotes())
+                                                 + " notes, " + juce::String (reference->getLoopLength() / 4.0, 0) + " bars)");
+
+                                  gridBox.setSelectedItemIndex (GridSettings::referenceDivision);
+                              });
 }
@@ -10,6 +10,9 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "SessionLogView.h"
+#include "ProgressView.h"
+#include "DiagnosticsPanel.h"
 
 //==============================================================================
 /**
@@ -29,6 +32,10 @@ public:
     // Timer callback
     void timerCallback() override;
 
+    // Double-click the playhead line, or Ctrl/Cmd+Shift+D, for the diagnostics panel
+    bool keyPressed (const juce::KeyPress&) override;
+    void mouseDoubleClick (const juce::MouseEvent&) override;
+
 private:
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
@@ -41,6 +48,75 @@ private:
     juce::Label lateMsLabel;    // Displays timing when dragging (positive ms)
 
     juce::Label playheadLabel;  // Existing label for playhead info
+    juce::Label ensembleLabel;  // Offsets of the other instances against the anchor
+    juce::TextButton anchorButton { "Anchor" };
+
+    // Grid settings; changing any of them re-analyses the whole session
+    juce::ComboBox gridBox;
+    juce::Slider swingSlider, latencySlider, chordWindowSlider;
+    juce::TextButton loadReferenceButton { "Load ref" };
+    juce::Label sessionStatsLabel;
+
+    // Time hi-hat pedal chicks and sustain pedal presses as well as notes
+    juce::TextButton hiHatButton { "HH pedal" }, pedalButton { "Sustain" };
+
+    // Compensates hosts that snap live notes to the block start
+    juce::TextButton snapCompensationButton { "Snap fix" };
+
+    // Restricts the session statistics to matching notes, e.g. "note=38 vel>100"
+    juce::TextEditor filterEditor;
+    EventFilter sessionFilter;
+    SessionStatistics sessionStats;
+
+    using ComboBoxAttachment = juce::AudioProcessorValueTreeState::ComboBoxAttachment;
+    using SliderAttachment = juce::AudioProcessorValueTreeState::SliderAttachment;
+    std::unique_ptr<ComboBoxAttachment> gridAttachment;
+    using ButtonAttachment = juce::AudioProcessorValueTreeState::ButtonAttachment;
+    std::unique_ptr<SliderAttachment> swingAttachment, latencyAttachment, chordWindowAttachment;
+    std::unique_ptr<ButtonAttachment> hiHatAttachment, pedalAttachment, snapCompensationAttachment, anchorAttachment;
+
+    juce::TextButton recordButton { "Record" };
+    juce::TextButton newSessionButton { "New" };
+    juce::Label recordStatusLabel;     // Recorder progress, or a short-lived message
+
+    juce::String statusMessage;
+    int ticksToShowMessage = 0;
+    void showMessage (const juce::String& message);
+
+    // Viewer for previously recorded session logs
+    SessionLogView logView;
+    juce::TextButton openLogButton { "Open log" };
+    juce::Label goToBarLabel;   // Editable: type a bar number to jump to it
+    std::unique_ptr<juce::FileChooser> fileChooser;
+
+    // Past sessions from the progress database, shown in place of the log viewer
+    ProgressView progressView;
+    juce::TextButton progressButton { "Progress" };
+
+    // The plugin's own block timing, shown over the chart when asked for
+    DiagnosticsPanel diagnosticsPanel;
+    void toggleDiagnostics();
+
+    // Saves the last few minutes of notes as a .mid file, even if nothing was recording
+    juce::TextButton saveCaptureButton { "Save MIDI" };
+
+    // Standalone only: start the metronome and time notes straight from the MIDI devices
+    juce::TextButton practiceButton { "Practice" };
+    juce::Slider practiceBpmSlider;
+    void practiceButtonClicked();
+
+    // Measures the input latency against a click and stores it under the device's name
+    juce::ComboBox latencyProfileBox;
+    juce::TextButton calibrateButton { "Calibrate" };
+    juce::Label calibrationLabel;
+    void calibrateButtonClicked();
+    void updateCalibration();
+    void refreshLatencyProfiles();
+
+    void recordButtonClicked();
+    void openLogButtonClicked();
+    void saveCaptureButtonClicked();
+    void loadReferenceButtonClicked();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PocketAudioProcessorEditor)
 };
@@ -23,13 +23,213 @@ PocketAudioProcessor::PocketAudioProcessor()
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
-                       )
+                       ),
+#else
+     :
 #endif
+       parameters (*this, nullptr, "Pocket", createParameterLayout())
 {
+    gridParameter    = parameters.getRawParameterValue ("grid");
+    swingParameter   = parameters.getRawParameterValue ("swing");
+    latencyParameter = parameters.getRawParameterValue ("latency");
+    chordWindowParameter = parameters.getRawParameterValue ("chordWindow");
+    hiHatParameter       = parameters.getRawParameterValue ("hiHatTiming");
+    pedalParameter       = parameters.getRawParameterValue ("pedalTiming");
+    snapCompensationParameter = parameters.getRawParameterValue ("snapCompensation");
+    ensembleAnchorParameter = parameters.getRawParameterValue ("ensembleAnchor");
+
+    // Without a host there's no transport, so the standalone app brings its own clock
+    if (wrapperType == wrapperType_Standalone)
+        practice = std::make_unique<PracticeSession> ([this] { return getLiveGridSettings(); }, lastTimingDifferenceMs,
+                                                      [this] { workerPool->notify(); });
+
+    // The analysis workers only run when there's work, so a new grid has to wake them to re-measure
+    for (auto* id : { "grid", "swing", "latency" })
+        parameters.addParameterListener (id, this);
+
+    static std::atomic<int> instanceCount { 0 };
+    ensembleMemberId = ensemble->addMember ("Player " + juce::String (++instanceCount),
+                                            [this] { return ensembleAnchorParameter->load() >= 0.5f; });
+    workerPool->addClient (*this);
 }
 
 PocketAudioProcessor::~PocketAudioProcessor()
 {
+    for (auto* id : { "grid", "swing", "latency" })
+        parameters.removeParameterListener (id, this);
+
+    workerPool->removeClient (*this);
+    ensemble->removeMember (ensembleMemberId);
+    saveProgress();
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout PocketAudioProcessor::createParameterLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+
+    layout.add (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID { "grid", 1 }, "Grid",
+                                                              GridSettings::getDivisionNames(), 0));
+
+    // 50% is straight; 66.7% is a triplet shuffle
+    layout.add (std::make_unique<juce::AudioParameterFloat> (juce::ParameterID { "swing", 1 }, "Swing",
+                                                             juce::NormalisableRange<float> (50.0f, 75.0f, 0.1f), 50.0f,
+                                                             juce::AudioParameterFloatAttributes().withLabel ("%")));
+
+    layout.add (std::make_unique<juce::AudioParameterFloat> (juce::ParameterID { "latency", 1 }, "Latency Offset",
+                                                             juce::NormalisableRange<float> (-50.0f, 50.0f, 0.1f), 0.0f,
+                                                             juce::AudioParameterFloatAttributes().withLabel ("ms")));
+
+    // Notes this close to the first note of a chord or flam count as one onset
+    layout.add (std::make_unique<juce::AudioParameterFloat> (juce::ParameterID { "chordWindow", 1 }, "Chord Window",
+                                                             juce::NormalisableRange<float> (0.0f, (float) NoteClusterer::maxWindowMs, 0.1f),
+                                                             (float) NoteClusterer::defaultWindowMs,
+                                                             juce::AudioParameterFloatAttributes().withLabel ("ms")));
+
+    // Optionally time hi-hat pedal chicks (CC4) and sustain pedal presses (CC64) like notes
+    layout.add (std::make_unique<juce::AudioParameterBool> (juce::ParameterID { "hiHatTiming", 1 }, "Hi-Hat Pedal Timing", false));
+    layout.add (std::make_unique<juce::AudioParameterBool> (juce::ParameterID { "pedalTiming", 1 }, "Sustain Pedal Timing", false));
+
+    // For hosts that move live notes to the start of the block (see MidiTimestampMonitor)
+    layout.add (std::make_unique<juce::AudioParameterBool> (juce::ParameterID { "snapCompensation", 1 }, "Block Snap Compensation", false));
+
+    // The instance the other players are compared with in the ensemble view (see EnsembleAggregator)
+    layout.add (std::make_unique<juce::AudioParameterBool> (juce::ParameterID { "ensembleAnchor", 1 }, "Ensemble Anchor", false));
+    return layout;
+}
+
+GridSettings PocketAudioProcessor::getGridSettings() const noexcept
+{
+    GridSettings grid;
+    const auto division = (int) gridParameter->load();
+    grid.stepPpq = GridSettings::getDivisionStepPpq (division);
+    grid.swing = swingParameter->load() / 100.0;
+    grid.latencyMs = latencyParameter->load();
+
+    if (division == GridSettings::referenceDivision)
+        grid.reference = currentReference.load();
+
+    // Until the detector is sure, Auto falls back to quarter notes and the swing parameter
+    if (division == GridSettings::autoDivision)
+    {
+        const auto estimate = grooveDetector.getEstimate();
+
+        if (estimate.division >= 0)
+        {
+            grid.stepPpq = GridSettings::getDivisionStepPpq (estimate.division);
+            grid.swing = estimate.swing;
+        }
+    }
+
+    // Each note is measured against its own inferred subdivision once the decoder decides it
+    grid.inferred = division == GridSettings::inferredDivision;
+    return grid;
+}
+
+GridSettings PocketAudioProcessor::getLiveGridSettings() const noexcept
+{
+    auto grid = getGridSettings();
+
+    // Notes shown as they're played can't wait for the decoder, so they use its latest
+    // decision (quarter notes until the first)
+    if (grid.inferred)
+        if (const auto inferred = rhythmTranscriber.getLatestDivision(); inferred >= 0)
+            grid.stepPpq = GridSettings::getDivisionStepPpq (inferred);
+
+    return grid;
+}
+
+bool PocketAudioProcessor::loadReference (const juce::File& file)
+{
+    auto reference = ReferenceGroove::loadFromFile (file);
+
+    if (reference == nullptr)
+        return false;
+
+    // Older references stay alive: the audio thread or a re-analysis may still be using them
+    currentReference = loadedReferences.add (std::move (reference));
+    currentReferenceFile = file;
+    parameters.state.setProperty (referenceFileProperty, file.getFullPathName(), nullptr);
+    workerPool->notify();
+    return true;
+}
+
+void PocketAudioProcessor::parameterChanged (const juce::String&, float)
+{
+    // May be called on the audio thread, so this only sets a flag
+    workerPool->notify();
+}
+
+//==============================================================================
+namespace
+{
+    const juce::Identifier latencyProfilesType ("LatencyProfiles");
+    const juce::Identifier profileType ("Profile");
+    const juce::Identifier deviceProperty ("device");
+    const juce::Identifier offsetProperty ("offsetMs");
+    const juce::Identifier spreadProperty ("spreadMs");
+    const juce::Identifier standardErrorProperty ("standardErrorMs");
+    const juce::Identifier numTapsProperty ("numTaps");
+}
+
+void PocketAudioProcessor::storeLatencyProfile (const juce::String& device, const LatencyCalibrator::Result& result)
+{
+    auto profiles = parameters.state.getOrCreateChildWithName (latencyProfilesType, nullptr);
+    auto profile = profiles.getChildWithProperty (deviceProperty, device);
+
+    if (! profile.isValid())
+    {
+        profile = juce::ValueTree (profileType);
+        profile.setProperty (deviceProperty, device, nullptr);
+        profiles.appendChild (profile, nullptr);
+    }
+
+    profile.setProperty (offsetProperty, result.offsetMs, nullptr);
+    profile.setProperty (spreadProperty, result.spreadMs, nullptr);
+    profile.setProperty (standardErrorProperty, result.standardErrorMs, nullptr);
+    profile.setProperty (numTapsProperty, result.numTaps, nullptr);
+
+    applyLatencyProfile (device);
+}
+
+bool PocketAudioProcessor::applyLatencyProfile (const juce::String& device)
+{
+    const auto profile = parameters.state.getChildWithName (latencyProfilesType).getChildWithProperty (deviceProperty, device);
+
+    if (! profile.isValid())
+        return false;
+
+    // The measured lateness is exactly what the latency offset removes from every note
+    auto* latency = parameters.getParameter ("latency");
+    latency->setValueNotifyingHost (latency->convertTo0to1 ((float) (double) profile[offsetProperty]));
+    parameters.state.setProperty (latencyProfileProperty, device, nullptr);
+    return true;
+}
+
+juce::StringArray PocketAudioProcessor::getLatencyProfileNames() const
+{
+    juce::StringArray names;
+
+    for (const auto& profile : parameters.state.getChildWithName (latencyProfilesType))
+        names.add (profile[deviceProperty].toString());
+
+    return names;
+}
+
+juce::String PocketAudioProcessor::getCurrentLatencyProfile() const
+{
+    return parameters.state.getProperty (latencyProfileProperty).toString();
+}
+
+LatencyCalibrator::Result PocketAudioProcessor::getLatencyProfile (const juce::String& device) const
+{
+    const auto profile = parameters.state.getChildWithName (latencyProfilesType).getChildWithProperty (deviceProperty, device);
+
+    LatencyCalibrator::Result result;
+    result.offsetMs = profile.getProperty (offsetProperty, 0.0);
+    result.spreadMs = profile.getProperty (spreadProperty, 0.0);
+    result.standardErrorMs = profile.getProperty (standardErrorProperty, 0.0);
+    result.numTaps = profile.getProperty (numTapsProperty, 0);
+    return result;
 }
 
 //==============================================================================
@@ -99,6 +299,17 @@ void PocketAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
+    capture.setSampleRate (sampleRate);
+    clusterer.setSampleRate (sampleRate);
+    timestampMonitor.reset (sampleRate);
+    blockProfiler.reset();
+    lastHostTimeNs = 0;
+
+    if (practice != nullptr)
+        practice->setSampleRate (sampleRate);
+    clusterer.reset();
+    noteTracker.reset();
+    controllerTriggers.reset();
 }
 
 void PocketAudioProcessor::releaseResources()
@@ -133,9 +344,29 @@ bool PocketAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) c
 }
 #endif
 
+namespace
+{
+    // Some hosts report a NaN, zero or wild tempo or position while starting or
+    // relocating. Notes in such blocks are skipped rather than measured, so nothing
+    // non-finite reaches the display, the statistics or the session log.
+    bool isUsablePosition (const juce::AudioPlayHead::PositionInfo& info) noexcept
+    {
+        constexpr double minBpm = 1.0, maxBpm = 1000.0, maxPpq = 1.0e8;
+
+        const auto bpm = info.getBpm();
+        const auto ppq = info.getPpqPosition();
+
+        return bpm.hasValue() && std::isfinite (*bpm) && *bpm >= minBpm && *bpm <= maxBpm
+                && ppq.hasValue() && std::isfinite (*ppq) && std::abs (*ppq) < maxPpq;
+    }
+}
+
 void PocketAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-    juce::ScopedNoDenormals noDenormals;
+    POCKET_REALTIME_SCOPE
+    const auto blockStartSample = sampleClock;
+    sampleClock += buffer.getNumSamples();
+
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -145,48 +376,226 @@ void PocketAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce:
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
+    // Idle fast path: with no notes to time, no editor showing the playhead and no
+    // clicks to play, the only thing left to do is let a waiting chord time out. The
+    // playhead isn't asked (on some hosts that's several calls back into the host):
+    // a stop, restart or jump in between is seen by the next block that has notes.
+    if (midiMessages.isEmpty() && numDisplayConsumers.load (std::memory_order_relaxed) == 0
+         && ! calibrator.isActive() && ! isPractising())
+    {
+        if (NoteClusterer::Cluster cluster; clusterer.advanceTo (sampleClock, cluster))
+            publishCluster (cluster);
+
+        return;
+    }
+
+    POCKET_PROFILE_BLOCK (blockProfiler, buffer.getNumSamples(), getSampleRate());
+    POCKET_TRACE_SCOPE (*tracer, "processBlock");
+    juce::ScopedNoDenormals noDenormals;
+
+    if (practice != nullptr)
+        practice->renderClicks (buffer, blockStartSample);
+
+    calibrator.process (buffer, blockStartSample, getSampleRate());
+
+    // Events are kept inside the block, even if the host stamps them outside it
+    const auto lastSample = juce::jmax (0, buffer.getNumSamples() - 1);
+    const auto clampPosition = [lastSample] (int samplePosition) { return juce::jlimit (0, lastSample, samplePosition); };
+
+    // Keep every note for retroactive capture, even with the transport stopped
+    for (const auto metadata : midiMessages)
+        capture.add (metadata.data, metadata.numBytes, blockStartSample + clampPosition (metadata.samplePosition));
+
+    // Calibration taps are timed whether or not the transport is running
+    if (calibrator.isActive())
+    {
+        for (const auto metadata : midiMessages)
+            if (metadata.numBytes == 3 && (metadata.data[0] & 0xf0) == 0x90 && (metadata.data[2] & 0x7f) != 0)
+                calibrator.addTap (blockStartSample + clampPosition (metadata.samplePosition));
+    }
+
     // --- Start of Timing Logic ---
 
     const double sampleRate = getSampleRate();
-    juce::AudioPlayHead* playHead = getPlayHead();
-    juce::AudioPlayHead::CurrentPositionInfo positionInfo;
 
-    // Attempt to get position info. Proceed only if successful and playing.
-    if (playHead != nullptr && playHead->getCurrentPosition(positionInfo) && positionInfo.isPlaying)
+    // The host is asked once per block: everything below reads this one answer
+    const auto hostPosition = getPlayHead() != nullptr ? getPlayHead()->getPosition()
+                                                       : juce::Optional<juce::AudioPlayHead::PositionInfo>();
+
+    // Proceed only if the host has a position and is playing
+    if (hostPosition.hasValue() && hostPosition->getIsPlaying())
     {
-        currentPpqPosition.store(positionInfo.ppqPosition);
+        const auto hostPpq = hostPosition->getPpqPosition();
+        currentPpqPosition.store (hostPpq.hasValue() && std::isfinite (*hostPpq) ? *hostPpq : -1.0);
+
+        updateTransportState (true, hostPosition, blockStartSample);
+
+        // Check that the tempo, position and sample rate can be measured against
+        const auto usable = isUsablePosition (*hostPosition) && sampleRate > 0.0;
+        const auto hadUsablePosition = std::exchange (wasUsablePosition, usable);
 
-        // Check if tempo is valid (greater than zero)
-        if (positionInfo.bpm > 0)
+        if (usable)
         {
-            const double ppqPerMinute = positionInfo.bpm;
-            const double startPpq = positionInfo.ppqPosition;
+            const double ppqPerMinute = *hostPosition->getBpm();
+            const double startPpq = *hostPpq;
+            const auto timeSignature = hostPosition->getTimeSignature();
+            const double quarterNotesPerBar = timeSignature.hasValue() && timeSignature->numerator > 0 && timeSignature->denominator > 0
+                                                ? timeSignature->numerator * 4.0 / timeSignature->denominator
+                                                : 4.0;
+            const auto grid = getLiveGridSettings();
+            NoteClusterer::Cluster cluster;
+
+            // Bars count from the host's last bar start where it has one, so a meter change or a
+            // host that doesn't number bars from zero still puts every instance's notes in the same bar
+            const auto lastBarStartPpq = hostPosition->getPpqPositionOfLastBarStart();
+            const auto hostBarCount = hostPosition->getBarCount();
+
+            const auto barAt = [&] (double notePpq)
+            {
+                if (! lastBarStartPpq.hasValue() || ! std::isfinite (*lastBarStartPpq))
+                    return (int) std::floor (notePpq / quarterNotesPerBar);
+
+                const auto startBar = hostBarCount.hasValue() ? (double) *hostBarCount
+                                                              : std::round (*lastBarStartPpq / quarterNotesPerBar);
+                const auto bar = startBar + std::floor ((notePpq - *lastBarStartPpq) / quarterNotesPerBar);
+                return (int) juce::jlimit (-1.0, 1.0e8, bar);
+            };
+            clusterer.setWindowMs (chordWindowParameter->load());
+
+            const auto pushDuration = [this] (const NoteDuration& duration)
+            {
+                if (! noteDurations.push (duration))
+                    numDroppedEvents.store (numDroppedEvents.load (std::memory_order_relaxed) + 1,
+                                            std::memory_order_relaxed);
+            };
+
+            controllerTriggers.setThreshold (ControllerTriggers::hiHatPedal,
+                                             hiHatParameter->load() >= 0.5f ? ControllerTriggers::hiHatThreshold : 0);
+            controllerTriggers.setThreshold (ControllerTriggers::sustainPedal,
+                                             pedalParameter->load() >= 0.5f ? ControllerTriggers::sustainThreshold : 0);
+
+            // Measures an onset (a note, or a controller crossing) and hands it to the analysis workers
+            const auto addOnset = [&] (int samplePosition, double notePpq, int number, int velocity, int channel, bool isController)
+            {
+                const double msDifference = computeDeviationMs (notePpq, ppqPerMinute, grid);
+
+                if (clusterer.addNote (blockStartSample + samplePosition, msDifference, cluster))
+                    publishCluster (cluster);
+
+                // Hand the note to the analysis workers (never blocks)
+                TimingEvent event;
+                event.sampleTime = blockStartSample + samplePosition;
+                event.ppq = notePpq;
+                event.bpm = ppqPerMinute;
+                event.deviationMs = msDifference;
+                event.bar = barAt (notePpq);
+                event.note = (juce::uint8) number;
+                event.velocity = (juce::uint8) velocity;
+                event.channel = (juce::uint8) channel;
+                event.take = currentTake;
+                event.isController = isController;
+
+                if (! timingEvents.push (event))
+                    numDroppedEvents.store (numDroppedEvents.load (std::memory_order_relaxed) + 1,
+                                            std::memory_order_relaxed);
+            };
+
+            // A host that snaps live notes to the block start delivers them up to a block late,
+            // having collected them since the previous block. Moving them back by half that time
+            // removes the average error (not the jitter).
+            double snapCompensationPpq = 0.0;
 
+            if (snapCompensationParameter->load() >= 0.5f && timestampMonitor.isSnapping())
+            {
+                auto collectedMs = buffer.getNumSamples() * 1000.0 / sampleRate;
+
+                if (const auto hostTimeNs = hostPosition->getHostTimeNs(); hostTimeNs.hasValue())
+                {
+                    const auto sinceLastBlockMs = (double) (*hostTimeNs - lastHostTimeNs) * 1.0e-6;
+
+                    if (lastHostTimeNs != 0 && *hostTimeNs > lastHostTimeNs && sinceLastBlockMs < 4.0 * collectedMs)
+                        collectedMs = sinceLastBlockMs;
+
+                    lastHostTimeNs = *hostTimeNs;
+                }
+
+                snapCompensationPpq = 0.5 * collectedMs * ppqPerMinute / 60000.0;
+            }
+
+            // Read straight from the bytes: a juce::MidiMessage allocates for anything over
+            // 8 bytes, and nothing but 3-byte notes and controllers is timed anyway
             for (const auto metadata : midiMessages)
             {
-                const juce::MidiMessage message = metadata.getMessage();
+                if (metadata.numBytes != 3)
+                    continue;
+
+                const auto type = metadata.data[0] & 0xf0;
+                const auto channel = (metadata.data[0] & 0x0f) + 1;
+                const auto number = metadata.data[1] & 0x7f;
+                const auto value = metadata.data[2] & 0x7f;
+
+                if (type != 0x80 && type != 0x90 && type != 0xb0)
+                    continue;
+
+                const auto samplePosition = clampPosition (metadata.samplePosition);
+                const double secondsIntoBuffer = samplePosition / sampleRate;
+                const double notePpq = startPpq + secondsIntoBuffer * (ppqPerMinute / 60.0)
+                                         - (samplePosition == 0 ? snapCompensationPpq : 0.0);
+
+                if (type == 0x90 && value != 0)
+                {
+                    timestampMonitor.addNote (samplePosition, buffer.getNumSamples());
 
-                if (message.isNoteOn())
+                    addOnset (samplePosition, notePpq, number, value, channel, false);
+                    noteTracker.noteOn (channel, number, notePpq, ppqPerMinute, currentTake, pushDuration);
+                }
+                else if (type != 0xb0) // A note-off, or a note-on with velocity 0
+                {
+                    noteTracker.noteOff (channel, number, notePpq, pushDuration);
+                }
+                else
                 {
-                    const double secondsIntoBuffer = metadata.samplePosition / sampleRate;
-                    const double ppqOffset = secondsIntoBuffer * (ppqPerMinute / 60.0);
-                    const double noteAbsolutePpq = startPpq + ppqOffset;
-                    const double nearestQuarterNotePpq = std::round(noteAbsolutePpq);
-                    const double ppqDifference = noteAbsolutePpq - nearestQuarterNotePpq;
-                    const double msDifference = ppqDifference * (60000.0 / ppqPerMinute);
-                    lastTimingDifferenceMs.store(msDifference);
+                    if (controllerTriggers.process (channel, number, value))
+                        addOnset (samplePosition, notePpq, number, value, channel, true);
+
+                    if (number == ControllerTriggers::sustainPedal)
+                        noteTracker.sustainPedal (channel, value >= 64, notePpq, pushDuration);
+                    else if (number == allNotesOffController || number == allSoundOffController)
+                        noteTracker.allNotesOff (channel, notePpq, pushDuration);
                 }
             }
+
+            if (timingEvents.getNumReady() > 0 || noteDurations.getNumReady() > 0)
+                workerPool->notify();
+
+            // Every note of this block is in, so a cluster may now be complete
+            if (clusterer.advanceTo (sampleClock, cluster))
+                publishCluster (cluster);
         }
-        else // BPM is not positive
+        else // No usable tempo, position or sample rate
         {
-             lastTimingDifferenceMs.store(0.0);
+             clusterer.reset();
+
+             // Held notes and pedals can't be timed across the gap, so they're dropped once as it starts
+             if (hadUsablePosition)
+             {
+                 noteTracker.reset();
+                 controllerTriggers.reset();
+             }
+
+             if (! isPractising())
+                 lastTimingDifferenceMs.store(0.0);
         }
     }
     else // If not playing or playhead unavailable
     {
-        currentPpqPosition.store(-1.0);
-        lastTimingDifferenceMs.store(0.0);
+        updateTransportState (false, {}, blockStartSample);
+        currentPpqPosition.store (isPractising() ? practice->getCurrentPpq() : -1.0);
+        clusterer.reset();
+
+        // A practice session publishes its own notes' deviations here
+        if (! isPractising())
+            lastTimingDifferenceMs.store(0.0);
     }
     // --- End of Timing Logic ---
 
@@ -208,6 +617,73 @@ void PocketAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce:
     // For now, we'll leave midiMessages unmodified to pass MIDI through.
 }
 
+void PocketAudioProcessor::publishCluster (const NoteClusterer::Cluster& cluster) noexcept
+{
+    lastTimingDifferenceMs.store (cluster.onsetDeviationMs);
+    lastClusterSpreadMs.store (cluster.spreadMs);
+    lastClusterSize.store (cluster.numNotes);
+}
+
+void PocketAudioProcessor::updateTransportState (bool isPlaying, const juce::Optional<juce::AudioPlayHead::PositionInfo>& position,
+                                                 juce::int64 blockStartSample) noexcept
+{
+    // Notes and pedals held across a stop or a jump aren't timed; clearing them is too big a job for every block
+    const auto forgetHeldNotes = [this]
+    {
+        noteTracker.reset();
+        controllerTriggers.reset();
+        wasUsablePosition = false;
+    };
+
+    if (isPlaying)
+    {
+        const auto timeInSamples = position.hasValue() ? position->getTimeInSamples() : juce::Optional<int64_t>();
+        const auto ppq = position.hasValue() ? position->getPpqPosition() : juce::Optional<double>();
+        const auto bpm = position.hasValue() ? position->getBpm() : juce::Optional<double>();
+
+        if (! wasPlaying)
+        {
+            ++currentTake;
+        }
+        else if (hasJumped (timeInSamples, ppq, blockStartSample))
+        {
+            // Stopped and restarted between idle blocks, or looped: also a new take
+            ++currentTake;
+            forgetHeldNotes();
+        }
+
+        lastPlayingBlockStart = blockStartSample;
+        lastTimeInSamples = timeInSamples;
+        lastPpq = ppq.hasValue() && std::isfinite (*ppq) ? ppq : juce::Optional<double>();
+        lastBpm = bpm.hasValue() && std::isfinite (*bpm) && *bpm > 0.0 ? bpm : juce::Optional<double>();
+    }
+    else if (wasPlaying)
+    {
+        forgetHeldNotes();
+    }
+
+    wasPlaying = isPlaying;
+}
+
+bool PocketAudioProcessor::hasJumped (juce::Optional<int64_t> timeInSamples, juce::Optional<double> ppq,
+                                      juce::int64 blockStartSample) const noexcept
+{
+    // Blocks skipped by the idle path played on, so the host's position should have moved just as far
+    const auto elapsedSamples = blockStartSample - lastPlayingBlockStart;
+    const auto sampleRate = getSampleRate();
+    const auto toleranceSeconds = maxTransportDriftMs * 0.001;
+
+    // The sample position is exact where the host moves it; some leave it at zero
+    if (timeInSamples.hasValue() && lastTimeInSamples.hasValue() && *timeInSamples != *lastTimeInSamples)
+        return std::abs ((double) (*timeInSamples - *lastTimeInSamples - elapsedSamples)) > toleranceSeconds * sampleRate;
+
+    if (! ppq.hasValue() || ! std::isfinite (*ppq) || ! lastPpq.hasValue() || ! lastBpm.hasValue() || sampleRate <= 0.0)
+        return false;
+
+    const auto expectedPpq = *lastPpq + (double) elapsedSamples / sampleRate * *lastBpm / 60.0;
+    return std::abs (*ppq - expectedPpq) > toleranceSeconds * *lastBpm / 60.0;
+}
+
 //==============================================================================
 bool PocketAudioProcessor::hasEditor() const
 {
@@ -222,15 +698,137 @@ juce::AudioProcessorEditor* PocketAudioProcessor::createEditor()
 //==============================================================================
 void PocketAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    if (auto xml = parameters.copyState().createXml())
+        copyXmlToBinary (*xml, destData);
 }
 
 void PocketAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    if (auto xml = getXmlFromBinary (data, sizeInBytes))
+        if (xml->hasTagName (parameters.state.getType()))
+        {
+            parameters.replaceState (juce::ValueTree::fromXml (*xml));
+
+            const juce::File referenceFile (parameters.state.getProperty (referenceFileProperty).toString());
+
+            if (referenceFile != currentReferenceFile && referenceFile.existsAsFile())
+                loadReference (referenceFile);
+        }
+}
+
+//==============================================================================
+void PocketAudioProcessor::updateTrackProperties (const TrackProperties& properties)
+{
+    if (properties.name.has_value() && properties.name->isNotEmpty())
+        ensemble->setMemberName (ensembleMemberId, *properties.name);
+}
+
+int PocketAudioProcessor::drainPending (int maxEvents)
+{
+    // Idle passes aren't traced, or the polling would fill the trace
+    [[maybe_unused]] const auto hasWork = timingEvents.getNumReady() > 0 || noteDurations.getNumReady() > 0
+                                           || (practice != nullptr && practice->getEvents().getNumReady() > 0);
+    POCKET_TRACE_SCOPE (*tracer, "drainPending", hasWork);
+
+    if (newSessionRequested.exchange (false))
+    {
+        rhythmTranscriber.clear();
+        grooveDetector.reset();
+        articulationAnalyser.reset();
+        scoreFollower.reset();
+    }
+
+    const auto grid = getGridSettings();
+    sessionAnalyser.setGrid (grid);
+
+    std::array<TimingEvent, AnalysisWorkerPool::drainBudget> batch;
+    int numEvents = 0;
+
+    timingEvents.pop (juce::jmin (maxEvents, (int) batch.size()),
+                      [&] (const TimingEvent& e) { batch[(size_t) numEvents++] = e; });
+
+    // Notes from a practice session go through the same analysis
+    if (practice != nullptr)
+        practice->getEvents().pop (juce::jmin (maxEvents, (int) batch.size()) - numEvents,
+                                   [&] (const TimingEvent& e) { batch[(size_t) numEvents++] = e; });
+
+    if (numEvents > 0)
+    {
+        lastNoteMs = juce::Time::getMillisecondCounter();
+        ensemble->addEvents (ensembleMemberId, batch.data(), numEvents);
+
+        {
+            POCKET_TRACE_SCOPE (*tracer, "session log write");
+            recorder.write (batch.data(), numEvents);
+        }
+
+        const auto firstNoteIndex = sessionAnalyser.addEvents (batch.data(), numEvents);
+
+        {
+            POCKET_TRACE_SCOPE (*tracer, "groove and reference");
+            grooveDetector.addNotes (batch.data(), numEvents, grid.latencyMs);
+
+            if (grid.reference != nullptr)
+                scoreFollower.process (grid, batch.data(), numEvents);
+
+            rhythmTranscriber.process (grid, batch.data(), numEvents, firstNoteIndex);
+        }
+    }
+
+    // The player or the transport has stopped: once it's been quiet for a while, decide
+    // the notes still waiting. The audio thread doesn't watch for stops between notes.
+    if (rhythmTranscriber.hasUndecidedNotes())
+    {
+        const auto silentMs = (int) (juce::Time::getMillisecondCounter() - lastNoteMs);
+
+        if (silentMs >= decoderSilenceMs)
+            rhythmTranscriber.reset();
+        else
+            workerPool->notifyAfter (decoderSilenceMs - silentMs);
+    }
+
+    // Every decided note keeps the deviation from its own subdivision
+    rhythmTranscriber.popDecisions (inferredDeviations);
+    sessionAnalyser.setInferredDeviations (inferredDeviations.data(), (int) inferredDeviations.size());
+
+    // Finished notes share the budget with the note-ons
+    std::array<NoteDuration, AnalysisWorkerPool::drainBudget> durations;
+    int numDurations = 0;
+
+    noteDurations.pop (juce::jmin (maxEvents - numEvents, (int) durations.size()),
+                       [&] (const NoteDuration& d) { durations[(size_t) numDurations++] = d; });
+
+    articulationAnalyser.process (grid.inferred ? getLiveGridSettings() : grid, durations.data(), numDurations);
+
+    return numEvents + numDurations;
+}
+
+//==============================================================================
+bool PocketAudioProcessor::startRecording (const juce::File& file)
+{
+    return recorder.start (file, getSampleRate());
+}
+
+void PocketAudioProcessor::stopRecording()
+{
+    recorder.stop();
+}
+
+void PocketAudioProcessor::startNewSession()
+{
+    saveProgress();
+    sessionAnalyser.clear();
+
+    // The other analysers belong to the workers, so they start over on the next pass
+    newSessionRequested = true;
+    workerPool->wakeUp();
+}
+
+void PocketAudioProcessor::saveProgress()
+{
+    // Skip instances that barely saw any notes, e.g. ones created by a plugin scan
+    if (sessionAnalyser.getStatistics().numNotes >= minNotesForProgress)
+        ProgressDatabase::append (ProgressDatabase::getDefaultFile(), sessionAnalyser.createSummary());
 }
 
 //==============================================================================
@@ -239,3 +837,692 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
     return new PocketAudioProcessor();
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+#include "CorpusGenerator.h"
+#include "SessionLogReader.h"
+
+class PocketAudioProcessorTests  : public juce::UnitTest
+{
+public:
+    PocketAudioProcessorTests()  : juce::UnitTest ("PocketAudioProcessor", "Pocket") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 128;
+
+        // As a host would
+        const auto prepare = [] (PocketAudioProcessor& processor)
+        {
+            processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+            processor.prepareToPlay (sampleRate, blockSize);
+        };
+
+        beginTest ("Idle instances cost almost nothing");
+        {
+            constexpr int numInstances = 500, numBlocks = 1000;
+
+            std::vector<std::unique_ptr<PocketAudioProcessor>> instances;
+            PlayingHead playHead;
+
+            for (int i = 0; i < numInstances; ++i)
+            {
+                instances.push_back (std::make_unique<PocketAudioProcessor>());
+                instances.back()->setPlayHead (&playHead);
+                prepare (*instances.back());
+            }
+
+            juce::AudioBuffer<float> buffer (2, blockSize);
+            juce::MidiBuffer midi;
+            const auto startTicks = juce::Time::getHighResolutionTicks();
+
+            for (int block = 0; block < numBlocks; ++block)
+                for (auto& instance : instances)
+                    instance->processBlock (buffer, midi);
+
+            const auto seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+            const auto nsPerBlock = seconds * 1.0e9 / (numInstances * numBlocks);
+            const auto shareOfCore = seconds / (numBlocks * blockSize / sampleRate);
+
+            logMessage (juce::String (nsPerBlock, 1) + " ns per idle block; " + juce::String (numInstances) + " idle instances use "
+                        + juce::String (100.0 * shareOfCore, 3) + "% of one core at " + juce::String (blockSize) + " samples");
+
+            // Generous, so it holds in a debug build with the real-time checks on
+            expectLessThan (nsPerBlock, 5000.0);
+            expectEquals (instances.front()->getBlockProfiler().getReport().numBlocks, (juce::int64) 0);
+            expectEquals (playHead.numQueries.load(), 0, "idle blocks asked the playhead");
+        }
+
+        beginTest ("A block with notes asks the playhead once");
+        {
+            PocketAudioProcessor processor;
+            PlayingHead playHead;
+            processor.setPlayHead (&playHead);
+            prepare (processor);
+
+            juce::AudioBuffer<float> buffer (2, blockSize);
+            juce::MidiBuffer midi;
+            midi.addEvent (juce::MidiMessage::noteOn (1, 38, (juce::uint8) 100), 10);
+
+            processor.processBlock (buffer, midi);
+            expectEquals (playHead.numQueries.load(), 1);
+        }
+
+        beginTest ("A chord waiting for more notes is finished by idle blocks");
+        {
+            PocketAudioProcessor processor;
+            PlayingHead playHead;
+            processor.setPlayHead (&playHead);
+            prepare (processor);
+
+            juce::AudioBuffer<float> buffer (2, blockSize);
+            juce::MidiBuffer midi;
+            midi.addEvent (juce::MidiMessage::noteOn (1, 60, (juce::uint8) 100), 10);
+            midi.addEvent (juce::MidiMessage::noteOn (1, 64, (juce::uint8) 100), 20);
+            processor.processBlock (buffer, midi);
+            expectEquals (processor.lastClusterSize.load(), 0);
+
+            midi.clear();
+            const auto windowBlocks = (int) std::ceil (NoteClusterer::defaultWindowMs * 0.001 * sampleRate / blockSize);
+
+            for (int block = 0; block <= windowBlocks; ++block)
+                processor.processBlock (buffer, midi);
+
+            expectEquals (processor.lastClusterSize.load(), 2);
+        }
+
+        beginTest ("A transport restart between idle blocks starts a new take");
+        {
+            PocketAudioProcessor processor;
+            PlayingHead playHead;
+            processor.setPlayHead (&playHead);
+            prepare (processor);
+
+            juce::AudioBuffer<float> buffer (2, blockSize);
+            juce::MidiBuffer note, empty;
+            note.addEvent (juce::MidiMessage::noteOn (1, 60, (juce::uint8) 100), 0);
+
+            processor.processBlock (buffer, note);
+
+            // No editor and no notes, so these take the idle path; meanwhile the host
+            // stops, goes back to the top and starts again
+            for (int block = 0; block < 10; ++block)
+                processor.processBlock (buffer, empty);
+
+            playHead.timeInSamples = 0;
+            processor.processBlock (buffer, note);
+
+            // Playing on from there, through more idle blocks, is still the same take
+            for (int block = 0; block < 10; ++block)
+                processor.processBlock (buffer, empty);
+
+            playHead.timeInSamples = 11 * blockSize;
+            processor.processBlock (buffer, note);
+            waitForAnalysis (processor);
+
+            auto& analyser = processor.getSessionAnalyser();
+            expectEquals (analyser.getStatistics().numNotes, (juce::int64) 3);
+            expectEquals (analyser.query (EventFilter::fromString ("take=1")).numNotes, (juce::int64) 1);
+            expectEquals (analyser.query (EventFilter::fromString ("take=2")).numNotes, (juce::int64) 2);
+
+            analyser.clear();
+        }
+
+        beginTest ("A jump without a time in samples is found from the PPQ position");
+        {
+            PocketAudioProcessor processor;
+            PlayingHead playHead;
+            playHead.hasTimeInSamples = false;
+            processor.setPlayHead (&playHead);
+            prepare (processor);
+
+            juce::AudioBuffer<float> buffer (2, blockSize);
+            juce::MidiBuffer note, empty;
+            note.addEvent (juce::MidiMessage::noteOn (1, 60, (juce::uint8) 100), 0);
+
+            // Played on for ten idle blocks, then looped back 10 blocks
+            processor.processBlock (buffer, note);
+
+            for (int block = 0; block < 10; ++block)
+                processor.processBlock (buffer, empty);
+
+            playHead.timeInSamples = 11 * blockSize;
+            processor.processBlock (buffer, note);
+            playHead.timeInSamples = 1 * blockSize;
+            processor.processBlock (buffer, note);
+            waitForAnalysis (processor);
+
+            auto& analyser = processor.getSessionAnalyser();
+            expectEquals (analyser.query (EventFilter::fromString ("take=1")).numNotes, (juce::int64) 2);
+            expectEquals (analyser.query (EventFilter::fromString ("take=2")).numNotes, (juce::int64) 1);
+
+            analyser.clear();
+        }
+
+        beginTest ("Notes the decoder holds back are decided once the player has been silent a while");
+        {
+            PocketAudioProcessor processor;
+            PlayingHead playHead;
+            processor.setPlayHead (&playHead);
+            prepare (processor);
+
+            juce::AudioBuffer<float> buffer (2, blockSize);
+            juce::MidiBuffer midi;
+
+            // Fewer notes than the decoder's lag, so none is decided while playing
+            for (int i = 0; i < 3; ++i)
+                midi.addEvent (juce::MidiMessage::noteOn (1, 60 + i, (juce::uint8) 100), i * 40);
+
+            // On the workers' clock, which counts whole milliseconds
+            const auto startMs = juce::Time::getMillisecondCounter();
+            processor.processBlock (buffer, midi);
+            waitForAnalysis (processor);
+            expectEquals (processor.getRhythmTranscriber().getResults().deviations.numNotes, (juce::int64) 0);
+
+            // No more blocks, not even idle ones: the workers don't need the audio thread to notice
+            while (processor.getRhythmTranscriber().getResults().deviations.numNotes == 0
+                    && (int) (juce::Time::getMillisecondCounter() - startMs) < 4 * PocketAudioProcessor::decoderSilenceMs)
+                juce::Thread::sleep (20);
+
+            expectEquals (processor.getRhythmTranscriber().getResults().deviations.numNotes, (juce::int64) 3);
+            expectGreaterOrEqual ((int) (juce::Time::getMillisecondCounter() - startMs), PocketAudioProcessor::decoderSilenceMs);
+            processor.getSessionAnalyser().clear();
+        }
+
+        beginTest ("A long SysEx in a playing block doesn't allocate");
+        {
+            PocketAudioProcessor processor;
+            PlayingHead playHead;
+            processor.setPlayHead (&playHead);
+            prepare (processor);
+
+            // Past juce::MidiMessage's 8 bytes of inline storage, next to a note so the full path runs
+            const juce::uint8 sysEx[] = { 0xf0, 0x43, 0x10, 0x4c, 0x00, 0x00, 0x7e, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0xf7 };
+            juce::AudioBuffer<float> buffer (2, blockSize);
+            juce::MidiBuffer midi;
+            midi.addEvent (sysEx, (int) sizeof (sysEx), 10);
+            midi.addEvent (juce::MidiMessage::noteOn (1, 60, (juce::uint8) 100), 20);
+
+            const auto violationsBefore = RealtimeSafety::getNumViolations();
+            processor.processBlock (buffer, midi);
+
+            expectEquals (RealtimeSafety::getNumViolations() - violationsBefore, 0, "the audio thread allocated, locked or did I/O");
+            discardSession (processor);
+        }
+
+        beginTest ("Random MIDI and playhead states are survived in real time");
+        {
+            constexpr int numBlocks = 20000;
+
+            PocketAudioProcessor processor;
+            FuzzedHead playHead;
+            processor.setPlayHead (&playHead);
+            prepare (processor);
+
+            auto random = getRandom();
+            juce::AudioBuffer<float> storage (2, blockSize);
+            juce::MidiBuffer midi;
+            midi.ensureSize (4096);
+
+           #if ! POCKET_REALTIME_SAFETY_CHECKS
+            logMessage ("Real-time checks are compiled out, so allocations and locks go unnoticed");
+           #endif
+
+            const auto violationsBefore = RealtimeSafety::getNumViolations();
+            int numNonFinite = 0;
+            bool editorShowing = false;
+            double totalSeconds = 0.0, worstSeconds = 0.0, totalAudioSeconds = 0.0;
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                // Everything random is made here, outside the real-time scope
+                const auto numSamples = random.nextInt ({ 0, blockSize + 1 });
+                juce::AudioBuffer<float> buffer (storage.getArrayOfWritePointers(), 2, numSamples);
+                fillRandomMidi (midi, random, numSamples);
+                playHead.position = createRandomPosition (random, block);
+
+                if (random.nextInt (200) == 0)
+                {
+                    // Parameter changes re-measure the session on the workers while blocks keep coming
+                    auto* parameter = processor.getParameters()[random.nextInt (processor.getParameters().size())];
+                    parameter->setValueNotifyingHost (random.nextFloat());
+                }
+
+                // An editor opening and closing switches between the idle and the full path
+                if (random.nextInt (500) == 0)
+                {
+                    editorShowing = ! editorShowing;
+
+                    if (editorShowing)
+                        processor.addDisplayConsumer();
+                    else
+                        processor.removeDisplayConsumer();
+                }
+
+                const auto startTicks = juce::Time::getHighResolutionTicks();
+                processor.processBlock (buffer, midi);
+                const auto seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+
+                totalSeconds += seconds;
+                worstSeconds = juce::jmax (worstSeconds, seconds);
+                totalAudioSeconds += numSamples / sampleRate;
+
+                for (const auto value : { processor.lastTimingDifferenceMs.load(), processor.lastClusterSpreadMs.load(), processor.currentPpqPosition.load() })
+                    if (! std::isfinite (value))
+                        ++numNonFinite;
+            }
+
+            logMessage (juce::String (numBlocks) + " random blocks took " + juce::String (100.0 * totalSeconds / totalAudioSeconds, 2)
+                        + "% of their real time; the worst took " + juce::String (worstSeconds * 1000.0, 3) + " ms");
+
+            expectEquals (numNonFinite, 0, "a non-finite value was published");
+            expectEquals (RealtimeSafety::getNumViolations() - violationsBefore, 0, "the audio thread allocated, locked or did I/O");
+
+            // Generous, so they hold in a debug build with the real-time checks on
+            expectLessThan (totalSeconds, 0.1 * totalAudioSeconds);
+            expectLessThan (worstSeconds, 0.02);
+
+            discardSession (processor);
+        }
+
+        // Plays a corpus through a processor set to a grid, recording what it measures;
+        // returns the time spent in processBlock()
+        const auto renderCorpus = [&] (PocketAudioProcessor& processor, const CorpusGenerator& corpus, int division, const juce::File& log)
+        {
+            // Auto and Inferred grids learn from the notes on the workers, which keep up with a host
+            // playing in real time. Rendering thousands of times faster, the test waits for them.
+            const auto keepPaceWithWorkers = division == GridSettings::autoDivision || division == GridSettings::inferredDivision;
+
+            CorpusHead playHead (corpus);
+            processor.setPlayHead (&playHead);
+            prepare (processor);
+
+            auto* grid = processor.parameters.getParameter ("grid");
+            grid->setValueNotifyingHost (grid->convertTo0to1 ((float) division));
+
+            auto* swing = processor.parameters.getParameter ("swing");
+            swing->setValueNotifyingHost (swing->convertTo0to1 ((float) (corpus.getSettings().swing * 100.0)));
+
+            expect (processor.startRecording (log));
+
+            juce::AudioBuffer<float> buffer (2, blockSize);
+            juce::MidiBuffer midi;
+            double processSeconds = 0.0;
+            juce::int64 numNotesSent = 0;
+            const auto numBlocks = (int) std::ceil (corpus.getLengthSeconds() * sampleRate / blockSize);
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                const auto blockStart = (juce::int64) block * blockSize;
+                midi.clear();
+                corpus.renderBlock (midi, blockStart, blockSize, sampleRate);
+                playHead.seconds = (double) blockStart / sampleRate;
+
+                const auto startTicks = juce::Time::getHighResolutionTicks();
+                processor.processBlock (buffer, midi);
+                processSeconds += juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+
+                for (const auto metadata : midi)
+                    numNotesSent += (metadata.data[0] & 0xf0) == 0x90 && metadata.data[2] != 0 ? 1 : 0;
+
+                while (keepPaceWithWorkers && processor.getSessionAnalyser().getStatistics().numNotes < numNotesSent)
+                    juce::Thread::sleep (1);
+            }
+
+            waitForAnalysis (processor);
+            processor.stopRecording();
+            processor.setPlayHead (nullptr);
+            expectEquals (processor.getRecorder().getError(), juce::String());
+            expectEquals ((int) processor.getNumDroppedEvents(), 0);
+            return processSeconds;
+        };
+
+        // Pairs every note played (including flams and extra notes) with the deviation the
+        // log holds for it. Each note number's notes are far apart, so they pair up in order.
+        struct MeasuredNote
+        {
+            const CorpusGenerator::Note* note = nullptr;
+            double deviationMs = 0.0;
+        };
+
+        const auto readLog = [&] (const CorpusGenerator& corpus, const juce::File& log)
+        {
+            std::map<int, std::vector<const CorpusGenerator::Note*>> played;
+            std::map<int, std::vector<double>> measured;
+
+            for (const auto& note : corpus.getNotes())
+                if (note.label != CorpusGenerator::Label::missed)
+                    played[note.noteNumber].push_back (&note);
+
+            SessionLogReader reader;
+            expect (reader.open (log));
+
+            for (juce::int64 i = 0; i < reader.getNumEvents(); ++i)
+                if (const auto e = reader.getEvent (i); ! e.isController)
+                    measured[e.note].push_back (e.deviationMs);
+
+            std::vector<MeasuredNote> result;
+
+            for (const auto& [noteNumber, notes] : played)
+            {
+                const auto& deviations = measured[noteNumber];
+                expectEquals ((int) deviations.size(), (int) notes.size(), "note " + juce::String (noteNumber));
+
+                for (size_t i = 0; i < juce::jmin (notes.size(), deviations.size()); ++i)
+                    result.push_back ({ notes[i], deviations[i] });
+            }
+
+            std::sort (result.begin(), result.end(), [] (const auto& a, const auto& b) { return a.note->playedPpq < b.note->playedPpq; });
+            return result;
+        };
+
+        // How far the played notes (not flams or extras) from firstPpq on were measured from their true offsets
+        struct MeasuredError
+        {
+            double meanMs = 0.0, worstMs = 0.0;
+            double shareWithin1Ms = 0.0;
+            int numNotes = 0;
+        };
+
+        const auto measureError = [] (const std::vector<MeasuredNote>& notes, double firstPpq)
+        {
+            MeasuredError result;
+            int numWithin1Ms = 0;
+
+            for (const auto& n : notes)
+            {
+                if (n.note->label != CorpusGenerator::Label::played || n.note->intendedPpq < firstPpq)
+                    continue;
+
+                const auto errorMs = std::abs (n.deviationMs - n.note->offsetMs);
+                result.meanMs += errorMs;
+                result.worstMs = juce::jmax (result.worstMs, errorMs);
+                numWithin1Ms += errorMs < 1.0 ? 1 : 0;
+                ++result.numNotes;
+            }
+
+            result.meanMs /= juce::jmax (1, result.numNotes);
+            result.shareWithin1Ms = numWithin1Ms / (double) juce::jmax (1, result.numNotes);
+            return result;
+        };
+
+        for (int style = 0; style < CorpusGenerator::getStyleNames().size(); ++style)
+        {
+            beginTest ("A steady " + CorpusGenerator::getStyleNames()[style] + " performance is measured to the sample");
+
+            CorpusGenerator::Settings settings;
+            settings.style = (CorpusGenerator::Style) style;
+            settings.numBars = 32;
+            settings.seed = style + 1;
+            const CorpusGenerator corpus (settings);
+
+            PocketAudioProcessor processor;
+            const auto log = juce::File::createTempFile (".pocketlog");
+
+            // Measured against the grid the corpus was played on
+            const auto processSeconds = renderCorpus (processor, corpus, settings.division, log);
+            discardSession (processor);
+
+            const auto measured = readLog (corpus, log);
+            const auto error = measureError (measured, 0.0);
+            expectEquals ((int) measured.size(), error.numNotes);
+
+            // A note arrives on the sample its time falls in, so it can be measured up to a sample early
+            expectLessThan (error.worstMs, 1000.0 / sampleRate + 0.001);
+
+            const auto audioSeconds = corpus.getLengthSeconds();
+            logMessage (juce::String (error.numNotes) + " notes measured with a mean error of " + juce::String (error.meanMs, 4)
+                        + " ms (worst " + juce::String (error.worstMs, 4) + " ms); " + juce::String (audioSeconds, 1) + " s rendered in "
+                        + juce::String (processSeconds * 1000.0, 2) + " ms, " + juce::String (juce::roundToInt (audioSeconds / processSeconds)) + "x real time");
+
+            expectLessThan (processSeconds, 0.1 * audioSeconds);
+            log.deleteFile();
+        }
+
+        {
+            // Swung eighths on a drifting tempo, with flams, missed and extra notes
+            CorpusGenerator::Settings settings;
+            settings.style = CorpusGenerator::Style::drums;
+            settings.numBars = 64;
+            settings.division = 1;
+            settings.swing = 0.6;
+            settings.startBpm = 90.0;
+            settings.endBpm = 110.0;
+            settings.tempoWobbleBpm = 1.5;
+            settings.flamShare = 0.05;
+            settings.missShare = 0.05;
+            settings.extraShare = 0.05;
+            settings.seed = 7;
+            const CorpusGenerator corpus (settings);
+
+            int numMissed = 0, numExtra = 0;
+
+            for (const auto& note : corpus.getNotes())
+            {
+                numMissed += note.label == CorpusGenerator::Label::missed ? 1 : 0;
+                numExtra += note.label == CorpusGenerator::Label::flam || note.label == CorpusGenerator::Label::extra ? 1 : 0;
+            }
+
+            // The reference is the part as written, missed notes included
+            const auto referenceFile = juce::File::createTempFile (".mid");
+            {
+                juce::MidiMessageSequence sequence;
+
+                for (const auto& note : corpus.getNotes())
+                    if (note.label == CorpusGenerator::Label::played || note.label == CorpusGenerator::Label::missed)
+                        sequence.addEvent (juce::MidiMessage::noteOn (note.channel, note.noteNumber, (juce::uint8) 100), note.intendedPpq * 960.0);
+
+                juce::MidiFile midiFile;
+                midiFile.setTicksPerQuarterNote (960);
+                midiFile.addTrack (sequence);
+                juce::FileOutputStream out (referenceFile);
+                expect (midiFile.writeTo (out));
+            }
+
+            const auto secondHalfPpq = 4.0 * (CorpusGenerator::leadInBars + settings.numBars / 2);
+
+            for (const auto division : { settings.division, GridSettings::autoDivision, GridSettings::inferredDivision, GridSettings::referenceDivision })
+            {
+                const auto gridName = GridSettings::getDivisionNames()[division];
+                beginTest ("An untidy drum performance is measured on the " + gridName + " grid");
+
+                PocketAudioProcessor processor;
+
+                if (division == GridSettings::referenceDivision)
+                    expect (processor.loadReference (referenceFile));
+
+                const auto log = juce::File::createTempFile (".pocketlog");
+                const auto processSeconds = renderCorpus (processor, corpus, division, log);
+                const auto followed = processor.getScoreFollower().getResults();
+                discardSession (processor);
+
+                // The fixed grid and the reference know the swing from the start; Auto and
+                // Inferred are judged once they've had half the performance to settle
+                const auto measured = readLog (corpus, log);
+                const auto isLearning = division == GridSettings::autoDivision || division == GridSettings::inferredDivision;
+                const auto error = measureError (measured, isLearning ? secondHalfPpq : 0.0);
+
+                const auto audioSeconds = corpus.getLengthSeconds();
+                logMessage (gridName + ": " + juce::String (error.numNotes) + " played notes measured with a mean error of " + juce::String (error.meanMs, 4)
+                            + " ms (worst " + juce::String (error.worstMs, 4) + " ms, " + juce::String (100.0 * error.shareWithin1Ms, 1)
+                            + "% within 1 ms); " + juce::String (juce::roundToInt (audioSeconds / processSeconds)) + "x real time");
+
+                expectGreaterThan (error.numNotes, 0);
+
+                if (isLearning)
+                {
+                    // The decoder can still take a note near a flam or an extra one for a finer subdivision
+                    expectLessThan (error.meanMs, 1.0);
+                    expectGreaterOrEqual (error.shareWithin1Ms, 0.95);
+                }
+                else
+                {
+                    // A bar's tempo changes under a note played early into it, by up to half a millisecond
+                    expectLessThan (error.meanMs, 0.1);
+                    expectLessThan (error.worstMs, 1.0);
+                }
+
+                expectLessThan (processSeconds, 0.1 * audioSeconds);
+
+                if (division == GridSettings::referenceDivision)
+                {
+                    logMessage ("Score follower: " + juce::String (followed.numMissed) + " missed of " + juce::String (numMissed)
+                                + ", " + juce::String (followed.numExtra) + " extra of " + juce::String (numExtra));
+
+                    // A missed hi-hat next to an extra one can be taken for a late note, so allow a few
+                    expectWithinAbsoluteError ((int) followed.numMissed, numMissed, 3);
+                    expectWithinAbsoluteError ((int) followed.numExtra, numExtra, 3);
+                }
+
+                log.deleteFile();
+            }
+
+            referenceFile.deleteFile();
+        }
+    }
+
+private:
+    // A transport playing at 120 bpm, at whatever position the test gives it; counts how often it's asked
+    struct PlayingHead  : public juce::AudioPlayHead
+    {
+        juce::Optional<PositionInfo> getPosition() const override
+        {
+            ++numQueries;
+
+            PositionInfo info;
+            info.setIsPlaying (true);
+            info.setBpm (120.0);
+            info.setPpqPosition ((double) timeInSamples / 48000.0 * 2.0);
+            info.setTimeSignature (TimeSignature {});
+
+            if (hasTimeInSamples)
+                info.setTimeInSamples (timeInSamples);
+
+            return info;
+        }
+
+        juce::int64 timeInSamples = 0;      // At the test's 48 kHz
+        bool hasTimeInSamples = true;
+        mutable std::atomic<int> numQueries { 0 };
+    };
+
+    // Plays the corpus' tempo map from the top
+    struct CorpusHead  : public juce::AudioPlayHead
+    {
+        explicit CorpusHead (const CorpusGenerator& c)  : corpus (c) {}
+
+        juce::Optional<PositionInfo> getPosition() const override
+        {
+            PositionInfo info;
+            const auto ppq = corpus.getPpqAtSeconds (seconds);
+            info.setIsPlaying (true);
+            info.setBpm (corpus.getBpmAtPpq (ppq));
+            info.setPpqPosition (ppq);
+            info.setTimeSignature (TimeSignature {});
+            return info;
+        }
+
+        const CorpusGenerator& corpus;
+        double seconds = 0.0;
+    };
+
+    // Returns whatever position the test last gave it
+    struct FuzzedHead  : public juce::AudioPlayHead
+    {
+        juce::Optional<PositionInfo> getPosition() const override   { return position; }
+
+        juce::Optional<PositionInfo> position;
+    };
+
+    // A mix of values a confused host might send, from sensible to absurd
+    static double pickValue (juce::Random& random, double sensible)
+    {
+        switch (random.nextInt (10))
+        {
+            case 0:  return std::numeric_limits<double>::quiet_NaN();
+            case 1:  return random.nextBool() ? std::numeric_limits<double>::infinity() : -std::numeric_limits<double>::infinity();
+            case 2:  return 0.0;
+            case 3:  return -sensible;
+            case 4:  return random.nextBool() ? 1.0e300 : std::numeric_limits<double>::denorm_min();
+            default: return sensible;
+        }
+    }
+
+    // Mostly a playing transport at a steady position, with every field sometimes missing or broken
+    static juce::Optional<juce::AudioPlayHead::PositionInfo> createRandomPosition (juce::Random& random, int block)
+    {
+        if (random.nextInt (20) == 0)
+            return {};
+
+        juce::AudioPlayHead::PositionInfo info;
+        info.setIsPlaying (random.nextInt (10) != 0);
+
+        if (random.nextInt (10) != 0)
+            info.setBpm (pickValue (random, 40.0 + random.nextDouble() * 200.0));
+
+        if (random.nextInt (10) != 0)
+            info.setPpqPosition (pickValue (random, block * 0.0533));
+
+        if (random.nextInt (10) != 0)
+            info.setTimeSignature (juce::AudioPlayHead::TimeSignature { random.nextInt ({ -1, 17 }), random.nextInt ({ -1, 33 }) });
+
+        if (random.nextInt (10) != 0)
+            info.setHostTimeNs ((juce::uint64) random.nextInt64());
+
+        info.setTimeInSamples (random.nextInt64());
+        return info;
+    }
+
+    // Notes, controllers, SysEx and raw garbage (stray data bytes, running status,
+    // truncated messages), at positions inside, outside and far beyond the block
+    static void fillRandomMidi (juce::MidiBuffer& midi, juce::Random& random, int numSamples)
+    {
+        midi.clear();
+
+        for (int i = random.nextInt (random.nextInt (10) == 0 ? 64 : 4); --i >= 0;)
+        {
+            const auto position = random.nextInt (10) == 0 ? random.nextInt()
+                                                           : random.nextInt ({ -numSamples - 1, 2 * numSamples + 2 });
+            juce::uint8 data[16];
+
+            for (auto& byte : data)
+                byte = (juce::uint8) random.nextInt (256);
+
+            switch (random.nextInt (5))
+            {
+                case 0:  data[0] = (juce::uint8) (0x90 | (data[0] & 0x0f)); data[1] &= 0x7f; data[2] &= 0x7f; break;
+                case 1:  data[0] = (juce::uint8) (0x80 | (data[0] & 0x0f)); data[1] &= 0x7f; break;
+                case 2:  data[0] = (juce::uint8) (0xb0 | (data[0] & 0x0f)); data[1] = (juce::uint8) random.nextInt ({ 0, 128 }); data[2] &= 0x7f; break;
+                case 3:  data[0] = 0xf0; break;
+                default: break;
+            }
+
+            midi.addEvent (data, random.nextInt ({ 1, (int) sizeof (data) + 1 }), position);
+        }
+    }
+
+    // Waits until the workers have stopped adding notes to the session
+    static void waitForAnalysis (PocketAudioProcessor& processor)
+    {
+        for (juce::int64 numNotes = -1; numNotes != processor.getSessionAnalyser().getStatistics().numNotes;)
+        {
+            numNotes = processor.getSessionAnalyser().getStatistics().numNotes;
+            juce::Thread::sleep (100);
+        }
+    }
+
+    // Keeps a test's notes out of the user's progress database: lets the workers
+    // finish with them, then forgets them before the processor is destroyed
+    static void discardSession (PocketAudioProcessor& processor)
+    {
+        waitForAnalysis (processor);
+        processor.getSessionAnalyser().clear();
+    }
+};
+
+static PocketAudioProcessorTests pocketAudioProcessorTests;
+
+#endif
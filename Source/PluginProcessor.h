@@ -10,11 +10,34 @@
 
 #include <JuceHeader.h>
 #include <atomic>
+#include "TimingEvent.h"
+#include "EnsembleAggregator.h"
+#include "AnalysisWorkerPool.h"
+#include "SessionRecorder.h"
+#include "SessionAnalyser.h"
+#include "MidiCaptureBuffer.h"
+#include "ReferenceGroove.h"
+#include "ScoreFollower.h"
+#include "RhythmTranscriber.h"
+#include "GrooveDetector.h"
+#include "NoteClusterer.h"
+#include "NoteDurationTracker.h"
+#include "ControllerTriggers.h"
+#include "PracticeSession.h"
+#include "MidiTimestampMonitor.h"
+#include "LatencyCalibrator.h"
+#include "BlockProfiler.h"
+#include "TraceRecorder.h"
+#include "RealtimeSafety.h"
+#include "ArticulationAnalyser.h"
+#include "TimingGrid.h"
 
 //==============================================================================
 /**
 */
-class PocketAudioProcessor  : public juce::AudioProcessor
+class PocketAudioProcessor  : public juce::AudioProcessor,
+                              private AnalysisWorkerPool::Client,
+                              private juce::AudioProcessorValueTreeState::Listener
 {
 public:
     //==============================================================================
@@ -54,12 +77,196 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-    // Public member to hold the latest timing difference for the editor to read
+    //==============================================================================
+    void updateTrackProperties (const TrackProperties& properties) override;
+
+    // The process-wide aggregator this instance reports its notes to
+    EnsembleAggregator& getEnsemble() noexcept { return *ensemble; }
+
+    //==============================================================================
+    // Session recording (message thread only)
+    bool startRecording (const juce::File& file);
+    void stopRecording();
+    const SessionRecorder& getRecorder() const noexcept { return recorder; }
+
+    // The last few minutes of notes, captured whether or not the transport is running
+    const MidiCaptureBuffer& getCapture() const noexcept { return capture; }
+
+    // The metronome and direct MIDI input for practising without a DAW (standalone app only, otherwise nullptr)
+    PracticeSession* getPracticeSession() noexcept { return practice.get(); }
+    bool isPractising() const noexcept { return practice != nullptr && practice->isRunning(); }
+
+    //==============================================================================
+    // Latency calibration: a click to tap along to, and the offsets measured with it
+    // for each input device. Profiles are kept in the plugin state; applying one sets
+    // the latency parameter. Message thread only.
+    LatencyCalibrator& getCalibrator() noexcept { return calibrator; }
+    void storeLatencyProfile (const juce::String& device, const LatencyCalibrator::Result& result);
+    bool applyLatencyProfile (const juce::String& device);
+    juce::StringArray getLatencyProfileNames() const;
+    juce::String getCurrentLatencyProfile() const;
+    LatencyCalibrator::Result getLatencyProfile (const juce::String& device) const;
+
+    // Whether the host's live MIDI timestamps are too coarse to trust
+    const MidiTimestampMonitor& getTimestampMonitor() const noexcept { return timestampMonitor; }
+
+    // How much of the real-time budget each processBlock() call that does any work takes
+    // (idle blocks return before it starts timing; empty if profiling is compiled out)
+    BlockProfiler& getBlockProfiler() noexcept { return blockProfiler; }
+
+    // Timeline of what the audio, analysis and message threads were doing (shared by all instances)
+    TraceRecorder& getTraceRecorder() noexcept { return *tracer; }
+
+    // Number of note events lost because the analysis workers fell behind
+    juce::uint32 getNumDroppedEvents() const noexcept { return numDroppedEvents.load(); }
+
+    //==============================================================================
+    // Grid, swing, latency, chord window, controller timing, snap compensation and ensemble anchor parameters
+    juce::AudioProcessorValueTreeState parameters;
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+
+    // Reads the current grid from the parameters (safe on any thread)
+    GridSettings getGridSettings() const noexcept;
+
+    // The same, with the "Inferred" grid's step set to the decoder's latest decision,
+    // for measuring notes that can't wait for their own
+    GridSettings getLiveGridSettings() const noexcept;
+
+    // Loads a .mid or .pocketlog to measure against when the grid is set to "Reference".
+    // The file is remembered in the plugin state and reloaded with it.
+    bool loadReference (const juce::File& file);
+    const ReferenceGroove* getReference() const noexcept { return currentReference.load(); }
+
+    // Matched, missed and extra notes against the reference (while the grid is "Reference")
+    const ScoreFollower& getScoreFollower() const noexcept { return scoreFollower; }
+
+    // Deviations measured against the subdivision each note was most likely meant as,
+    // and the latest division it decided. The notes it holds back are decided once no
+    // note has arrived for decoderSilenceMs.
+    const RhythmTranscriber& getRhythmTranscriber() const noexcept { return rhythmTranscriber; }
+    static constexpr int decoderSilenceMs = 2000;
+
+    // Note lengths and release timing, from pairing note-ons with their note-offs
+    const ArticulationAnalyser& getArticulationAnalyser() const noexcept { return articulationAnalyser; }
+
+    // The division and swing detected from the playing, used by the "Auto" grid
+    const GrooveDetector& getGrooveDetector() const noexcept { return grooveDetector; }
+
+    // Statistics for every note of the session, re-measured when the grid changes
+    SessionAnalyser& getSessionAnalyser() noexcept { return sessionAnalyser; }
+
+    // Adds the session so far to the progress database and starts the statistics over
+    // (message thread only)
+    void startNewSession();
+
+    // Public member to hold the latest timing difference for the editor to read.
+    // Chords and flams count once, with the deviation of their first note.
     std::atomic<double> lastTimingDifferenceMs { 0.0 };
+    // How many notes the latest onset had, and how far apart they were
+    std::atomic<double> lastClusterSpreadMs { 0.0 };
+    std::atomic<int> lastClusterSize { 0 };
     // Public member to hold the latest playhead position for the editor to read
     std::atomic<double> currentPpqPosition { 0.0 };
 
+    // Editors register while open, so idle blocks can skip the playhead query
+    // when nobody is looking at the playhead display
+    void addDisplayConsumer() noexcept     { ++numDisplayConsumers; }
+    void removeDisplayConsumer() noexcept  { --numDisplayConsumers; }
+
 private:
+    //==============================================================================
+    // Called by the shared analysis workers to forward queued note events
+    int drainPending (int maxEvents) override;
+
+    // Grid, swing or latency changed: the session has to be re-measured
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
+
+    // Adds this session to the progress database when the plugin is unloaded
+    void saveProgress();
+    static constexpr int minNotesForProgress = 16;
+
+    static constexpr int allSoundOffController = 120;
+    static constexpr int allNotesOffController = 123;
+
+    // Shows a finished chord or flam to the editor (audio thread)
+    void publishCluster (const NoteClusterer::Cluster&) noexcept;
+
+    // Follows transport starts, stops and jumps, as seen by the blocks that ask the playhead (audio thread)
+    void updateTransportState (bool isPlaying, const juce::Optional<juce::AudioPlayHead::PositionInfo>&,
+                               juce::int64 blockStartSample) noexcept;
+
+    // True if the host's position has moved other than by the samples played since the last playing block
+    bool hasJumped (juce::Optional<int64_t> timeInSamples, juce::Optional<double> ppq,
+                    juce::int64 blockStartSample) const noexcept;
+    static constexpr double maxTransportDriftMs = 10.0;
+
+    // Note events handed from the audio thread to the analysis workers
+    TimingEventFifo timingEvents;
+
+    NoteDurationFifo noteDurations;
+    juce::SharedResourcePointer<EnsembleAggregator> ensemble;
+    int ensembleMemberId = 0;
+
+    std::atomic<int> numDisplayConsumers { 0 };
+
+    // Samples processed since construction; timestamps every recorded event
+    juce::int64 sampleClock = 0;
+    std::atomic<juce::uint32> numDroppedEvents { 0 };
+
+    // Takes are counted by transport starts and jumps
+    juce::uint16 currentTake = 0;
+    bool wasPlaying = false;
+    bool wasUsablePosition = false;     // Whether the last playing block could be timed
+    juce::int64 lastPlayingBlockStart = 0;
+    juce::Optional<int64_t> lastTimeInSamples;
+    juce::Optional<double> lastPpq, lastBpm;
+
+    // When the workers last drained a note (worker threads only)
+    juce::uint32 lastNoteMs = 0;
+
+    // Set by startNewSession() for the workers
+    std::atomic<bool> newSessionRequested { false };
+
+    SessionRecorder recorder;
+    MidiCaptureBuffer capture;
+    NoteClusterer clusterer;
+    MidiTimestampMonitor timestampMonitor;
+    LatencyCalibrator calibrator;
+    BlockProfiler blockProfiler;
+    juce::uint64 lastHostTimeNs = 0;
+    NoteDurationTracker noteTracker;
+    ControllerTriggers controllerTriggers;
+
+    std::atomic<float>* gridParameter = nullptr;
+    std::atomic<float>* swingParameter = nullptr;
+    std::atomic<float>* latencyParameter = nullptr;
+    std::atomic<float>* chordWindowParameter = nullptr;
+    std::atomic<float>* hiHatParameter = nullptr;
+    std::atomic<float>* pedalParameter = nullptr;
+    std::atomic<float>* snapCompensationParameter = nullptr;
+    std::atomic<float>* ensembleAnchorParameter = nullptr;
+
+    // Every reference loaded so far, so pointers held by the audio thread or a running
+    // re-analysis stay valid; swapping in a new one is a single atomic store.
+    juce::OwnedArray<ReferenceGroove> loadedReferences;
+    std::atomic<const ReferenceGroove*> currentReference { nullptr };
+    juce::File currentReferenceFile;
+    static constexpr const char* referenceFileProperty = "referenceFile";
+    static constexpr const char* latencyProfileProperty = "latencyProfile";
+    ScoreFollower scoreFollower;
+    RhythmTranscriber rhythmTranscriber;
+    std::vector<RhythmTranscriber::Decision> inferredDeviations;    // Worker thread
+    GrooveDetector grooveDetector;
+    ArticulationAnalyser articulationAnalyser;
+
+    // Declared after the pool it runs on, so it's built after it and destroyed before it
+    juce::SharedResourcePointer<AnalysisWorkerPool> workerPool;
+    juce::SharedResourcePointer<TraceRecorder> tracer;
+    SessionAnalyser sessionAnalyser { *workerPool };
+
+    // Declared last, so its timer stops before anything it reads is destroyed
+    std::unique_ptr<PracticeSession> practice;
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PocketAudioProcessor)
 };
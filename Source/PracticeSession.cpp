@@ -0,0 +1,173 @@
+/*
+  ==============================================================================
+
+    PracticeSession.cpp
+
+  ==============================================================================
+*/
+
+#include "PracticeSession.h"
+
+//==============================================================================
+PracticeSession::PracticeSession (std::function<GridSettings()> gridSource, std::atomic<double>& deviationForDisplay,
+                                  std::function<void()> eventsQueuedCallback)
+    : getGrid (std::move (gridSource)), lastDeviationMs (deviationForDisplay), onEventsQueued (std::move (eventsQueuedCallback))
+{
+}
+
+PracticeSession::~PracticeSession()
+{
+    stop();
+}
+
+int PracticeSession::start (double bpm)
+{
+    stop();
+
+    msPerBeat = 60000.0 / juce::jlimit (20.0, 400.0, bpm);
+    startMs = juce::Time::getMillisecondCounterHiRes();
+    ++numStarts;
+    ++take;
+    running = true;
+
+    for (const auto& device : juce::MidiInput::getAvailableDevices())
+    {
+        if (auto input = juce::MidiInput::openDevice (device.identifier, this))
+        {
+            input->start();
+            inputs.push_back (std::move (input));
+        }
+    }
+
+    startTimer (1);
+    return (int) inputs.size();
+}
+
+void PracticeSession::stop()
+{
+    // Closing the inputs first means nothing new arrives while the timer finishes
+    inputs.clear();
+    stopTimer();
+    running = false;
+}
+
+double PracticeSession::getPpqAtTime (double timeMs) const noexcept
+{
+    return (timeMs - startMs.load()) / msPerBeat.load();
+}
+
+//==============================================================================
+void PracticeSession::handleIncomingMidiMessage (juce::MidiInput*, const juce::MidiMessage& message)
+{
+    if (! message.isNoteOn())
+        return;
+
+    IncomingNote note;
+    note.number = (juce::uint8) message.getNoteNumber();
+    note.velocity = message.getVelocity();
+    note.channel = (juce::uint8) message.getChannel();
+
+    // The driver's timestamp, in seconds on the millisecond counter's time base
+    note.timeMs = message.getTimeStamp() * 1000.0;
+
+    const juce::SpinLock::ScopedLockType sl (incomingLock);
+    incoming.push (note);
+}
+
+void PracticeSession::hiResTimerCallback()
+{
+    if (incoming.getNumReady() == 0)
+        return;
+
+    const auto grid = getGrid();
+    const auto bpm = 60000.0 / msPerBeat.load();
+
+    incoming.pop (incoming.capacity, [&] (const IncomingNote& note)
+    {
+        const auto ppq = getPpqAtTime (note.timeMs);
+
+        // Notes stamped before the clock started aren't part of the session
+        if (ppq < 0.0)
+            return;
+
+        // The clock correction can move the origin back a little, but the log has to stay in order
+        TimingEvent e;
+        e.sampleTime = juce::jmax (lastSampleTime, (juce::int64) ((note.timeMs - sampleClockOriginMs.load()) * 0.001 * sampleRate.load()));
+        lastSampleTime = e.sampleTime;
+        e.ppq = ppq;
+        e.bpm = bpm;
+        e.deviationMs = computeDeviationMs (ppq, bpm, grid);
+        e.bar = (int) std::floor (ppq / beatsPerBar);
+        e.take = take;
+        e.note = note.number;
+        e.velocity = note.velocity;
+        e.channel = note.channel;
+
+        lastDeviationMs = e.deviationMs;
+        events.push (e);
+    });
+
+    if (events.getNumReady() > 0 && onEventsQueued != nullptr)
+        onEventsQueued();
+}
+
+//==============================================================================
+void PracticeSession::renderClicks (juce::AudioBuffer<float>& buffer, juce::int64 blockStartSample) noexcept
+{
+    if (! running.load() || buffer.getNumChannels() == 0)
+        return;
+
+    const auto rate = sampleRate.load();
+    const auto beatMs = msPerBeat.load();
+    const auto nowMs = juce::Time::getMillisecondCounterHiRes();
+    const auto blockMs = buffer.getNumSamples() * 1000.0 / rate;
+    const auto restarted = clickStarts != numStarts.load();
+
+    if (restarted)
+    {
+        clickStarts = numStarts.load();
+        nextClickBeat = 0;
+    }
+
+    // The block's time follows the sample clock, so the callback's jitter doesn't move the
+    // clicks. It's pulled gently towards the millisecond counter, which the notes are timed
+    // on, so the two clocks can't drift apart, and jumps to it after a restart or a stall.
+    const auto expectedMs = blockTimeMs + lastBlockMs;
+
+    blockTimeMs = restarted || std::abs (nowMs - expectedMs) > maxClockErrorMs
+                    ? nowMs
+                    : expectedMs + (nowMs - expectedMs) * clockCorrection;
+    lastBlockMs = blockMs;
+    sampleClockOriginMs = blockTimeMs - (double) blockStartSample * 1000.0 / rate;
+
+    // This block is heard once the device has played out what it already holds
+    const auto heardMs = blockTimeMs + outputLatencyMs.load();
+
+    // Skip beats that are long gone, e.g. after the audio device stalled
+    nextClickBeat = juce::jmax (nextClickBeat, (juce::int64) std::ceil ((heardMs - blockMs - startMs.load()) / beatMs));
+
+    for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+    {
+        const auto timeMs = heardMs + sample * 1000.0 / rate;
+
+        // Every beat is clicked exactly once, even when blocks are called back unevenly
+        if (timeMs >= startMs.load() + (double) nextClickBeat * beatMs)
+        {
+            clickFrequency = nextClickBeat % beatsPerBar == 0 ? 1500.0 : 1000.0;
+            clickSamplesLeft = (int) (clickLengthMs * 0.001 * rate);
+            clickPhase = 0.0;
+            ++nextClickBeat;
+        }
+
+        if (clickSamplesLeft > 0)
+        {
+            const auto envelope = (float) clickSamplesLeft / (float) (clickLengthMs * 0.001 * rate);
+            const auto value = 0.5f * envelope * envelope * (float) std::sin (clickPhase);
+            clickPhase += juce::MathConstants<double>::twoPi * clickFrequency / rate;
+            --clickSamplesLeft;
+
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                buffer.addSample (channel, sample, value);
+        }
+    }
+}
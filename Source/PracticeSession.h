@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    PracticeSession.h
+
+    Practice without a DAW: times notes straight from the MIDI devices against
+    the plugin's own metronome clock.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include "TimingEvent.h"
+#include "TimingGrid.h"
+
+//==============================================================================
+/**
+    A metronome clock plus direct MIDI input, for the standalone app.
+
+    Inside a host, a note's time is only known to the block it arrives in, and
+    some hosts even move live notes to the start of the block. Here every MIDI
+    input is opened directly, and each note keeps the timestamp the device driver
+    gave it. The clock is pure arithmetic on Time::getMillisecondCounterHiRes(),
+    so a note's position is exact to the resolution of those timestamps.
+
+    MIDI callbacks only queue note-ons. A HighResolutionTimer thread drains that
+    queue every millisecond, measures each note against the clock and the grid,
+    and queues the result as a TimingEvent for the analysis workers, in a FIFO of
+    its own (the processor's FIFO has the audio thread as its only producer),
+    then calls onEventsQueued so the workers know to drain it.
+
+    renderClicks() adds an audible click on every beat to the audio output. Blocks
+    are timed on the audio device's sample clock, kept in step with the millisecond
+    counter, and the clicks are moved earlier by the device's output latency. The
+    same block times map note timestamps onto the processor's sample clock.
+
+    start() and stop() must be called from the message thread.
+*/
+class PracticeSession : public juce::MidiInputCallback,
+                        private juce::HighResolutionTimer
+{
+public:
+    /** getGrid and onEventsQueued are called on the timer thread, so they must be
+        thread-safe. Every measured note's deviation is also stored in
+        lastDeviationMs, for display.
+    */
+    PracticeSession (std::function<GridSettings()> getGrid, std::atomic<double>& lastDeviationMs,
+                     std::function<void()> onEventsQueued);
+    ~PracticeSession() override;
+
+    /** Starts the clock on a downbeat right now and opens every MIDI input.
+        Returns the number of inputs that could be opened.
+    */
+    int start (double bpm);
+    void stop();
+    bool isRunning() const noexcept                 { return running.load(); }
+
+    /** The clock's position in quarter notes (4/4, starting at 0) at a time in
+        Time::getMillisecondCounterHiRes() units.
+    */
+    double getPpqAtTime (double timeMs) const noexcept;
+    double getCurrentPpq() const noexcept           { return getPpqAtTime (juce::Time::getMillisecondCounterHiRes()); }
+
+    /** The processor's sample rate; events are stamped with the processor's sample clock. */
+    void setSampleRate (double newSampleRate) noexcept   { sampleRate = newSampleRate; }
+
+    /** How long the audio device takes to play a block once it's rendered; the clicks
+        are rendered this much early so they're heard on the beat.
+    */
+    void setOutputLatencyMs (double newLatencyMs) noexcept  { outputLatencyMs = newLatencyMs; }
+
+    /** Audio thread: adds the clicks for the beats due in this block to the output.
+        blockStartSample is the processor's sample clock at the start of the block.
+    */
+    void renderClicks (juce::AudioBuffer<float>& buffer, juce::int64 blockStartSample) noexcept;
+
+    /** Measured notes, to be read by the analysis workers. */
+    TimingEventFifo& getEvents() noexcept           { return events; }
+
+    //==============================================================================
+    void handleIncomingMidiMessage (juce::MidiInput*, const juce::MidiMessage&) override;
+
+private:
+    void hiResTimerCallback() override;
+
+    struct IncomingNote
+    {
+        double timeMs = 0.0;
+        juce::uint8 number = 0, velocity = 0, channel = 1;
+    };
+
+    // Each device may call back on its own thread, so pushes are serialised
+    EventFifo<IncomingNote, 1024> incoming;
+    juce::SpinLock incomingLock;
+
+    TimingEventFifo events;
+
+    std::function<GridSettings()> getGrid;
+    std::atomic<double>& lastDeviationMs;
+    std::function<void()> onEventsQueued;
+    std::vector<std::unique_ptr<juce::MidiInput>> inputs;
+
+    std::atomic<bool> running { false };
+    std::atomic<double> startMs { 0.0 }, msPerBeat { 500.0 }, sampleRate { 44100.0 }, outputLatencyMs { 0.0 };
+    juce::uint16 take = 0;
+
+    // Where the processor's sample clock was 0, on the millisecond counter; kept up to date
+    // by renderClicks(), and never reset, so events stay in order across practice runs
+    std::atomic<double> sampleClockOriginMs { juce::Time::getMillisecondCounterHiRes() };
+    juce::int64 lastSampleTime = 0;     // Timer thread
+
+    std::atomic<int> numStarts { 0 };
+
+    // Audio thread click state
+    int clickStarts = 0;
+    juce::int64 nextClickBeat = 0;
+    int clickSamplesLeft = 0;
+    double clickPhase = 0.0, clickFrequency = 1000.0;
+    double blockTimeMs = 0.0, lastBlockMs = 0.0;
+
+    static constexpr int beatsPerBar = 4;
+    static constexpr double clickLengthMs = 30.0;
+
+    // How much of each block's clock error is corrected, and the error treated as a stall
+    static constexpr double clockCorrection = 0.01;
+    static constexpr double maxClockErrorMs = 50.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PracticeSession)
+};
@@ -0,0 +1,347 @@
+/*
+  ==============================================================================
+
+    ProgressDatabase.cpp
+
+  ==============================================================================
+*/
+
+#include "ProgressDatabase.h"
+
+namespace
+{
+    constexpr int lanesOffset = 64;
+    constexpr int laneSize = 12;
+    constexpr int heatmapOffset = lanesOffset + SessionSummary::maxLanes * laneSize;
+    constexpr int checksumOffset = ProgressDatabase::recordSize - 4;
+
+    static_assert (heatmapOffset + SessionSummary::numHeatmapBins <= checksumOffset, "Record layout overflows");
+
+    // FNV-1a: cheap, and enough to spot a torn or garbled record
+    juce::uint32 computeChecksum (const char* data) noexcept
+    {
+        juce::uint32 hash = 2166136261u;
+
+        for (int i = 0; i < checksumOffset; ++i)
+            hash = (hash ^ (juce::uint8) data[i]) * 16777619u;
+
+        return hash;
+    }
+
+    template <typename Type>
+    void write (char* d, Type value) noexcept                { juce::writeUnaligned (d, juce::ByteOrder::swapIfBigEndian (value)); }
+
+    template <typename Type>
+    Type read (const char* s) noexcept                       { return juce::ByteOrder::swapIfBigEndian (juce::readUnaligned<Type> (s)); }
+
+    void writeRecord (char* d, const SessionSummary& summary) noexcept
+    {
+        juce::zeromem (d, ProgressDatabase::recordSize);
+        std::memcpy (d, "PKTS", 4);
+        write (d + 4,  ProgressDatabase::version);
+        write (d + 8,  (juce::uint64) summary.startTime);
+        write (d + 16, summary.durationSeconds);
+        write (d + 24, (juce::uint64) summary.numNotes);
+        write (d + 32, summary.meanMs);
+        write (d + 36, summary.standardDeviationMs);
+        write (d + 40, summary.earlyShare);
+        write (d + 44, summary.p10Ms);
+        write (d + 48, summary.p50Ms);
+        write (d + 52, summary.p90Ms);
+        write (d + 56, summary.averageBpm);
+
+        for (size_t i = 0; i < summary.lanes.size(); ++i)
+        {
+            const auto& lane = summary.lanes[i];
+            auto* l = d + lanesOffset + (int) i * laneSize;
+            l[0] = (char) (lane.note >= 0 ? lane.note : 255);
+            write (l + 4, lane.numNotes);
+            write (l + 8, lane.meanMs);
+        }
+
+        std::memcpy (d + heatmapOffset, summary.heatmap.data(), summary.heatmap.size());
+        write (d + checksumOffset, computeChecksum (d));
+    }
+
+    bool isValidRecord (const char* s) noexcept
+    {
+        return std::memcmp (s, "PKTS", 4) == 0
+            && read<juce::uint32> (s + 4) == ProgressDatabase::version
+            && read<juce::uint32> (s + checksumOffset) == computeChecksum (s);
+    }
+
+    SessionSummary readRecord (const char* s) noexcept
+    {
+        SessionSummary summary;
+        summary.startTime           = (juce::int64) read<juce::uint64> (s + 8);
+        summary.durationSeconds     = read<float> (s + 16);
+        summary.numNotes            = (juce::int64) read<juce::uint64> (s + 24);
+        summary.meanMs              = read<float> (s + 32);
+        summary.standardDeviationMs = read<float> (s + 36);
+        summary.earlyShare          = read<float> (s + 40);
+        summary.p10Ms               = read<float> (s + 44);
+        summary.p50Ms               = read<float> (s + 48);
+        summary.p90Ms               = read<float> (s + 52);
+        summary.averageBpm          = read<float> (s + 56);
+
+        for (size_t i = 0; i < summary.lanes.size(); ++i)
+        {
+            auto& lane = summary.lanes[i];
+            const auto* l = s + lanesOffset + (int) i * laneSize;
+            const auto note = (juce::uint8) l[0];
+            lane.note = note < 128 ? (int) note : -1;
+            lane.numNotes = read<juce::uint32> (l + 4);
+            lane.meanMs = read<float> (l + 8);
+        }
+
+        std::memcpy (summary.heatmap.data(), s + heatmapOffset, summary.heatmap.size());
+        return summary;
+    }
+}
+
+//==============================================================================
+juce::File ProgressDatabase::getDefaultFile()
+{
+    return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+               .getChildFile ("Pocket")
+               .getChildFile (juce::String ("Progress") + fileExtension);
+}
+
+bool ProgressDatabase::append (const juce::File& file, const SessionSummary& summary)
+{
+    if (! file.getParentDirectory().createDirectory())
+        return false;
+
+    // Other host processes may be appending too, e.g. sandboxed plugins that all close with the
+    // project. FileOutputStream seeks to the end rather than opening with O_APPEND, and file locks
+    // are held per process, so threads of this process queue up on the critical section first.
+    static juce::CriticalSection appendLock;
+    const juce::ScopedLock sl (appendLock);
+
+    juce::InterProcessLock fileLock ("Pocket_" + juce::String::toHexString (file.getFullPathName().hashCode64()));
+    const juce::InterProcessLock::ScopedLockType processLock (fileLock);
+
+    if (! processLock.isLocked())
+        return false;
+
+    juce::FileOutputStream out (file);
+
+    if (out.failedToOpen())
+        return false;
+
+    // An append that was cut short leaves a partial record at the end; drop it
+    // so this one starts on a record boundary again.
+    if (const auto torn = out.getPosition() % recordSize; torn != 0)
+    {
+        out.setPosition (out.getPosition() - torn);
+        out.truncate();
+    }
+
+    char record[recordSize];
+    writeRecord (record, summary);
+
+    if (! out.write (record, recordSize))
+        return false;
+
+    out.flush();
+    return out.getStatus().wasOk();
+}
+
+//==============================================================================
+bool ProgressDatabase::open (const juce::File& file)
+{
+    mappedFile.reset();
+    validRecords.clear();
+
+    if (! file.existsAsFile())
+        return false;
+
+    auto mapped = std::make_unique<juce::MemoryMappedFile> (file, juce::MemoryMappedFile::readOnly);
+    auto* data = static_cast<const char*> (mapped->getData());
+
+    if (data == nullptr)
+        return false;
+
+    const auto numSlots = (juce::uint32) (mapped->getSize() / recordSize);
+    validRecords.reserve (numSlots);
+
+    for (juce::uint32 i = 0; i < numSlots; ++i)
+        if (isValidRecord (data + (size_t) i * recordSize))
+            validRecords.push_back (i);
+
+    mappedFile = std::move (mapped);
+    return true;
+}
+
+SessionSummary ProgressDatabase::getSession (int index) const noexcept
+{
+    jassert (juce::isPositiveAndBelow (index, getNumSessions()));
+    return readRecord (static_cast<const char*> (mappedFile->getData())
+                         + (size_t) validRecords[(size_t) index] * recordSize);
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class ProgressDatabaseTests  : public juce::UnitTest
+{
+public:
+    ProgressDatabaseTests()  : juce::UnitTest ("ProgressDatabase", "Pocket") {}
+
+    void runTest() override
+    {
+        constexpr int numSessions = 5000;
+
+        const auto file = juce::File::createTempFile (ProgressDatabase::fileExtension);
+        auto random = getRandom();
+        std::vector<SessionSummary> written;
+
+        beginTest ("Sessions read back as they were written");
+        {
+            for (int i = 0; i < numSessions; ++i)
+            {
+                written.push_back (randomSummary (random, i));
+                expect (ProgressDatabase::append (file, written.back()));
+            }
+
+            expectEquals (file.getSize(), (juce::int64) numSessions * ProgressDatabase::recordSize);
+
+            ProgressDatabase database;
+            const auto startMs = juce::Time::getMillisecondCounterHiRes();
+            expect (database.open (file));
+            const auto openMs = juce::Time::getMillisecondCounterHiRes() - startMs;
+
+            logMessage ("Opened " + juce::String (numSessions) + " sessions in " + juce::String (openMs, 2) + " ms");
+            expectLessThan (openMs, 500.0);
+
+            expectEquals (database.getNumSessions(), numSessions);
+
+            for (int i = 0; i < database.getNumSessions(); ++i)
+                expectSame (database.getSession (i), written[(size_t) i]);
+        }
+
+        beginTest ("A garbled record is skipped");
+        {
+            corruptByte (file, 10 * ProgressDatabase::recordSize + 100);
+
+            ProgressDatabase database;
+            expect (database.open (file));
+            expectEquals (database.getNumSessions(), numSessions - 1);
+            expectSame (database.getSession (9), written[9]);
+            expectSame (database.getSession (10), written[11]);
+        }
+
+        beginTest ("A torn append is ignored, then cut off by the next one");
+        {
+            {
+                juce::FileOutputStream out (file);
+                char partial[ProgressDatabase::recordSize / 2];
+                std::fill (std::begin (partial), std::end (partial), 'x');
+                expect (out.write (partial, sizeof (partial)));
+            }
+
+            ProgressDatabase database;
+            expect (database.open (file));
+            expectEquals (database.getNumSessions(), numSessions - 1);
+
+            const auto summary = randomSummary (random, numSessions);
+            expect (ProgressDatabase::append (file, summary));
+            expectEquals (file.getSize(), (juce::int64) (numSessions + 1) * ProgressDatabase::recordSize);
+
+            expect (database.open (file));
+            expectEquals (database.getNumSessions(), numSessions);
+            expectSame (database.getSession (numSessions - 1), summary);
+        }
+
+        beginTest ("Concurrent appends all land on record boundaries");
+        {
+            file.deleteFile();
+
+            constexpr int numThreads = 4, numPerThread = 100;
+            std::vector<std::thread> threads;
+            std::atomic<int> numFailed { 0 };
+
+            for (int t = 0; t < numThreads; ++t)
+                threads.emplace_back ([&, t]
+                {
+                    juce::Random threadRandom (t);
+
+                    for (int i = 0; i < numPerThread; ++i)
+                        if (! ProgressDatabase::append (file, randomSummary (threadRandom, t * numPerThread + i)))
+                            ++numFailed;
+                });
+
+            for (auto& thread : threads)
+                thread.join();
+
+            expectEquals (numFailed.load(), 0);
+            expectEquals (file.getSize(), (juce::int64) numThreads * numPerThread * ProgressDatabase::recordSize);
+
+            ProgressDatabase database;
+            expect (database.open (file));
+            expectEquals (database.getNumSessions(), numThreads * numPerThread);
+        }
+
+        file.deleteFile();
+    }
+
+private:
+    static SessionSummary randomSummary (juce::Random& random, int index)
+    {
+        SessionSummary summary;
+        summary.startTime = 1700000000000 + (juce::int64) index * 3600000;
+        summary.durationSeconds = random.nextFloat() * 3600.0f;
+        summary.numNotes = random.nextInt64() & 0xffffffffff;
+        summary.meanMs = random.nextFloat() * 40.0f - 20.0f;
+        summary.standardDeviationMs = random.nextFloat() * 20.0f;
+        summary.earlyShare = random.nextFloat();
+        summary.p10Ms = -random.nextFloat() * 30.0f;
+        summary.p50Ms = random.nextFloat() * 2.0f - 1.0f;
+        summary.p90Ms = random.nextFloat() * 30.0f;
+        summary.averageBpm = 60.0f + random.nextFloat() * 120.0f;
+
+        for (size_t i = 0; i < summary.lanes.size(); ++i)
+            if (random.nextBool())
+                summary.lanes[i] = { random.nextInt (128), (juce::uint32) random.nextInt(), random.nextFloat() * 10.0f };
+
+        for (auto& bin : summary.heatmap)
+            bin = (juce::uint8) random.nextInt (256);
+
+        return summary;
+    }
+
+    void expectSame (const SessionSummary& a, const SessionSummary& b)
+    {
+        expectEquals (a.startTime, b.startTime);
+        expectEquals (a.durationSeconds, b.durationSeconds);
+        expectEquals (a.numNotes, b.numNotes);
+        expectEquals (a.meanMs, b.meanMs);
+        expectEquals (a.standardDeviationMs, b.standardDeviationMs);
+        expectEquals (a.earlyShare, b.earlyShare);
+        expectEquals (a.p10Ms, b.p10Ms);
+        expectEquals (a.p50Ms, b.p50Ms);
+        expectEquals (a.p90Ms, b.p90Ms);
+        expectEquals (a.averageBpm, b.averageBpm);
+
+        for (size_t i = 0; i < a.lanes.size(); ++i)
+        {
+            expectEquals (a.lanes[i].note, b.lanes[i].note);
+            expectEquals ((juce::int64) a.lanes[i].numNotes, (juce::int64) b.lanes[i].numNotes);
+            expectEquals (a.lanes[i].meanMs, b.lanes[i].meanMs);
+        }
+
+        expect (a.heatmap == b.heatmap);
+    }
+
+    static void corruptByte (const juce::File& file, juce::int64 position)
+    {
+        juce::MemoryBlock data;
+        file.loadFileAsData (data);
+        data[(size_t) position] = (char) ~data[(size_t) position];
+        file.replaceWithData (data.getData(), data.getSize());
+    }
+};
+
+static ProgressDatabaseTests progressDatabaseTests;
+
+#endif
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    ProgressDatabase.h
+
+    One summary record per session, kept across sessions so progress can be
+    charted without going back to the raw logs.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SessionStatistics.h"
+
+//==============================================================================
+/** What gets remembered about a finished session. */
+struct SessionSummary
+{
+    static constexpr int maxLanes = 8;
+    static constexpr int numHeatmapBins = SessionStatistics::numHistogramBins;
+
+    /** Timing of one note number (e.g. one drum), for the most played notes. */
+    struct Lane
+    {
+        int note = -1;              // -1 if unused
+        juce::uint32 numNotes = 0;
+        float meanMs = 0.0f;
+    };
+
+    juce::int64 startTime = 0;      // Milliseconds since 1970, as used by juce::Time
+    float durationSeconds = 0.0f;
+    juce::int64 numNotes = 0;
+    float meanMs = 0.0f;
+    float standardDeviationMs = 0.0f;
+    float earlyShare = 0.0f;        // 0 to 1
+    float p10Ms = 0.0f, p50Ms = 0.0f, p90Ms = 0.0f;
+    float averageBpm = 0.0f;
+    std::array<Lane, maxLanes> lanes;
+
+    /** The deviation histogram, scaled so that its fullest bin is 255. */
+    std::array<juce::uint8, numHeatmapBins> heatmap {};
+};
+
+//==============================================================================
+/**
+    An append-only file of fixed-size SessionSummary records, one per session.
+
+    The file is just a sequence of 256-byte little-endian records:
+
+        "PKTS"  uint32 version  int64 startTime  float32 durationSeconds  4 reserved bytes
+        int64 numNotes  float32 meanMs  float32 sdMs  float32 earlyShare
+        float32 p10Ms  float32 p50Ms  float32 p90Ms  float32 averageBpm  4 reserved bytes
+        8 lanes of { uint8 note (255 = unused)  3 reserved bytes  uint32 numNotes  float32 meanMs }
+        50 heatmap bytes  42 reserved bytes  uint32 checksum
+
+    Appends are crash-safe: each record is written with a single write and carries
+    a checksum of its first 252 bytes, a torn record at the end of the file is cut
+    off by the next append, and the reader skips any record that doesn't check out.
+    Appends hold an inter-process lock on the file, so several hosts (or sandboxed
+    plugin processes) saving at once don't write over each other's records.
+
+    Reading maps the file and only checks each record's checksum, so opening a
+    database of thousands of sessions is effectively instant; records are decoded
+    on demand.
+*/
+class ProgressDatabase
+{
+public:
+    ProgressDatabase() = default;
+
+    static constexpr const char* fileExtension = ".pocketdb";
+    static constexpr juce::uint32 version = 1;
+    static constexpr int recordSize = 256;
+
+    /** Progress.pocketdb in the user's application data folder. */
+    static juce::File getDefaultFile();
+
+    /** Adds one session to the end of the file, creating it if needed. */
+    static bool append (const juce::File& file, const SessionSummary& summary);
+
+    //==============================================================================
+    /** Maps the file for reading. Call again to pick up sessions appended since. */
+    bool open (const juce::File& file);
+
+    int getNumSessions() const noexcept             { return (int) validRecords.size(); }
+
+    /** Decodes a session; index must be in the range [0, getNumSessions()). */
+    SessionSummary getSession (int index) const noexcept;
+
+private:
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    std::vector<juce::uint32> validRecords;     // Slots whose checksums matched
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProgressDatabase)
+};
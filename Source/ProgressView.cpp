@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+
+    ProgressView.cpp
+
+  ==============================================================================
+*/
+
+#include "ProgressView.h"
+
+//==============================================================================
+void ProgressView::refresh()
+{
+    database.open (ProgressDatabase::getDefaultFile());
+    repaint();
+}
+
+//==============================================================================
+void ProgressView::paint (juce::Graphics& g)
+{
+    POCKET_TRACE_SCOPE (*tracer, "progress view paint");
+    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId).darker (0.2f));
+
+    const auto numSessions = database.getNumSessions();
+
+    if (numSessions == 0)
+    {
+        g.setColour (juce::Colours::grey);
+        g.drawText ("No sessions saved yet", getLocalBounds(), juce::Justification::centred);
+        return;
+    }
+
+    const auto height = (float) getHeight();
+    const auto msToY = [height] (float ms) { return height * 0.5f * (1.0f - ms / rangeMs); };
+
+    g.setColour (juce::Colours::grey.withAlpha (0.5f));
+    g.drawHorizontalLine (getHeight() / 2, 0.0f, (float) getWidth());
+
+    const auto columnWidth = getColumnWidth();
+    const auto numVisible = getNumVisible();
+    const auto binHeight = height / (float) SessionSummary::numHeatmapBins;
+
+    for (int column = 0; column < numVisible; ++column)
+    {
+        const auto session = database.getSession (numSessions - numVisible + column);
+        const auto x = (float) (column * columnWidth);
+
+        // Histogram bins run from -rangeMs (bottom) to +rangeMs (top)
+        for (int bin = 0; bin < SessionSummary::numHeatmapBins; ++bin)
+        {
+            if (const auto level = session.heatmap[(size_t) bin]; level > 0)
+            {
+                g.setColour (juce::Colours::lightblue.withAlpha ((float) level / 255.0f * 0.8f));
+                g.fillRect (x, height - (float) (bin + 1) * binHeight, (float) columnWidth, binHeight);
+            }
+        }
+
+        const auto centre = x + (float) columnWidth * 0.5f;
+
+        g.setColour (juce::Colours::white.withAlpha (0.6f));
+        g.drawLine (centre, msToY (session.p90Ms), centre, msToY (session.p10Ms));
+
+        g.setColour (session.meanMs < 0.0f ? juce::Colours::orange : juce::Colours::lightgreen);
+        g.fillRect (x, msToY (session.meanMs) - 1.0f, (float) columnWidth, 2.0f);
+
+        if (column == hoveredColumn)
+        {
+            g.setColour (juce::Colours::white.withAlpha (0.15f));
+            g.fillRect (x, 0.0f, (float) columnWidth, height);
+        }
+    }
+
+    const auto isHovering = juce::isPositiveAndBelow (hoveredColumn, numVisible);
+    const auto session = database.getSession (isHovering ? numSessions - numVisible + hoveredColumn : numSessions - 1);
+
+    juce::String lanes;
+
+    for (const auto& lane : session.lanes)
+        if (lane.note >= 0)
+            lanes << "note " << lane.note << ": " << (lane.meanMs > 0.0f ? "+" : "")
+                  << juce::String (lane.meanMs, 1) << " ms (" << (int) lane.numNotes << ")   ";
+
+    g.setColour (juce::Colours::grey);
+    g.setFont (11.0f);
+
+    auto captionArea = getLocalBounds().reduced (4, 2);
+    g.drawText (juce::String (numSessions) + " sessions | " + (isHovering ? "" : "latest: ")
+                  + juce::Time (session.startTime).formatted ("%Y-%m-%d %H:%M")
+                  + ", " + juce::String (session.durationSeconds / 60.0f, 0) + " min, mean " + juce::String (session.meanMs, 1)
+                  + " ms, sd " + juce::String (session.standardDeviationMs, 1) + " ms, "
+                  + juce::String (session.averageBpm, 0) + " bpm",
+                captionArea.removeFromTop (14), juce::Justification::topLeft);
+    g.drawText (lanes.trimEnd(), captionArea.removeFromTop (14), juce::Justification::topLeft);
+}
+
+void ProgressView::mouseMove (const juce::MouseEvent& e)
+{
+    const auto column = e.x / getColumnWidth();
+    const auto newHovered = column < getNumVisible() ? column : -1;
+
+    if (newHovered != hoveredColumn)
+    {
+        hoveredColumn = newHovered;
+        repaint();
+    }
+}
+
+void ProgressView::mouseExit (const juce::MouseEvent&)
+{
+    hoveredColumn = -1;
+    repaint();
+}
+
+//==============================================================================
+int ProgressView::getColumnWidth() const noexcept
+{
+    return juce::jlimit (minColumnWidth, maxColumnWidth, getWidth() / juce::jmax (1, database.getNumSessions()));
+}
+
+int ProgressView::getNumVisible() const noexcept
+{
+    return juce::jmin (database.getNumSessions(), getWidth() / getColumnWidth());
+}
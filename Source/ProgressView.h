@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+
+    ProgressView.h
+
+    Chart of past sessions from the progress database.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ProgressDatabase.h"
+#include "TraceRecorder.h"
+
+//==============================================================================
+/**
+    Draws one column per session, oldest on the left: the session's deviation
+    histogram as a heatmap, a bar from its 10th to 90th percentile and a dot at
+    its mean. When there are more sessions than fit, the most recent are shown.
+    The caption describes the session under the mouse, or the latest one: its
+    date, overall timing and the mean of each of its most played notes.
+
+    Only the visible sessions are decoded, so repainting doesn't depend on how
+    long the history is.
+*/
+class ProgressView  : public juce::Component
+{
+public:
+    ProgressView() = default;
+
+    /** Re-opens the database to pick up sessions saved since the last call. */
+    void refresh();
+
+    //==============================================================================
+    void paint (juce::Graphics&) override;
+    void mouseMove (const juce::MouseEvent&) override;
+    void mouseExit (const juce::MouseEvent&) override;
+
+private:
+    int getColumnWidth() const noexcept;
+    int getNumVisible() const noexcept;
+
+    ProgressDatabase database;
+    int hoveredColumn = -1;
+    juce::SharedResourcePointer<TraceRecorder> tracer;
+
+    static constexpr float rangeMs = 50.0f;     // Deviation shown at the top and bottom edges
+    static constexpr int minColumnWidth = 3, maxColumnWidth = 12;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProgressView)
+};
@@ -0,0 +1,326 @@
+/*
+  ==============================================================================
+
+    RealtimeSafety.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeSafety.h"
+
+// The hooks read these from inside malloc, so in a plugin they mustn't be set up lazily
+// by the dynamic loader, which allocates
+#if defined (__GLIBC__)
+ #define POCKET_THREAD_LOCAL thread_local __attribute__ ((tls_model ("initial-exec")))
+#else
+ #define POCKET_THREAD_LOCAL thread_local
+#endif
+
+namespace
+{
+    POCKET_THREAD_LOCAL int realtimeDepth = 0;
+    POCKET_THREAD_LOCAL int allowDepth = 0;
+    POCKET_THREAD_LOCAL int expectedDepth = 0;
+
+    std::atomic<int> numViolations { 0 };
+}
+
+//==============================================================================
+RealtimeSafety::ScopedRealtime::ScopedRealtime() noexcept   { ++realtimeDepth; }
+RealtimeSafety::ScopedRealtime::~ScopedRealtime() noexcept  { --realtimeDepth; }
+
+RealtimeSafety::ScopedAllow::ScopedAllow() noexcept         { ++allowDepth; }
+RealtimeSafety::ScopedAllow::~ScopedAllow() noexcept        { --allowDepth; }
+
+RealtimeSafety::ScopedExpectViolations::ScopedExpectViolations() noexcept   { ++expectedDepth; }
+RealtimeSafety::ScopedExpectViolations::~ScopedExpectViolations() noexcept  { --expectedDepth; }
+
+bool RealtimeSafety::isRealtime() noexcept
+{
+    return realtimeDepth > 0 && allowDepth == 0;
+}
+
+void RealtimeSafety::check (const char* operation) noexcept
+{
+    if (! isRealtime())
+        return;
+
+    // Reporting allocates and writes, so it mustn't report itself
+    const ScopedAllow allow;
+    ++numViolations;
+
+    if (expectedDepth > 0)
+        return;
+
+    juce::Logger::outputDebugString (juce::String ("Real-time violation: ") + operation + " on the audio thread\n"
+                                       + juce::SystemStats::getStackBacktrace());
+
+    static const bool fatal = juce::SystemStats::getEnvironmentVariable ("POCKET_REALTIME_FATAL", {}) == "1";
+
+    if (fatal)
+        std::abort();
+
+    jassertfalse;
+}
+
+int RealtimeSafety::getNumViolations() noexcept
+{
+    return numViolations.load();
+}
+
+#if POCKET_REALTIME_SAFETY_CHECKS
+
+#if JUCE_ENABLE_ALLOCATION_HOOKS
+ #error "POCKET_REALTIME_SAFETY_CHECKS and JUCE_ENABLE_ALLOCATION_HOOKS both replace operator new; enable only one"
+#endif
+
+//==============================================================================
+// Allocation: replaces the global operator new and delete, as JUCE's allocation hooks do,
+// and with glibc also malloc and friends, which JUCE's HeapBlock, MidiMessage and
+// MidiBuffer call directly. glibc's own entry points sit underneath, so nothing needs
+// dlsym (which itself calls calloc).
+#if defined (__GLIBC__)
+ #define POCKET_HOOK_MALLOC 1
+
+extern "C"
+{
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void __libc_free (void*);
+}
+
+namespace
+{
+    void* allocate (size_t size) noexcept   { return __libc_malloc (size); }
+    void deallocate (void* p) noexcept      { __libc_free (p); }
+}
+
+extern "C" void* malloc (size_t size)
+{
+    RealtimeSafety::check ("malloc");
+    return __libc_malloc (size);
+}
+
+extern "C" void* calloc (size_t numElements, size_t elementSize)
+{
+    RealtimeSafety::check ("calloc");
+    return __libc_calloc (numElements, elementSize);
+}
+
+extern "C" void* realloc (void* p, size_t size)
+{
+    RealtimeSafety::check ("realloc");
+    return __libc_realloc (p, size);
+}
+
+extern "C" void free (void* p)
+{
+    if (p != nullptr)
+        RealtimeSafety::check ("free");
+
+    __libc_free (p);
+}
+
+#else
+ #define POCKET_HOOK_MALLOC 0
+
+namespace
+{
+    void* allocate (size_t size) noexcept   { return std::malloc (size); }
+    void deallocate (void* p) noexcept      { std::free (p); }
+}
+#endif
+
+void* operator new (size_t size)
+{
+    RealtimeSafety::check ("operator new");
+
+    if (auto* p = allocate (size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (size_t size)
+{
+    RealtimeSafety::check ("operator new[]");
+
+    if (auto* p = allocate (size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new (size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeSafety::check ("operator new");
+    return allocate (size);
+}
+
+void* operator new[] (size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeSafety::check ("operator new[]");
+    return allocate (size);
+}
+
+void operator delete (void* p) noexcept
+{
+    if (p != nullptr)
+        RealtimeSafety::check ("operator delete");
+
+    deallocate (p);
+}
+
+void operator delete[] (void* p) noexcept
+{
+    if (p != nullptr)
+        RealtimeSafety::check ("operator delete[]");
+
+    deallocate (p);
+}
+
+void operator delete (void* p, size_t) noexcept     { operator delete (p); }
+void operator delete[] (void* p, size_t) noexcept   { operator delete[] (p); }
+
+//==============================================================================
+// Locks and file I/O: wraps the C library's functions for calls made from this binary
+#if JUCE_LINUX || JUCE_BSD || JUCE_MAC
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <unistd.h>
+
+namespace
+{
+    // Found on first use; no function-local statics, as their guards may lock
+    template <typename Function>
+    Function* getNext (std::atomic<void*>& cached, const char* name) noexcept
+    {
+        auto* next = cached.load (std::memory_order_relaxed);
+
+        if (next == nullptr)
+        {
+            const RealtimeSafety::ScopedAllow allow;
+            next = dlsym (RTLD_NEXT, name);
+            cached.store (next, std::memory_order_relaxed);
+        }
+
+        return reinterpret_cast<Function*> (next);
+    }
+
+    std::atomic<void*> nextMutexLock { nullptr };
+}
+
+extern "C" int pthread_mutex_lock (pthread_mutex_t* mutex)
+{
+    RealtimeSafety::check ("pthread_mutex_lock");
+    return getNext<int (pthread_mutex_t*)> (nextMutexLock, "pthread_mutex_lock") (mutex);
+}
+
+// glibc's fortified builds define these inline, so they can only be wrapped without it
+#if ! (defined (__USE_FORTIFY_LEVEL) && __USE_FORTIFY_LEVEL > 0)
+
+namespace
+{
+    std::atomic<void*> nextOpen { nullptr }, nextRead { nullptr }, nextWrite { nullptr }, nextFopen { nullptr };
+}
+
+extern "C" int open (const char* path, int flags, ...)
+{
+    RealtimeSafety::check ("open");
+
+    va_list args;
+    va_start (args, flags);
+    const auto mode = (flags & O_CREAT) != 0 ? (mode_t) va_arg (args, int) : (mode_t) 0;
+    va_end (args);
+
+    return getNext<int (const char*, int, ...)> (nextOpen, "open") (path, flags, mode);
+}
+
+extern "C" ssize_t read (int fd, void* buffer, size_t numBytes)
+{
+    RealtimeSafety::check ("read");
+    return getNext<ssize_t (int, void*, size_t)> (nextRead, "read") (fd, buffer, numBytes);
+}
+
+extern "C" ssize_t write (int fd, const void* buffer, size_t numBytes)
+{
+    RealtimeSafety::check ("write");
+    return getNext<ssize_t (int, const void*, size_t)> (nextWrite, "write") (fd, buffer, numBytes);
+}
+
+extern "C" FILE* fopen (const char* path, const char* mode)
+{
+    RealtimeSafety::check ("fopen");
+    return getNext<FILE* (const char*, const char*)> (nextFopen, "fopen") (path, mode);
+}
+
+#endif
+#endif
+#endif
+
+//==============================================================================
+#if JUCE_UNIT_TESTS && POCKET_REALTIME_SAFETY_CHECKS && POCKET_HOOK_MALLOC
+
+class RealtimeSafetyTests  : public juce::UnitTest
+{
+public:
+    RealtimeSafetyTests()  : juce::UnitTest ("RealtimeSafety", "Pocket") {}
+
+    void runTest() override
+    {
+        // A universal SysEx identity request, padded past MidiMessage's 8 bytes of inline storage
+        const juce::uint8 sysEx[] = { 0xf0, 0x7e, 0x7f, 0x06, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf7 };
+
+        beginTest ("A long MidiMessage made in a real-time scope is counted");
+        {
+            const auto violationsBefore = RealtimeSafety::getNumViolations();
+            int size = 0;
+
+            {
+                const RealtimeSafety::ScopedRealtime realtime;
+                const RealtimeSafety::ScopedExpectViolations expected;
+                const juce::MidiMessage message (sysEx, (int) sizeof (sysEx));
+                size = message.getRawDataSize();
+            }
+
+            // Its malloc and its free
+            expectEquals (RealtimeSafety::getNumViolations() - violationsBefore, 2);
+            expectEquals (size, (int) sizeof (sysEx));
+        }
+
+        beginTest ("A short MidiMessage made in a real-time scope isn't");
+        {
+            const auto violationsBefore = RealtimeSafety::getNumViolations();
+            bool isNoteOn = false;
+
+            {
+                const RealtimeSafety::ScopedRealtime realtime;
+                const RealtimeSafety::ScopedExpectViolations expected;
+                const juce::MidiMessage message (0x90, 60, 100);
+                isNoteOn = message.isNoteOn();
+            }
+
+            expectEquals (RealtimeSafety::getNumViolations() - violationsBefore, 0);
+            expect (isNoteOn);
+        }
+
+        beginTest ("Allocations outside a real-time scope aren't counted");
+        {
+            const auto violationsBefore = RealtimeSafety::getNumViolations();
+            const juce::MidiMessage message (sysEx, (int) sizeof (sysEx));
+            juce::HeapBlock<float> block (1024);
+            block.realloc (4096);
+
+            expectEquals (RealtimeSafety::getNumViolations() - violationsBefore, 0);
+        }
+    }
+};
+
+static RealtimeSafetyTests realtimeSafetyTests;
+
+#endif
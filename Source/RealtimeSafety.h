@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    RealtimeSafety.h
+
+    Debug and test builds: catches allocation, locking and file I/O on the
+    audio thread as it happens.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// Set to 1 in debug and benchmark builds; never in a release. Builds with the unit
+// tests get it by default, so the processor's tests run under the checks.
+#ifndef POCKET_REALTIME_SAFETY_CHECKS
+ #if JUCE_UNIT_TESTS && ! JUCE_ENABLE_ALLOCATION_HOOKS
+  #define POCKET_REALTIME_SAFETY_CHECKS 1
+ #else
+  #define POCKET_REALTIME_SAFETY_CHECKS 0
+ #endif
+#endif
+
+//==============================================================================
+/**
+    Reports anything done inside a real-time scope that could block the audio
+    thread: operator new and delete (so any juce::String, std::vector or
+    std::function that allocates), with glibc also malloc, calloc, realloc and
+    free (so a juce::HeapBlock, a long juce::MidiMessage or a growing
+    juce::MidiBuffer), and on Linux and macOS also mutex locks and file I/O
+    (open, read, write and fopen).
+
+    With POCKET_REALTIME_SAFETY_CHECKS set, RealtimeSafety.cpp replaces the
+    global operator new and delete and, with glibc, malloc and friends, and
+    wraps pthread_mutex_lock and the I/O calls for this binary, so the checks
+    can't be used with
+    JUCE_ENABLE_ALLOCATION_HOOKS (which replaces operator new too). Outside a
+    real-time scope, each of them costs one thread-local read.
+
+    A violation is printed with a stack trace and counted. Under a debugger it
+    then stops on an assertion; with the environment variable
+    POCKET_REALTIME_FATAL=1 it aborts instead, so a test or benchmark run fails
+    on the first one.
+
+    Mark a scope with POCKET_REALTIME_SCOPE; without the checks it compiles to
+    nothing.
+*/
+struct RealtimeSafety
+{
+    /** Makes the rest of this scope (on this thread) real-time. Scopes can nest. */
+    struct ScopedRealtime
+    {
+        ScopedRealtime() noexcept;
+        ~ScopedRealtime() noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedRealtime)
+    };
+
+    /** Suspends the checks on this thread, for work that's known to be safe or is reporting a violation. */
+    struct ScopedAllow
+    {
+        ScopedAllow() noexcept;
+        ~ScopedAllow() noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedAllow)
+    };
+
+    /** Counts violations in this scope (on this thread) without reporting them, for
+        tests that check a violation is caught.
+    */
+    struct ScopedExpectViolations
+    {
+        ScopedExpectViolations() noexcept;
+        ~ScopedExpectViolations() noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedExpectViolations)
+    };
+
+    /** True inside a real-time scope on this thread, unless the checks are suspended. */
+    static bool isRealtime() noexcept;
+
+    /** Reports a violation if this thread is real-time. The hooks call this; it can
+        also be called directly before anything else that mustn't happen on the
+        audio thread.
+    */
+    static void check (const char* operation) noexcept;
+
+    /** Violations reported since the process started. */
+    static int getNumViolations() noexcept;
+};
+
+#if POCKET_REALTIME_SAFETY_CHECKS
+ #define POCKET_REALTIME_SCOPE const RealtimeSafety::ScopedRealtime JUCE_JOIN_MACRO (realtimeScope, __LINE__);
+#else
+ #define POCKET_REALTIME_SCOPE
+#endif
@@ -0,0 +1,270 @@
+/*
+  ==============================================================================
+
+    ReferenceGroove.cpp
+
+  ==============================================================================
+*/
+
+#include "ReferenceGroove.h"
+#include "SessionLogReader.h"
+
+namespace
+{
+    // References loop in whole 4/4 bars
+    constexpr double quarterNotesPerBar = 4.0;
+
+    double roundUpToBar (double ppq) noexcept
+    {
+        return juce::jmax (quarterNotesPerBar, std::ceil (ppq / quarterNotesPerBar - 1.0e-9) * quarterNotesPerBar);
+    }
+}
+
+//==============================================================================
+ReferenceGroove::ReferenceGroove (std::vector<Note> notes, double start, double length, const juce::String& n)
+    : startPpq (start), loopLength (length), name (n)
+{
+    jassert (! notes.empty() && loopLength > 0.0);
+
+    for (auto& note : notes)
+    {
+        note.ppq = std::fmod (note.ppq - startPpq, loopLength);
+
+        if (note.ppq < 0.0)
+            note.ppq += loopLength;
+    }
+
+    std::stable_sort (notes.begin(), notes.end(), [] (const Note& a, const Note& b) { return a.ppq < b.ppq; });
+
+    sorted.reserve (notes.size());
+    noteNumbers.reserve (notes.size());
+
+    for (const auto& note : notes)
+    {
+        sorted.push_back (note.ppq);
+        noteNumbers.push_back ((juce::uint8) (note.noteNumber & 127));
+    }
+
+    tree.resize (sorted.size() + 1);
+    ranks.resize (sorted.size() + 1);
+    buildTree (0, 1);
+}
+
+size_t ReferenceGroove::buildTree (size_t sortedIndex, size_t node)
+{
+    // An in-order walk of the implicit tree visits the nodes in ascending order
+    if (node < tree.size())
+    {
+        sortedIndex = buildTree (sortedIndex, 2 * node);
+        tree[node] = sorted[sortedIndex];
+        ranks[node] = (juce::uint32) sortedIndex;
+        sortedIndex = buildTree (sortedIndex + 1, 2 * node + 1);
+    }
+
+    return sortedIndex;
+}
+
+//==============================================================================
+double ReferenceGroove::findNearestPpq (double ppq) const noexcept
+{
+    return getNotePpq (findNearestIndex (ppq));
+}
+
+juce::int64 ReferenceGroove::findNearestIndex (double ppq) const noexcept
+{
+    const auto loop = std::floor ((ppq - startPpq) / loopLength);
+    const auto position = ppq - (startPpq + loop * loopLength);
+    const auto numNotes = sorted.size();
+
+    // Branch-free descent: go right while the node is below the position...
+    size_t node = 1;
+
+    while (node < tree.size())
+        node = 2 * node + (tree[node] < position ? 1 : 0);
+
+    // ...then undo the trailing right turns and the last left turn, which leaves
+    // the first node not below the position (0 if there isn't one).
+    while ((node & 1) != 0)
+        node >>= 1;
+
+    node >>= 1;
+
+    const auto rank = node == 0 ? numNotes : (size_t) ranks[node];
+    const auto after = rank < numNotes ? sorted[rank] : sorted.front() + loopLength;
+    const auto before = rank > 0 ? sorted[rank - 1] : sorted.back() - loopLength;
+
+    // Both neighbours as indices that count across loop repeats
+    const auto afterIndex = (juce::int64) loop * (juce::int64) numNotes + (juce::int64) rank;
+    return position - before <= after - position ? afterIndex - 1 : afterIndex;
+}
+
+size_t ReferenceGroove::wrap (juce::int64 index) const noexcept
+{
+    const auto numNotes = (juce::int64) sorted.size();
+    return (size_t) (((index % numNotes) + numNotes) % numNotes);
+}
+
+double ReferenceGroove::getNotePpq (juce::int64 index) const noexcept
+{
+    const auto numNotes = (juce::int64) sorted.size();
+    const auto loop = index >= 0 ? index / numNotes : -((-index - 1) / numNotes) - 1;
+    return startPpq + (double) loop * loopLength + sorted[wrap (index)];
+}
+
+int ReferenceGroove::getNoteNumber (juce::int64 index) const noexcept
+{
+    return noteNumbers[wrap (index)];
+}
+
+//==============================================================================
+std::unique_ptr<ReferenceGroove> ReferenceGroove::loadFromFile (const juce::File& file)
+{
+    std::vector<Note> notes;
+    double start = 0.0, end = 0.0;
+
+    if (file.hasFileExtension (SessionLogFormat::fileExtension))
+    {
+        SessionLogReader reader;
+
+        if (! reader.open (file))
+            return nullptr;
+
+        // Pedal crossings are logged too, but they aren't notes of the groove
+        for (juce::int64 i = 0; i < reader.getNumEvents(); ++i)
+            if (const auto e = reader.getEvent (i); ! e.isController)
+                notes.push_back ({ e.ppq, e.note });
+
+        if (notes.empty())
+            return nullptr;
+
+        // Loop the bars the take was recorded over, aligned to where it was played
+        const auto [first, last] = std::minmax_element (notes.begin(), notes.end(),
+                                                        [] (const Note& a, const Note& b) { return a.ppq < b.ppq; });
+        start = std::floor (first->ppq / quarterNotesPerBar) * quarterNotesPerBar;
+        end = last->ppq + 1.0e-6;
+    }
+    else
+    {
+        juce::FileInputStream in (file);
+        juce::MidiFile midiFile;
+
+        // SMPTE-timed files have no notion of quarter notes
+        if (! in.openedOk() || ! midiFile.readFrom (in) || midiFile.getTimeFormat() <= 0)
+            return nullptr;
+
+        const auto ticksPerQuarter = (double) midiFile.getTimeFormat();
+
+        for (int t = 0; t < midiFile.getNumTracks(); ++t)
+            for (const auto* event : *midiFile.getTrack (t))
+                if (event->message.isNoteOn())
+                    notes.push_back ({ event->message.getTimeStamp() / ticksPerQuarter, event->message.getNoteNumber() });
+
+        if (notes.empty())
+            return nullptr;
+
+        // Note-offs and the end-of-track marker usually sit at the end of the clip
+        end = midiFile.getLastTimestamp() / ticksPerQuarter;
+    }
+
+    return std::make_unique<ReferenceGroove> (std::move (notes), start, roundUpToBar (end - start),
+                                              file.getFileNameWithoutExtension());
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+#include "SessionRecorder.h"
+
+class ReferenceGrooveTests  : public juce::UnitTest
+{
+public:
+    ReferenceGrooveTests()  : juce::UnitTest ("ReferenceGroove", "Pocket") {}
+
+    void runTest() override
+    {
+        beginTest ("The tree search finds the same nearest note as a linear scan");
+        {
+            auto random = getRandom();
+
+            for (int round = 0; round < 100; ++round)
+            {
+                // From a single note to a few thousand, sometimes with notes stacked on the same spot
+                const auto numNotes = round < 4 ? round + 1 : random.nextInt ({ 1, 3000 });
+                const auto loopLength = 4.0 * random.nextInt ({ 1, 9 });
+                const auto start = (random.nextDouble() - 0.5) * 64.0;
+                std::vector<ReferenceGroove::Note> notes;
+
+                for (int i = 0; i < numNotes; ++i)
+                {
+                    const auto ppq = random.nextInt (4) == 0 && ! notes.empty() ? notes[(size_t) random.nextInt ((int) notes.size())].ppq
+                                                                                : start + random.nextDouble() * loopLength;
+                    notes.push_back ({ ppq, random.nextInt (128) });
+                }
+
+                const ReferenceGroove reference (notes, start, loopLength, "test");
+
+                for (int query = 0; query < 200; ++query)
+                {
+                    // Positions anywhere, including right at the loop boundaries and in earlier and later repeats
+                    const auto repeat = (double) random.nextInt ({ -3, 4 });
+                    const auto withinLoop = random.nextInt (4) == 0 ? (random.nextBool() ? 0.0 : loopLength) + (random.nextDouble() - 0.5) * 1.0e-3
+                                                                    : random.nextDouble() * loopLength;
+                    const auto ppq = start + repeat * loopLength + withinLoop;
+
+                    const auto found = reference.findNearestPpq (ppq);
+                    expectEquals (reference.getNotePpq (reference.findNearestIndex (ppq)), found);
+
+                    // Every note in this repeat and the ones either side of it
+                    auto nearestDistance = std::numeric_limits<double>::max();
+
+                    for (const auto& note : notes)
+                        for (int r = -1; r <= 1; ++r)
+                            nearestDistance = juce::jmin (nearestDistance, std::abs (ppq - (note.ppq + (std::floor ((ppq - start) / loopLength) + r) * loopLength)));
+
+                    expectWithinAbsoluteError (std::abs (ppq - found), nearestDistance, 1.0e-9);
+                }
+            }
+        }
+
+        beginTest ("A recorded take's pedal events aren't loaded as notes");
+        {
+            const auto log = juce::File::createTempFile (SessionLogFormat::fileExtension);
+            std::vector<TimingEvent> events;
+
+            for (int i = 0; i < 8; ++i)
+            {
+                TimingEvent e;
+                e.ppq = 4.0 + i * 0.5;
+                e.bar = 1;
+                e.note = 36;
+                events.push_back (e);
+
+                // A sustain pedal press between every two notes
+                e.ppq += 0.25;
+                e.note = 64;
+                e.isController = true;
+                events.push_back (e);
+            }
+
+            SessionRecorder recorder;
+            expect (recorder.start (log, 48000.0));
+            recorder.write (events.data(), (int) events.size());
+            recorder.stop();
+
+            const auto reference = ReferenceGroove::loadFromFile (log);
+            expect (reference != nullptr);
+
+            if (reference != nullptr)
+            {
+                expectEquals (reference->getNumNotes(), 8);
+                expectEquals (reference->findNearestPpq (4.3), 4.5);
+            }
+
+            log.deleteFile();
+        }
+    }
+};
+
+static ReferenceGrooveTests referenceGrooveTests;
+
+#endif
@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    ReferenceGroove.h
+
+    A reference performance that notes can be measured against instead of a
+    rigid grid.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+//==============================================================================
+/**
+    The note positions of a reference performance, looped so that it lines up
+    with the host timeline indefinitely.
+
+    The positions are stored in Eytzinger (breadth-first) order, so a search walks
+    down one cache-friendly path through the array; findNearestPpq() costs
+    O(log n) with no allocation and is safe to call from the audio thread, even
+    for references with hundreds of thousands of notes.
+
+    A groove is immutable once created, so any number of threads can use it at once.
+*/
+class ReferenceGroove
+{
+public:
+    struct Note
+    {
+        double ppq = 0.0;           // In quarter notes
+        int noteNumber = 0;
+    };
+
+    /** The groove repeats every loopLength quarter notes, starting from startPpq. */
+    ReferenceGroove (std::vector<Note> notes, double startPpq, double loopLength, const juce::String& name);
+
+    /** Loads the note-ons of a .mid file (all tracks) or a recorded .pocketlog (without its pedal events).
+        Returns nullptr if the file has no usable notes.
+    */
+    static std::unique_ptr<ReferenceGroove> loadFromFile (const juce::File& file);
+
+    /** Returns the position of the reference note closest to ppq, taking the loop into account. */
+    double findNearestPpq (double ppq) const noexcept;
+
+    //==============================================================================
+    /** Notes can also be addressed by an index that keeps counting across loop
+        repeats: index i is note (i mod n) of repeat (i / n), where repeat 0 starts
+        at startPpq. Indices can be negative.
+    */
+    juce::int64 findNearestIndex (double ppq) const noexcept;
+    double getNotePpq (juce::int64 index) const noexcept;
+    int getNoteNumber (juce::int64 index) const noexcept;
+
+    int getNumNotes() const noexcept                    { return (int) sorted.size(); }
+    double getLoopLength() const noexcept               { return loopLength; }
+    const juce::String& getName() const noexcept        { return name; }
+
+private:
+    size_t buildTree (size_t sortedIndex, size_t node);
+    size_t wrap (juce::int64 index) const noexcept;
+
+    std::vector<double> sorted;             // Loop-relative positions, ascending
+    std::vector<juce::uint8> noteNumbers;   // In the same order as sorted
+    std::vector<double> tree;               // The same positions in Eytzinger order, 1-based
+    std::vector<juce::uint32> ranks;        // For each tree node, its index in sorted
+    double startPpq = 0.0, loopLength = 4.0;
+    juce::String name;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReferenceGroove)
+};
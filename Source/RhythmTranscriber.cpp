@@ -0,0 +1,279 @@
+/*
+  ==============================================================================
+
+    RhythmTranscriber.cpp
+
+  ==============================================================================
+*/
+
+#include "RhythmTranscriber.h"
+
+//==============================================================================
+void RhythmTranscriber::process (const GridSettings& grid, const TimingEvent* events, int numEvents, juce::int64 firstNoteIndex)
+{
+    if (grid.reference != nullptr)
+    {
+        reset();
+        return;
+    }
+
+    if (grid.swing != currentGrid.swing || grid.latencyMs != currentGrid.latencyMs)
+    {
+        reset();
+        currentGrid = grid;
+    }
+
+    for (int i = 0; i < numEvents; ++i)
+    {
+        // Pedal timing says nothing about the subdivision the notes were meant as
+        if (events[i].isController)
+            continue;
+
+        if (events[i].take != currentTake)
+        {
+            reset();
+            currentTake = events[i].take;
+        }
+
+        addNote (events[i], firstNoteIndex + i);
+    }
+}
+
+void RhythmTranscriber::flush()
+{
+    if (numNotesAdded == numNotesDecided)
+        return;
+
+    // Walk back along the best path to find every waiting note's division...
+    std::array<int, ringSize> divisions;
+    auto division = (int) std::distance (pathCosts.begin(), std::min_element (pathCosts.begin(), pathCosts.end()));
+
+    for (auto n = numNotesAdded - 1; n >= numNotesDecided; --n)
+    {
+        divisions[(size_t) (n % ringSize)] = division;
+
+        if (n > numNotesDecided)
+            division = backPointers[(size_t) (n % ringSize)][(size_t) division];
+    }
+
+    // ...then decide them in order. The next note starts a new path.
+    while (numNotesDecided < numNotesAdded)
+        decide ((int) (numNotesDecided % ringSize), divisions[(size_t) (numNotesDecided % ringSize)]);
+}
+
+void RhythmTranscriber::reset()
+{
+    flush();
+    currentTake = -1;
+}
+
+void RhythmTranscriber::clear()
+{
+    numNotesAdded = numNotesDecided = 0;
+    currentTake = -1;
+    latestDivision = -1;
+    decisions.clear();
+
+    const juce::ScopedLock sl (resultsLock);
+    results = {};
+}
+
+RhythmTranscriber::Results RhythmTranscriber::getResults() const
+{
+    const juce::ScopedLock sl (resultsLock);
+    return results;
+}
+
+void RhythmTranscriber::popDecisions (std::vector<Decision>& dest)
+{
+    dest.clear();
+    std::swap (dest, decisions);
+}
+
+//==============================================================================
+void RhythmTranscriber::addNote (const TimingEvent& e, juce::int64 noteIndex)
+{
+    const auto ringIndex = (size_t) (numNotesAdded % ringSize);
+    auto& noteDeviations = deviations[ringIndex];
+    noteIndices[ringIndex] = noteIndex;
+    sampleTimes[ringIndex] = e.sampleTime;
+    Scores fit;
+
+    for (int d = 0; d < numDivisions; ++d)
+    {
+        auto grid = currentGrid;
+        grid.stepPpq = GridSettings::getDivisionStepPpq (d);
+        grid.reference = nullptr;
+
+        const auto deviation = (float) computeDeviationMs (e.ppq, e.bpm, grid);
+        noteDeviations[(size_t) d] = deviation;
+        fit[(size_t) d] = 0.5f * (deviation / sigmaMs) * (deviation / sigmaMs) + divisionCosts[(size_t) d];
+    }
+
+    if (numNotesAdded == numNotesDecided)
+    {
+        pathCosts = fit;
+    }
+    else
+    {
+        Scores newCosts;
+
+        for (int d = 0; d < numDivisions; ++d)
+        {
+            auto best = 0;
+            auto bestCost = std::numeric_limits<float>::max();
+
+            for (int from = 0; from < numDivisions; ++from)
+            {
+                const auto cost = pathCosts[(size_t) from] + (from == d ? 0.0f : switchCost);
+
+                if (cost < bestCost)
+                {
+                    best = from;
+                    bestCost = cost;
+                }
+            }
+
+            newCosts[(size_t) d] = bestCost + fit[(size_t) d];
+            backPointers[ringIndex][(size_t) d] = (juce::uint8) best;
+        }
+
+        // Only the differences between paths matter; keep the numbers small
+        const auto minCost = *std::min_element (newCosts.begin(), newCosts.end());
+
+        for (int d = 0; d < numDivisions; ++d)
+            pathCosts[(size_t) d] = newCosts[(size_t) d] - minCost;
+    }
+
+    ++numNotesAdded;
+
+    // Once a note is `lag` notes old, follow the current best path back to it
+    if (numNotesAdded - numNotesDecided > lag)
+    {
+        auto division = (int) std::distance (pathCosts.begin(), std::min_element (pathCosts.begin(), pathCosts.end()));
+
+        for (auto n = numNotesAdded - 1; n > numNotesDecided; --n)
+            division = backPointers[(size_t) (n % ringSize)][(size_t) division];
+
+        decide ((int) (numNotesDecided % ringSize), division);
+    }
+}
+
+void RhythmTranscriber::decide (int ringIndex, int division)
+{
+    const auto deviation = deviations[(size_t) ringIndex][(size_t) division];
+    decisions.push_back ({ noteIndices[(size_t) ringIndex], sampleTimes[(size_t) ringIndex], deviation });
+
+    const juce::ScopedLock sl (resultsLock);
+    results.deviations.add (deviation);
+    ++results.notesPerDivision[(size_t) division];
+    ++numNotesDecided;
+    latestDivision.store (division, std::memory_order_relaxed);
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class RhythmTranscriberTests  : public juce::UnitTest
+{
+public:
+    RhythmTranscriberTests()  : juce::UnitTest ("RhythmTranscriber", "Pocket") {}
+
+    void runTest() override
+    {
+        beginTest ("Each section is measured against the subdivision it was played in");
+        {
+            constexpr double bpm = 120.0;
+            constexpr double msPerQuarter = 60000.0 / bpm;
+            constexpr juce::int64 firstNoteIndex = 1000;
+
+            // 8ths, then 16ths with every off-beat rushed by 30-40 ms, then 8th triplets,
+            // all with a few ms of jitter
+            struct Section { int division; int numNotes; };
+            const Section sections[] = { { 1, 32 }, { 2, 64 }, { 3, 48 } };
+
+            auto random = getRandom();
+            std::vector<TimingEvent> events;
+            std::vector<double> truth;
+            double sectionStartPpq = 0.0;
+
+            for (const auto& section : sections)
+            {
+                const auto stepPpq = GridSettings::getDivisionStepPpq (section.division);
+
+                for (int i = 0; i < section.numNotes; ++i)
+                {
+                    auto deviationMs = (random.nextDouble() - 0.5) * 8.0;
+
+                    if (section.division == 2 && i % 2 == 1)
+                        deviationMs = -30.0 - random.nextDouble() * 10.0;
+
+                    TimingEvent e;
+                    e.ppq = sectionStartPpq + i * stepPpq + deviationMs / msPerQuarter;
+                    e.bpm = bpm;
+                    e.sampleTime = (juce::int64) (e.ppq * msPerQuarter * 48.0);
+                    e.take = 1;
+                    events.push_back (e);
+                    truth.push_back (deviationMs);
+                }
+
+                sectionStartPpq += section.numNotes * stepPpq;
+            }
+
+            // Fed in uneven batches, as the workers drain them
+            RhythmTranscriber transcriber;
+            const auto numNotes = (int) events.size();
+
+            for (int i = 0; i < numNotes; i += 7)
+                transcriber.process ({}, events.data() + i, juce::jmin (7, numNotes - i), firstNoteIndex + i);
+
+            transcriber.reset();
+
+            std::vector<RhythmTranscriber::Decision> decisions;
+            transcriber.popDecisions (decisions);
+            expectEquals ((int) decisions.size(), numNotes);
+
+            double inferredSquares = 0.0, truthSquares = 0.0, eighthSquares = 0.0;
+            int numCorrect = 0;
+            GridSettings eighths;
+            eighths.stepPpq = 0.5;
+
+            for (int i = 0; i < juce::jmin (numNotes, (int) decisions.size()); ++i)
+            {
+                const auto& decision = decisions[(size_t) i];
+                expectEquals (decision.noteIndex, firstNoteIndex + i);
+                expectEquals (decision.sampleTime, events[(size_t) i].sampleTime);
+
+                if (std::abs (decision.deviationMs - truth[(size_t) i]) < 0.01)
+                    ++numCorrect;
+
+                const auto eighthDeviation = computeDeviationMs (events[(size_t) i].ppq, bpm, eighths);
+                inferredSquares += decision.deviationMs * decision.deviationMs;
+                truthSquares += truth[(size_t) i] * truth[(size_t) i];
+                eighthSquares += eighthDeviation * eighthDeviation;
+            }
+
+            // Only the notes around a change of section can be misread
+            expectGreaterOrEqual (numCorrect, numNotes - 2);
+
+            const auto results = transcriber.getResults();
+            expectEquals (results.deviations.numNotes, (juce::int64) numNotes);
+
+            for (const auto& section : sections)
+                expectWithinAbsoluteError ((int) results.notesPerDivision[(size_t) section.division], section.numNotes, 2);
+
+            const auto inferredRms = std::sqrt (inferredSquares / numNotes);
+            const auto truthRms = std::sqrt (truthSquares / numNotes);
+            const auto eighthRms = std::sqrt (eighthSquares / numNotes);
+            logMessage ("RMS deviation: " + juce::String (truthRms, 1) + " ms played, " + juce::String (inferredRms, 1)
+                        + " ms inferred, " + juce::String (eighthRms, 1) + " ms against 1/8");
+
+            expectWithinAbsoluteError (inferredRms, truthRms, 0.05 * truthRms);
+            expectGreaterThan (eighthRms, 2.5 * truthRms);
+        }
+    }
+};
+
+static RhythmTranscriberTests rhythmTranscriberTests;
+
+#endif
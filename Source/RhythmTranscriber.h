@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+    RhythmTranscriber.h
+
+    Infers which subdivision the player meant before measuring each note.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include "TimingEvent.h"
+#include "TimingGrid.h"
+#include "SessionStatistics.h"
+
+//==============================================================================
+/**
+    Decides, note by note, which of the grid divisions (1/4 to 1/16T) the player
+    was playing, and measures each note against that division.
+
+    Rounding to a fixed grid misreads a badly rushed 16th as a slightly late 8th.
+    Instead, this runs a Viterbi decoder over the candidate divisions: each note
+    scores how well it fits each division (a Gaussian on its deviation, plus a
+    small penalty for finer divisions, since every note fits a fine enough grid),
+    and changing division between consecutive notes costs extra, because players
+    tend to stay in one subdivision for a while.
+
+    Decoding uses a fixed lag: a note's division is decided once `lag` more notes
+    have arrived (or the take ends), looking back along the best path. Memory and
+    the work per note are fixed, so it can keep up with drum rolls indefinitely.
+
+    Each decision is also queued as a Decision naming the note's index in the
+    session, so the session statistics can measure every note against its own
+    division when the grid is "Inferred". Notes that have to be shown before
+    they're decided (the live display and the session log) use the division of
+    the last decided note instead.
+
+    process(), reset(), clear(), hasUndecidedNotes() and popDecisions() must only
+    be called from one thread (the analysis worker); getResults() and getLatestDivision() can be
+    called from any thread.
+*/
+class RhythmTranscriber
+{
+public:
+    RhythmTranscriber() = default;
+
+    static constexpr int numDivisions = 5;      // The rhythmic choices of GridSettings::getDivisionNames()
+    static constexpr int lag = 8;
+
+    struct Results
+    {
+        SessionStatistics deviations;           // Against each note's inferred division
+        std::array<juce::int64, numDivisions> notesPerDivision {};
+    };
+
+    /** A note whose division has been decided, and its deviation from that division. */
+    struct Decision
+    {
+        juce::int64 noteIndex = 0;      // As passed to process()
+        juce::int64 sampleTime = 0;     // The note's, to check it's still the same note
+        float deviationMs = 0.0f;
+    };
+
+    /** Decodes new notes using the grid's swing and latency (its division is ignored).
+        firstNoteIndex is the session index of events[0]; the others follow on from it.
+        Notes are skipped while the grid measures against a reference, and pedal
+        crossings always are (they keep their deviation from quarter notes).
+    */
+    void process (const GridSettings& grid, const TimingEvent* events, int numEvents, juce::int64 firstNoteIndex);
+
+    /** Ends the current path, e.g. when the player stops or the grid changes: the
+        notes still waiting for their lag are decided, and the next note starts a new
+        path. The results are kept.
+    */
+    void reset();
+
+    /** Forgets the path and the results, e.g. when a new session starts. */
+    void clear();
+
+    /** True while some notes are waiting for their lag. */
+    bool hasUndecidedNotes() const noexcept     { return numNotesAdded != numNotesDecided; }
+
+    Results getResults() const;
+
+    /** The division of the last decided note, or -1 before the first; lock-free. */
+    int getLatestDivision() const noexcept      { return latestDivision.load (std::memory_order_relaxed); }
+
+    /** Replaces the contents of dest with the notes decided since the last call. */
+    void popDecisions (std::vector<Decision>& dest);
+
+private:
+    void flush();
+    void addNote (const TimingEvent&, juce::int64 noteIndex);
+    void decide (int ringIndex, int division);
+
+    using Scores = std::array<float, numDivisions>;
+    static constexpr int ringSize = lag + 1;
+
+    GridSettings currentGrid;
+    int currentTake = -1;
+
+    Scores pathCosts {};
+    std::array<std::array<juce::uint8, numDivisions>, ringSize> backPointers {};
+    std::array<std::array<float, numDivisions>, ringSize> deviations {};   // Each note against each division
+    std::array<juce::int64, ringSize> noteIndices {}, sampleTimes {};
+    juce::int64 numNotesAdded = 0, numNotesDecided = 0;
+    std::vector<Decision> decisions;
+
+    juce::CriticalSection resultsLock;
+    Results results;
+    std::atomic<int> latestDivision { -1 };
+
+    static constexpr float sigmaMs = 20.0f;
+    static constexpr float switchCost = 3.0f;
+    static constexpr std::array<float, numDivisions> divisionCosts { 0.0f, 0.5f, 1.0f, 1.5f, 2.5f };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RhythmTranscriber)
+};
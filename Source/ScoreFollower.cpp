@@ -0,0 +1,380 @@
+/*
+  ==============================================================================
+
+    ScoreFollower.cpp
+
+  ==============================================================================
+*/
+
+#include "ScoreFollower.h"
+
+//==============================================================================
+void ScoreFollower::process (const GridSettings& grid, const TimingEvent* events, int numEvents)
+{
+    jassert (grid.reference != nullptr);
+
+    if (grid.reference != currentReference)
+    {
+        reset();
+        currentReference = grid.reference;
+    }
+
+    // References hold notes only, so pedal crossings would all count as extra
+    for (int i = 0; i < numEvents; ++i)
+        if (! events[i].isController)
+            processNote (grid, events[i]);
+}
+
+void ScoreFollower::reset()
+{
+    currentReference = nullptr;
+    synced = false;
+
+    const juce::ScopedLock sl (resultsLock);
+    results = {};
+}
+
+ScoreFollower::Results ScoreFollower::getResults() const
+{
+    const juce::ScopedLock sl (resultsLock);
+    return results;
+}
+
+//==============================================================================
+void ScoreFollower::resync (const ReferenceGroove& reference, double ppq)
+{
+    // Start with the nearest reference note a quarter of the way into the window,
+    // and no opinion yet about anything before it
+    windowStart = reference.findNearestIndex (ppq) - windowSize / 4;
+    window.fill ({});
+    lastReportedMatch = -1;
+    synced = true;
+}
+
+bool ScoreFollower::isInChord (const ReferenceGroove& reference, juce::int64 index, int noteNumber) noexcept
+{
+    if (reference.getNoteNumber (index) == noteNumber)
+        return true;
+
+    // The notes of a chord are played in any order, so any of them will do
+    const auto ppq = reference.getNotePpq (index);
+
+    for (int step : { -1, 1 })
+        for (auto i = index + step; std::abs (i - index) < windowSize && std::abs (reference.getNotePpq (i) - ppq) <= chordSpreadPpq; i += step)
+            if (reference.getNoteNumber (i) == noteNumber)
+                return true;
+
+    return false;
+}
+
+void ScoreFollower::processNote (const GridSettings& grid, const TimingEvent& e)
+{
+    const auto& reference = *grid.reference;
+    const auto msPerQuarter = 60000.0 / e.bpm;
+    const auto ppq = e.ppq - grid.latencyMs / msPerQuarter;
+
+    if (! synced || e.take != currentTake
+         || std::abs (ppq - reference.getNotePpq (windowStart + windowSize / 4)) > resyncDistancePpq)
+    {
+        resync (reference, ppq);
+        currentTake = e.take;
+    }
+
+    // One column of the alignment: state k means every reference note before
+    // windowStart + k has been matched or missed
+    std::array<State, windowSize> next;
+
+    for (int k = 0; k < windowSize; ++k)
+    {
+        // This note is extra
+        auto best = window[(size_t) k];
+        best.cost += extraCost;
+        best.matchedThisNote = false;
+
+        if (k > 0)
+        {
+            const auto j = windowStart + k - 1;
+
+            // This note is reference note j...
+            const auto distance = (float) std::abs (ppq - reference.getNotePpq (j));
+            const auto matchCost = window[(size_t) k - 1].cost + juce::jmin (distance * costPerQuarter, 100.0f)
+                                     + (isInChord (reference, j, e.note) ? 0.0f : wrongPitchCost);
+
+            if (matchCost < best.cost)
+                best = { matchCost, j, true };
+
+            // ...or reference note j was missed
+            const auto& previous = next[(size_t) k - 1];
+
+            if (previous.cost + missCost < best.cost)
+                best = { previous.cost + missCost, previous.lastMatch, previous.matchedThisNote };
+        }
+
+        next[(size_t) k] = best;
+    }
+
+    auto cheapest = 0;
+
+    for (int k = 1; k < windowSize; ++k)
+        if (next[(size_t) k].cost < next[(size_t) cheapest].cost)
+            cheapest = k;
+
+    // Report this note from the cheapest alignment so far. It can only move forwards
+    // through the reference; anything else is counted as extra.
+    const auto& result = next[(size_t) cheapest];
+
+    {
+        const juce::ScopedLock sl (resultsLock);
+
+        if (result.matchedThisNote && result.lastMatch > lastReportedMatch)
+        {
+            if (lastReportedMatch >= 0)
+                results.numMissed += result.lastMatch - lastReportedMatch - 1;
+
+            ++results.numMatched;
+            results.matched.add ((ppq - reference.getNotePpq (result.lastMatch)) * msPerQuarter);
+            lastReportedMatch = result.lastMatch;
+        }
+        else
+        {
+            ++results.numExtra;
+        }
+    }
+
+    // Keep the costs small, and slide the window along so the cheapest state stays
+    // a quarter of the way in; states that slide in at the end are reached by missing notes.
+    const auto minCost = result.cost;
+    const auto shift = juce::jmax (0, cheapest - windowSize / 4);
+
+    for (int k = 0; k < windowSize; ++k)
+    {
+        if (k + shift < windowSize)
+        {
+            window[(size_t) k] = next[(size_t) (k + shift)];
+            window[(size_t) k].cost -= minCost;
+        }
+        else
+        {
+            window[(size_t) k] = window[(size_t) k - 1];
+            window[(size_t) k].cost += missCost;
+        }
+    }
+
+    windowStart += shift;
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class ScoreFollowerTests  : public juce::UnitTest
+{
+public:
+    ScoreFollowerTests()  : juce::UnitTest ("ScoreFollower", "Pocket") {}
+
+    void runTest() override
+    {
+        // One bar of eighth notes: kick, hi-hat, snare, hi-hat...
+        std::vector<ReferenceGroove::Note> notes;
+
+        for (int i = 0; i < 8; ++i)
+            notes.push_back ({ i * 0.5, i % 2 != 0 ? 42 : (i % 4 == 0 ? 36 : 38) });
+
+        const ReferenceGroove reference (notes, 0.0, 4.0, "test");
+
+        GridSettings grid;
+        grid.reference = &reference;
+
+        constexpr double bpm = 120.0, msPerQuarter = 60000.0 / bpm;
+        constexpr int numBars = 16;
+
+        // Plays the reference numBars times, offset by offsetMs, leaving out the notes
+        // skip() picks and adding an off-pitch 16th after the ones extra() picks
+        const auto play = [&] (ScoreFollower& follower, double offsetMs, auto skip, auto extra)
+        {
+            std::vector<TimingEvent> events;
+
+            for (int i = 0; i < numBars * reference.getNumNotes(); ++i)
+            {
+                TimingEvent e;
+                e.ppq = reference.getNotePpq (i) + offsetMs / msPerQuarter;
+                e.bpm = bpm;
+                e.note = (juce::uint8) reference.getNoteNumber (i);
+                e.take = 1;
+
+                if (! skip (i))
+                    events.push_back (e);
+
+                if (extra (i))
+                {
+                    e.ppq += 0.25;
+                    e.note = 60;
+                    events.push_back (e);
+                }
+            }
+
+            follower.process (grid, events.data(), (int) events.size());
+        };
+
+        const auto never = [] (int) { return false; };
+        constexpr auto numNotes = (juce::int64) numBars * 8;
+
+        beginTest ("A faithful run matches every note");
+        {
+            ScoreFollower follower;
+            play (follower, 5.0, never, never);
+
+            const auto results = follower.getResults();
+            expectEquals (results.numMatched, numNotes);
+            expectEquals (results.numMissed, (juce::int64) 0);
+            expectEquals (results.numExtra, (juce::int64) 0);
+            expectWithinAbsoluteError (results.matched.getMeanMs(), 5.0, 1.0e-6);
+        }
+
+        beginTest ("Skipped notes are missed and the rest still match");
+        {
+            ScoreFollower follower;
+            const auto skip = [] (int i) { return i % 10 == 5; };
+            play (follower, -3.0, skip, never);
+
+            juce::int64 numSkipped = 0;
+
+            for (int i = 0; i < numNotes; ++i)
+                numSkipped += skip (i) ? 1 : 0;
+
+            const auto results = follower.getResults();
+            expectEquals (results.numMatched, numNotes - numSkipped);
+            expectEquals (results.numMissed, numSkipped);
+            expectEquals (results.numExtra, (juce::int64) 0);
+            expectWithinAbsoluteError (results.matched.getMeanMs(), -3.0, 1.0e-6);
+        }
+
+        beginTest ("Added notes are extra and don't pull the others off");
+        {
+            ScoreFollower follower;
+            const auto extra = [] (int i) { return i % 7 == 3; };
+            play (follower, 0.0, never, extra);
+
+            juce::int64 numAdded = 0;
+
+            for (int i = 0; i < numNotes; ++i)
+                numAdded += extra (i) ? 1 : 0;
+
+            const auto results = follower.getResults();
+            expectEquals (results.numMatched, numNotes);
+            expectEquals (results.numMissed, (juce::int64) 0);
+            expectEquals (results.numExtra, numAdded);
+            expectWithinAbsoluteError (results.matched.getMeanMs(), 0.0, 1.0e-6);
+        }
+
+        beginTest ("Pedal crossings between the notes are left out");
+        {
+            // A hi-hat pedal chick (CC4) on every beat and a sustain press (CC64) every bar
+            std::vector<TimingEvent> events;
+
+            for (int i = 0; i < numBars * reference.getNumNotes(); ++i)
+            {
+                TimingEvent e;
+                e.ppq = reference.getNotePpq (i);
+                e.bpm = bpm;
+                e.note = (juce::uint8) reference.getNoteNumber (i);
+                e.take = 1;
+                events.push_back (e);
+
+                if (i % 2 == 0)
+                {
+                    e.note = 4;
+                    e.velocity = 100;
+                    e.isController = true;
+                    events.push_back (e);
+                }
+
+                if (i % 8 == 0)
+                {
+                    e.note = 64;
+                    e.velocity = 127;
+                    e.isController = true;
+                    events.push_back (e);
+                }
+            }
+
+            ScoreFollower follower;
+            follower.process (grid, events.data(), (int) events.size());
+
+            const auto results = follower.getResults();
+            expectEquals (results.numMatched, numNotes);
+            expectEquals (results.numMissed, (juce::int64) 0);
+            expectEquals (results.numExtra, (juce::int64) 0);
+            expectWithinAbsoluteError (results.matched.getMeanMs(), 0.0, 1.0e-6);
+        }
+
+        beginTest ("The notes of a chord match in any order");
+        {
+            // A hi-hat with every eighth, and a kick or snare with it on the beats
+            std::vector<ReferenceGroove::Note> chordNotes;
+
+            for (int i = 0; i < 8; ++i)
+            {
+                chordNotes.push_back ({ i * 0.5, 42 });
+
+                if (i % 2 == 0)
+                    chordNotes.push_back ({ i * 0.5, i % 4 == 0 ? 36 : 38 });
+            }
+
+            const ReferenceGroove chords (chordNotes, 0.0, 4.0, "chords");
+            GridSettings chordGrid;
+            chordGrid.reference = &chords;
+
+            // Each chord's notes arrive a millisecond apart, in the order opposite to the reference's
+            std::vector<TimingEvent> events;
+
+            for (int i = 0; i < numBars * chords.getNumNotes(); ++i)
+            {
+                TimingEvent e;
+                e.ppq = chords.getNotePpq (i);
+                e.bpm = bpm;
+                e.note = (juce::uint8) chords.getNoteNumber (i);
+                e.take = 1;
+
+                const auto isSecondOfChord = i > 0 && chords.getNotePpq (i - 1) == e.ppq;
+
+                if (isSecondOfChord)
+                {
+                    auto first = events.back();
+                    first.ppq += 1.0 / msPerQuarter;
+                    events.back() = e;
+                    events.push_back (first);
+                }
+                else
+                {
+                    events.push_back (e);
+                }
+            }
+
+            ScoreFollower follower;
+            follower.process (chordGrid, events.data(), (int) events.size());
+
+            const auto results = follower.getResults();
+            expectEquals (results.numMatched, (juce::int64) (numBars * chords.getNumNotes()));
+            expectEquals (results.numMissed, (juce::int64) 0);
+            expectEquals (results.numExtra, (juce::int64) 0);
+        }
+
+        beginTest ("reset() starts the counts over");
+        {
+            ScoreFollower follower;
+            play (follower, 0.0, never, never);
+            follower.reset();
+
+            const auto results = follower.getResults();
+            expectEquals (results.numMatched + results.numMissed + results.numExtra, (juce::int64) 0);
+            expectEquals (results.matched.numNotes, (juce::int64) 0);
+
+            play (follower, 0.0, never, never);
+            expectEquals (follower.getResults().numMatched, numNotes);
+        }
+    }
+};
+
+static ScoreFollowerTests scoreFollowerTests;
+
+#endif
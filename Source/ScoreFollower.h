@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    ScoreFollower.h
+
+    Online alignment of the incoming notes with a reference performance.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include "TimingEvent.h"
+#include "TimingGrid.h"
+#include "SessionStatistics.h"
+
+//==============================================================================
+/**
+    Follows the player through a ReferenceGroove and sorts every note into
+    matched, missed or extra, so a skipped or added note doesn't throw the
+    deviations of the following notes off.
+
+    It's a banded dynamic programming (edit distance) alignment: a window of
+    windowSize reference notes around the current position keeps the cheapest
+    way to have reached each of them, where matching a note costs its timing and
+    pitch difference, and skipping a reference note (missed) or playing one that
+    isn't there (extra) have fixed costs. The notes of a chord (reference notes
+    within chordSpreadPpq of each other) can be matched in any order. Each
+    incoming note updates the window once, and its result is read off the
+    cheapest entry straight away, so every note costs O(windowSize) and nothing
+    is held back.
+
+    The window follows the cheapest entry. The follower resynchronises on the
+    nearest reference note when a new take starts, the reference changes, or the
+    player jumps too far away from where it expected them.
+
+    process() must only be called from one thread (the analysis worker);
+    getResults() can be called from any thread.
+*/
+class ScoreFollower
+{
+public:
+    ScoreFollower() = default;
+
+    struct Results
+    {
+        juce::int64 numMatched = 0;
+        juce::int64 numMissed = 0;
+        juce::int64 numExtra = 0;
+        SessionStatistics matched;      // Deviations from the matched reference notes
+    };
+
+    /** Aligns new notes with grid.reference, which must be set. The grid's latency
+        offset is applied first; everything else about the grid is ignored. Controller
+        events (pedal crossings) are skipped, as references hold notes only.
+    */
+    void process (const GridSettings& grid, const TimingEvent* events, int numEvents);
+    void reset();
+
+    Results getResults() const;
+
+    static constexpr int windowSize = 32;
+
+private:
+    void processNote (const GridSettings&, const TimingEvent&);
+    void resync (const ReferenceGroove&, double ppq);
+    static bool isInChord (const ReferenceGroove&, juce::int64 index, int noteNumber) noexcept;
+
+    struct State
+    {
+        float cost = 0.0f;
+        juce::int64 lastMatch = -1;     // Reference note last matched on the way to this state
+        bool matchedThisNote = false;
+    };
+
+    // State k means every reference note before windowStart + k has been dealt with
+    std::array<State, windowSize> window;
+    juce::int64 windowStart = 0;
+
+    const ReferenceGroove* currentReference = nullptr;
+    juce::int64 lastReportedMatch = -1;
+    int currentTake = -1;
+    bool synced = false;
+
+    juce::CriticalSection resultsLock;
+    Results results;
+
+    // Missing a note is cheap compared to an extra one, so that skipping ahead to a
+    // note that fits well beats calling it extra; a 16th note off costs as much as
+    // an extra note.
+    static constexpr float missCost = 0.3f, extraCost = 1.0f;
+    static constexpr float costPerQuarter = 4.0f;
+    static constexpr float wrongPitchCost = 1.0f;
+    static constexpr double resyncDistancePpq = 4.0;
+    static constexpr double chordSpreadPpq = 1.0 / 64.0;    // Reference notes this close are one chord
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ScoreFollower)
+};
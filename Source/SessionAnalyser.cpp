@@ -0,0 +1,583 @@
+/*
+  ==============================================================================
+
+    SessionAnalyser.cpp
+
+  ==============================================================================
+*/
+
+#include "SessionAnalyser.h"
+
+//==============================================================================
+struct SessionAnalyser::Reanalysis
+{
+    GridSettings grid;
+    size_t numNotes = 0;
+    std::vector<SessionStatistics> partials;
+    std::vector<float> deviations;
+    std::atomic<int> numRemaining { 0 };
+    std::atomic<bool> cancelled { false };
+};
+
+//==============================================================================
+SessionAnalyser::SessionAnalyser (AnalysisWorkerPool& p)  : pool (p)
+{
+}
+
+SessionAnalyser::~SessionAnalyser()
+{
+    {
+        const juce::ScopedLock sl (statsLock);
+
+        if (currentReanalysis != nullptr)
+            currentReanalysis->cancelled = true;
+    }
+
+    // Cancelled chunks return straight away, but they and any query still hold a pointer to us
+    while (numJobsInFlight.load() > 0)
+        juce::Thread::sleep (1);
+}
+
+//==============================================================================
+juce::int64 SessionAnalyser::addEvents (const TimingEvent* events, int numEvents)
+{
+    POCKET_TRACE_SCOPE (*tracer, "statistics update");
+
+    // statsLock is always taken before notesLock, so a re-analysis can't start
+    // between storing these notes and counting them.
+    const juce::ScopedLock sl (statsLock);
+
+    lastNoteTime = juce::Time::currentTimeMillis();
+
+    if (firstNoteTime == 0)
+        firstNoteTime = lastNoteTime;
+
+    auto& target = currentReanalysis != nullptr ? newNoteStatistics : statistics;
+    std::vector<float> deviations ((size_t) numEvents), inferredDeviations ((size_t) numEvents);
+
+    // Until the decoder decides a note, its inferred deviation is against quarter notes
+    auto undecidedGrid = grid;
+    undecidedGrid.stepPpq = 1.0;
+    undecidedGrid.reference = nullptr;
+
+    for (int i = 0; i < numEvents; ++i)
+    {
+        const auto deviation = computeDeviationMs (events[i].ppq, events[i].bpm, grid);
+        deviations[(size_t) i] = (float) deviation;
+        inferredDeviations[(size_t) i] = (float) computeDeviationMs (events[i].ppq, events[i].bpm, undecidedGrid);
+
+        // Inferred deviations are replaced one by one later, so they're counted exactly as stored
+        target.add (grid.inferred ? (double) inferredDeviations[(size_t) i] : deviation);
+    }
+
+    juce::int64 firstIndex = 0;
+
+    {
+        const juce::ScopedWriteLock wl (notesLock);
+        firstIndex = (juce::int64) notes.size();
+        notes.append (events, grid.inferred ? inferredDeviations.data() : deviations.data(), inferredDeviations.data(), numEvents);
+    }
+
+    ++notesVersion;
+    return firstIndex;
+}
+
+void SessionAnalyser::setInferredDeviations (const RhythmTranscriber::Decision* decisions, int numDecisions)
+{
+    if (numDecisions == 0)
+        return;
+
+    const juce::ScopedLock sl (statsLock);
+
+    {
+        const juce::ScopedWriteLock wl (notesLock);
+
+        for (int i = 0; i < numDecisions; ++i)
+        {
+            const auto& decision = decisions[i];
+            const auto index = (size_t) decision.noteIndex;
+
+            if (decision.noteIndex < 0 || index >= notes.size() || notes.sampleTime[index] != decision.sampleTime)
+                continue;
+
+            notes.inferredDeviationMs[index] = decision.deviationMs;
+
+            if (! grid.inferred)
+                continue;
+
+            // A running re-analysis replaces the deviations it covers when it finishes,
+            // so those notes are corrected again then
+            if (currentReanalysis != nullptr && index < currentReanalysis->numNotes)
+                lateDecisions.push_back (decision);
+            else
+                applyInferredDeviation (index, decision.deviationMs, currentReanalysis != nullptr ? newNoteStatistics : statistics);
+        }
+    }
+
+    if (grid.inferred)
+        ++notesVersion;
+}
+
+void SessionAnalyser::applyInferredDeviation (size_t noteIndex, float deviationMs, SessionStatistics& target)
+{
+    // Called with statsLock and notesLock held
+    auto& stored = notes.deviationMs[noteIndex];
+
+    if (stored != deviationMs)
+    {
+        target.remove (stored);
+        target.add (deviationMs);
+        stored = deviationMs;
+    }
+}
+
+void SessionAnalyser::setGrid (const GridSettings& newGrid)
+{
+    const juce::ScopedLock sl (statsLock);
+
+    if (newGrid == grid)
+        return;
+
+    grid = newGrid;
+    startReanalysis();
+}
+
+void SessionAnalyser::clear()
+{
+    const juce::ScopedLock sl (statsLock);
+
+    if (currentReanalysis != nullptr)
+        currentReanalysis->cancelled = true;
+
+    currentReanalysis = nullptr;
+    lateDecisions.clear();
+
+    {
+        const juce::ScopedWriteLock wl (notesLock);
+        notes.clear();
+    }
+
+    statistics = {};
+    newNoteStatistics = {};
+    firstNoteTime = lastNoteTime = 0;
+    progress = 1.0;
+    ++notesVersion;
+}
+
+SessionStatistics SessionAnalyser::getStatistics() const
+{
+    const juce::ScopedLock sl (statsLock);
+
+    auto result = statistics;
+
+    if (currentReanalysis != nullptr)
+        result.merge (newNoteStatistics);
+
+    return result;
+}
+
+SessionStatistics SessionAnalyser::query (const EventFilter& filter) const
+{
+    POCKET_TRACE_SCOPE (*tracer, "statistics query");
+    const juce::ScopedReadLock rl (notesLock);
+    return notes.query (filter);
+}
+
+void SessionAnalyser::requestQuery (const EventFilter& filter)
+{
+    const auto version = notesVersion.load();
+
+    if ((filter == queriedFilter && version == queriedVersion) || queryRunning.load())
+        return;
+
+    queriedFilter = filter;
+    queriedVersion = version;
+    queryRunning = true;
+    ++numJobsInFlight;
+
+    pool.addJob ([this, filter]
+    {
+        std::atomic_store (&queryResult, std::shared_ptr<const SessionStatistics> (std::make_shared<SessionStatistics> (query (filter))));
+        queryRunning = false;
+        --numJobsInFlight;
+    });
+}
+
+SessionStatistics SessionAnalyser::getQueryResult() const
+{
+    if (const auto result = std::atomic_load (&queryResult))
+        return *result;
+
+    return {};
+}
+
+SessionSummary SessionAnalyser::createSummary() const
+{
+    const auto stats = getStatistics();
+
+    SessionSummary summary;
+    summary.numNotes = stats.numNotes;
+    summary.meanMs = (float) stats.getMeanMs();
+    summary.standardDeviationMs = (float) stats.getStandardDeviationMs();
+    summary.earlyShare = stats.numNotes > 0 ? (float) stats.numEarly / (float) stats.numNotes : 0.0f;
+    summary.p10Ms = (float) stats.getPercentileMs (0.1);
+    summary.p50Ms = (float) stats.getPercentileMs (0.5);
+    summary.p90Ms = (float) stats.getPercentileMs (0.9);
+
+    const auto fullestBin = juce::jmax ((juce::int64) 1, *std::max_element (stats.histogram.begin(), stats.histogram.end()));
+
+    for (size_t i = 0; i < summary.heatmap.size(); ++i)
+        summary.heatmap[i] = (juce::uint8) ((stats.histogram[i] * 255 + fullestBin / 2) / fullestBin);
+
+    {
+        const juce::ScopedLock sl (statsLock);
+        summary.startTime = firstNoteTime;
+        summary.durationSeconds = (float) (lastNoteTime - firstNoteTime) / 1000.0f;
+    }
+
+    const juce::ScopedReadLock rl (notesLock);
+
+    if (notes.size() > 0)
+        summary.averageBpm = (float) (std::accumulate (notes.bpm.begin(), notes.bpm.end(), 0.0) / (double) notes.size());
+
+    // The most played note numbers become the lanes (e.g. kick, snare, hi-hat). Pedal
+    // crossings would count under their controller numbers, so they're left out, as
+    // the lanes' default filter leaves them out of the means.
+    std::array<juce::uint32, 128> noteCounts {};
+
+    for (size_t i = 0; i < notes.size(); ++i)
+        noteCounts[notes.note[i] & 127] += notes.isController[i] == 0 ? 1u : 0u;
+
+    std::array<int, 128> byCount;
+    std::iota (byCount.begin(), byCount.end(), 0);
+    std::stable_sort (byCount.begin(), byCount.end(), [&] (int a, int b) { return noteCounts[(size_t) a] > noteCounts[(size_t) b]; });
+
+    for (size_t i = 0; i < summary.lanes.size(); ++i)
+    {
+        const auto noteNumber = byCount[i];
+
+        if (noteCounts[(size_t) noteNumber] == 0)
+            break;
+
+        EventFilter filter;
+        filter.notes.reset();
+        filter.notes.set ((size_t) noteNumber);
+
+        auto& lane = summary.lanes[i];
+        lane.note = noteNumber;
+        lane.numNotes = noteCounts[(size_t) noteNumber];
+        lane.meanMs = (float) notes.query (filter).getMeanMs();
+    }
+
+    return summary;
+}
+
+//==============================================================================
+void SessionAnalyser::startReanalysis()
+{
+    // Called with statsLock held
+    if (currentReanalysis != nullptr)
+        currentReanalysis->cancelled = true;
+
+    auto reanalysis = std::make_shared<Reanalysis>();
+    reanalysis->grid = grid;
+
+    {
+        const juce::ScopedReadLock rl (notesLock);
+        reanalysis->numNotes = notes.size();
+    }
+
+    newNoteStatistics = {};
+
+    if (reanalysis->numNotes == 0)
+    {
+        currentReanalysis = nullptr;
+        statistics = {};
+        progress = 1.0;
+        return;
+    }
+
+    const auto numChunks = (int) ((reanalysis->numNotes + chunkSize - 1) / chunkSize);
+    reanalysis->partials.resize ((size_t) numChunks);
+    reanalysis->deviations.resize (reanalysis->numNotes);
+    reanalysis->numRemaining = numChunks;
+
+    currentReanalysis = reanalysis;
+    progress = 0.0;
+    numJobsInFlight += numChunks;
+
+    for (int i = 0; i < numChunks; ++i)
+        pool.addJob ([this, reanalysis, i] { runChunk (reanalysis, i); });
+}
+
+void SessionAnalyser::runChunk (std::shared_ptr<Reanalysis> reanalysis, int chunkIndex)
+{
+    POCKET_TRACE_SCOPE (*tracer, "re-analysis chunk");
+
+    if (! reanalysis->cancelled)
+    {
+        const juce::ScopedReadLock rl (notesLock);
+
+        // Check again now that clear() can no longer run underneath us
+        if (! reanalysis->cancelled)
+        {
+            const auto start = (size_t) chunkIndex * (size_t) chunkSize;
+            const auto end = juce::jmin (start + (size_t) chunkSize, reanalysis->numNotes, notes.size());
+            auto& partial = reanalysis->partials[(size_t) chunkIndex];
+
+            if (reanalysis->grid.inferred)
+            {
+                for (auto i = start; i < end; ++i)
+                {
+                    const auto deviation = notes.inferredDeviationMs[i];
+                    reanalysis->deviations[i] = deviation;
+                    partial.add (deviation);
+                }
+            }
+            else
+            {
+                for (auto i = start; i < end; ++i)
+                {
+                    const auto deviation = computeDeviationMs (notes.ppq[i], notes.bpm[i], reanalysis->grid);
+                    reanalysis->deviations[i] = (float) deviation;
+                    partial.add (deviation);
+                }
+            }
+        }
+    }
+
+    const auto numRemaining = --reanalysis->numRemaining;
+
+    if (! reanalysis->cancelled)
+    {
+        const auto newProgress = 1.0 - numRemaining / (double) reanalysis->partials.size();
+
+        if (numRemaining == 0)
+        {
+            SessionStatistics merged;
+
+            for (const auto& partial : reanalysis->partials)
+                merged.merge (partial);
+
+            const juce::ScopedLock sl (statsLock);
+
+            if (currentReanalysis == reanalysis)
+            {
+                {
+                    const juce::ScopedWriteLock wl (notesLock);
+                    std::copy (reanalysis->deviations.begin(), reanalysis->deviations.end(), notes.deviationMs.begin());
+
+                    // Notes decided while this ran may have been read before their decision
+                    if (reanalysis->grid.inferred)
+                        for (const auto& decision : lateDecisions)
+                            applyInferredDeviation ((size_t) decision.noteIndex, decision.deviationMs, merged);
+
+                    lateDecisions.clear();
+                }
+
+                merged.merge (newNoteStatistics);
+                statistics = merged;
+                newNoteStatistics = {};
+                currentReanalysis = nullptr;
+                ++notesVersion;
+            }
+        }
+
+        progress = newProgress;
+    }
+
+    --numJobsInFlight;
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class SessionAnalyserTests  : public juce::UnitTest
+{
+public:
+    SessionAnalyserTests()  : juce::UnitTest ("SessionAnalyser", "Pocket") {}
+
+    void runTest() override
+    {
+        beginTest ("A million notes are re-analysed quickly and exactly");
+        {
+            constexpr int numNotes = 1000000;
+
+            auto random = getRandom();
+            std::vector<TimingEvent> events ((size_t) numNotes);
+
+            for (int i = 0; i < numNotes; ++i)
+            {
+                auto& e = events[(size_t) i];
+                e.bpm = 80.0 + random.nextDouble() * 80.0;
+                e.ppq = i * 0.25 + (random.nextDouble() - 0.5) * 0.1;
+                e.note = (juce::uint8) (36 + random.nextInt (12));
+                e.velocity = (juce::uint8) random.nextInt (128);
+            }
+
+            AnalysisWorkerPool pool;
+            SessionAnalyser analyser (pool);
+
+            for (int i = 0; i < numNotes; i += AnalysisWorkerPool::drainBudget)
+                analyser.addEvents (events.data() + i, juce::jmin ((int) AnalysisWorkerPool::drainBudget, numNotes - i));
+
+            GridSettings grid;
+            grid.stepPpq = 0.25;
+            grid.swing = 0.6;
+            grid.latencyMs = 3.0;
+
+            const auto startMs = juce::Time::getMillisecondCounterHiRes();
+            analyser.setGrid (grid);
+
+            while (analyser.getProgress() < 1.0 && juce::Time::getMillisecondCounterHiRes() - startMs < 10000.0)
+                juce::Thread::yield();
+
+            const auto elapsedMs = juce::Time::getMillisecondCounterHiRes() - startMs;
+            logMessage (juce::String (numNotes) + " notes re-analysed on " + juce::String (pool.getNumThreads()) + " threads in "
+                        + juce::String (elapsedMs, 1) + " ms");
+
+            expectEquals (analyser.getProgress(), 1.0);
+
+            // Generous, so it holds in a debug build on a busy machine
+            expectLessThan (elapsedMs, 2000.0);
+
+            SessionStatistics expected, expectedStored;
+
+            for (const auto& e : events)
+            {
+                const auto deviation = computeDeviationMs (e.ppq, e.bpm, grid);
+                expected.add (deviation);
+                expectedStored.add ((float) deviation);
+            }
+
+            // The chunks are summed in a different order, so only the sums can differ, and barely
+            const auto statistics = analyser.getStatistics();
+            expectEquals (statistics.numNotes, expected.numNotes);
+            expectEquals (statistics.numEarly, expected.numEarly);
+            expectEquals (statistics.numLate, expected.numLate);
+            expect (statistics.histogram == expected.histogram);
+            expectWithinAbsoluteError (statistics.getMeanMs(), expected.getMeanMs(), 1.0e-6);
+            expectWithinAbsoluteError (statistics.getStandardDeviationMs(), expected.getStandardDeviationMs(), 1.0e-6);
+
+            // The stored deviations were replaced too, so queries see the new grid
+            // (they add up floats, so they get a looser tolerance)
+            const auto queried = analyser.query ({});
+            expectEquals (queried.numNotes, expectedStored.numNotes);
+            expectEquals (queried.numEarly, expectedStored.numEarly);
+            expectEquals (queried.numLate, expectedStored.numLate);
+            expectWithinAbsoluteError (queried.getMeanMs(), expectedStored.getMeanMs(), 1.0e-3);
+            expectWithinAbsoluteError (queried.getStandardDeviationMs(), expectedStored.getStandardDeviationMs(), 1.0e-3);
+        }
+
+        beginTest ("Pedal crossings stay out of the summary's note lanes");
+        {
+            // E4 (note 64) 10 ms late, and twice as many sustain presses (CC64) 40 ms early
+            std::vector<TimingEvent> events;
+
+            for (int i = 0; i < 30; ++i)
+            {
+                TimingEvent e;
+                e.bpm = 120.0;
+                e.note = 64;
+                e.velocity = 100;
+                e.isController = i % 3 != 0;
+                e.ppq = i + (e.isController ? -40.0 : 10.0) / 500.0;
+                events.push_back (e);
+            }
+
+            AnalysisWorkerPool pool;
+            SessionAnalyser analyser (pool);
+            analyser.addEvents (events.data(), (int) events.size());
+
+            const auto summary = analyser.createSummary();
+            expectEquals (summary.numNotes, (juce::int64) 30);
+            expectEquals (summary.lanes[0].note, 64);
+            expectEquals ((int) summary.lanes[0].numNotes, 10);
+            expectWithinAbsoluteError (summary.lanes[0].meanMs, 10.0f, 1.0e-3f);
+            expectEquals (summary.lanes[1].note, -1);
+        }
+
+        beginTest ("The Inferred grid measures each note against its own decided subdivision");
+        {
+            constexpr int numNotes = 10000;
+
+            auto random = getRandom();
+            std::vector<TimingEvent> events ((size_t) numNotes);
+
+            for (int i = 0; i < numNotes; ++i)
+            {
+                auto& e = events[(size_t) i];
+                e.bpm = 120.0;
+                e.ppq = i * 0.25 + (random.nextDouble() - 0.5) * 0.05;
+                e.sampleTime = i * 6000;
+            }
+
+            AnalysisWorkerPool pool;
+            SessionAnalyser analyser (pool);
+
+            GridSettings inferred;
+            inferred.inferred = true;
+
+            const auto waitForReanalysis = [&]
+            {
+                const auto startMs = juce::Time::getMillisecondCounterHiRes();
+
+                while (analyser.getProgress() < 1.0 && juce::Time::getMillisecondCounterHiRes() - startMs < 10000.0)
+                    juce::Thread::yield();
+            };
+
+            // The first half is decided before the grid changes, the second after
+            const auto half = numNotes / 2;
+            const auto firstIndex = analyser.addEvents (events.data(), half);
+            expectEquals (firstIndex, (juce::int64) 0);
+
+            GridSettings sixteenths;
+            sixteenths.stepPpq = 0.25;
+            std::vector<RhythmTranscriber::Decision> decisions ((size_t) numNotes);
+
+            for (int i = 0; i < numNotes; ++i)
+                decisions[(size_t) i] = { i, events[(size_t) i].sampleTime,
+                                          (float) computeDeviationMs (events[(size_t) i].ppq, 120.0, sixteenths) };
+
+            analyser.setInferredDeviations (decisions.data(), half);
+            analyser.setGrid (inferred);
+            waitForReanalysis();
+
+            expectEquals (analyser.addEvents (events.data() + half, numNotes - half), (juce::int64) half);
+            analyser.setInferredDeviations (decisions.data() + half, numNotes - half);
+
+            // A decision for a note that isn't stored is ignored
+            analyser.setInferredDeviations (decisions.data() + 1, 1);
+            RhythmTranscriber::Decision stale { 3, -1, 100.0f };
+            analyser.setInferredDeviations (&stale, 1);
+
+            SessionStatistics expected;
+
+            for (const auto& decision : decisions)
+                expected.add (decision.deviationMs);
+
+            const auto statistics = analyser.getStatistics();
+            expectEquals (statistics.numNotes, expected.numNotes);
+            expectEquals (statistics.numEarly, expected.numEarly);
+            expectEquals (statistics.numLate, expected.numLate);
+            expect (statistics.histogram == expected.histogram);
+            expectWithinAbsoluteError (statistics.getMeanMs(), expected.getMeanMs(), 1.0e-6);
+            expectWithinAbsoluteError (statistics.getStandardDeviationMs(), expected.getStandardDeviationMs(), 1.0e-6);
+
+            // Leaving the grid and coming back re-measures against the stored decisions
+            analyser.setGrid (sixteenths);
+            waitForReanalysis();
+            analyser.setGrid (inferred);
+            waitForReanalysis();
+
+            const auto reanalysed = analyser.getStatistics();
+            expectEquals (reanalysed.numNotes, expected.numNotes);
+            expect (reanalysed.histogram == expected.histogram);
+            expectWithinAbsoluteError (reanalysed.getMeanMs(), expected.getMeanMs(), 1.0e-6);
+        }
+    }
+};
+
+static SessionAnalyserTests sessionAnalyserTests;
+
+#endif
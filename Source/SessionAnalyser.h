@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    SessionAnalyser.h
+
+    Keeps the raw timing of every note in the session so that its statistics
+    can be recomputed whenever the grid, swing or latency offset changes.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TimingEvent.h"
+#include "TimingGrid.h"
+#include "AnalysisWorkerPool.h"
+#include "SessionStatistics.h"
+#include "ColumnarEventStore.h"
+#include "RhythmTranscriber.h"
+#include "ProgressDatabase.h"
+#include "TraceRecorder.h"
+
+//==============================================================================
+/**
+    Stores every note in a ColumnarEventStore and keeps SessionStatistics for them
+    up to date.
+
+    New notes are measured against the current grid as they arrive. When the grid
+    changes, the whole session is re-measured in parallel chunks on the shared
+    AnalysisWorkerPool while new notes keep arriving, and the store's deviation
+    column is replaced once every chunk has finished. A newer change simply
+    supersedes a re-analysis that is still running.
+
+    Every note also keeps its deviation from its inferred subdivision, which the
+    RhythmTranscriber decides a few notes later (until then, it's measured against
+    quarter notes). With the "Inferred" grid, those are the deviations measured,
+    so each decision re-measures just its own note.
+*/
+class SessionAnalyser
+{
+public:
+    explicit SessionAnalyser (AnalysisWorkerPool&);
+    ~SessionAnalyser();
+
+    /** Worker thread: stores new notes and adds them to the statistics.
+        Returns the session index of the first one, as RhythmTranscriber::process() takes.
+    */
+    juce::int64 addEvents (const TimingEvent* events, int numEvents);
+
+    /** Worker thread: stores the inferred deviations of notes the RhythmTranscriber has
+        decided. Decisions for notes that are no longer stored (after clear()) are ignored.
+    */
+    void setInferredDeviations (const RhythmTranscriber::Decision* decisions, int numDecisions);
+
+    /** Changes the grid; if it differs from the current one, the session is re-analysed. */
+    void setGrid (const GridSettings&);
+
+    /** Forgets every stored note, e.g. when the user starts a new session. Any thread. */
+    void clear();
+
+    SessionStatistics getStatistics() const;
+
+    /** Statistics for the stored notes that match the filter, computed on the calling thread. */
+    SessionStatistics query (const EventFilter& filter) const;
+
+    /** Message thread: runs query() for the filter on the worker pool, unless the
+        result for this filter and these notes is already known or a query is still
+        running. The notes count as changed when any are added, cleared or re-measured.
+    */
+    void requestQuery (const EventFilter& filter);
+
+    /** The result of the last query run by requestQuery(); lock-free. */
+    SessionStatistics getQueryResult() const;
+
+    /** Summarises the session so far for the progress database. Scans the stored
+        notes once per lane, so call it when the session ends rather than per frame.
+    */
+    SessionSummary createSummary() const;
+
+    /** Progress of the running re-analysis from 0 to 1 (1 when idle), for the
+        editor to poll; it's updated as each chunk completes.
+    */
+    double getProgress() const noexcept         { return progress.load(); }
+
+    static constexpr int chunkSize = 64 * 1024;
+
+private:
+    struct Reanalysis;
+
+    void startReanalysis();
+    void runChunk (std::shared_ptr<Reanalysis>, int chunkIndex);
+    void applyInferredDeviation (size_t noteIndex, float deviationMs, SessionStatistics& target);
+
+    AnalysisWorkerPool& pool;
+    juce::SharedResourcePointer<TraceRecorder> tracer;
+
+    juce::ReadWriteLock notesLock;
+    ColumnarEventStore notes;
+
+    juce::CriticalSection statsLock;
+    GridSettings grid;
+    SessionStatistics statistics;           // Everything measured against the current grid
+    SessionStatistics newNoteStatistics;    // Notes added while a re-analysis is running
+    std::shared_ptr<Reanalysis> currentReanalysis;
+    std::vector<RhythmTranscriber::Decision> lateDecisions;    // For notes a re-analysis may have read before they were decided
+    juce::int64 firstNoteTime = 0, lastNoteTime = 0;   // Wall-clock ms, for the summary
+
+    std::atomic<double> progress { 1.0 };
+    std::atomic<int> numJobsInFlight { 0 };
+
+    // Bumped whenever the stored notes or their deviations change
+    std::atomic<juce::uint32> notesVersion { 1 };
+
+    // requestQuery()'s state (message thread) and its published result
+    EventFilter queriedFilter;
+    juce::uint32 queriedVersion = 0;
+    std::atomic<bool> queryRunning { false };
+    std::shared_ptr<const SessionStatistics> queryResult;   // Only read and written with std::atomic_load/store
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SessionAnalyser)
+};
@@ -0,0 +1,196 @@
+/*
+  ==============================================================================
+
+    SessionLogFormat.h
+
+    On-disk layout of recorded session logs (.pocketlog).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TimingEvent.h"
+
+//==============================================================================
+/**
+    A session log is a fixed 32-byte header followed by fixed-size, little-endian
+    event records, appended in the order the notes were played:
+
+        header:  "PKTL"  uint32 version  float64 sampleRate  16 reserved bytes
+        record:  int64 sampleTime  float64 ppq  float64 bpm  float64 deviationMs
+                 int32 bar  uint8 note  uint8 velocity  uint8 channel  uint8 flags
+
+    Bit 0 of flags marks a controller crossing rather than a note (logs written
+    before it existed always have 0 there).
+
+    Fixed-size records mean any event can be located by index without scanning.
+
+    When a recording is stopped cleanly, a sparse index block and a footer are
+    appended after the last record:
+
+        entry:   int64 firstRecord  int64 sampleTime  float64 sumDeviationMs
+                 float32 minDeviationMs  float32 maxDeviationMs  int32 bar  int32 numRecords
+        footer:  "PKTI"  uint32 numEntries  int64 numRecords  16 reserved bytes
+
+    A new index entry starts whenever the bar changes or the current entry already
+    covers indexStride records. Logs without a footer (e.g. after a crash) are still
+    readable; the reader rebuilds the index with the same IndexBuilder.
+*/
+namespace SessionLogFormat
+{
+    static constexpr const char* fileExtension = ".pocketlog";
+    static constexpr juce::uint32 version = 1;
+
+    static constexpr int headerSize = 32;
+    static constexpr int recordSize = 40;
+    static constexpr int indexEntrySize = 40;
+    static constexpr int footerSize = 32;
+    static constexpr int indexStride = 1024;
+
+    inline void writeHeader (void* dest, double sampleRate) noexcept
+    {
+        auto* d = static_cast<char*> (dest);
+        juce::zeromem (d, headerSize);
+        std::memcpy (d, "PKTL", 4);
+        juce::writeUnaligned (d + 4, juce::ByteOrder::swapIfBigEndian (version));
+        juce::writeUnaligned (d + 8, juce::ByteOrder::swapIfBigEndian (sampleRate));
+    }
+
+    inline bool readHeader (const void* src, double& sampleRate) noexcept
+    {
+        auto* s = static_cast<const char*> (src);
+
+        if (std::memcmp (s, "PKTL", 4) != 0 || juce::ByteOrder::littleEndianInt (s + 4) != version)
+            return false;
+
+        sampleRate = juce::ByteOrder::swapIfBigEndian (juce::readUnaligned<double> (s + 8));
+        return true;
+    }
+
+    inline void writeRecord (void* dest, const TimingEvent& e) noexcept
+    {
+        auto* d = static_cast<char*> (dest);
+        juce::writeUnaligned (d,      juce::ByteOrder::swapIfBigEndian ((juce::uint64) e.sampleTime));
+        juce::writeUnaligned (d + 8,  juce::ByteOrder::swapIfBigEndian (e.ppq));
+        juce::writeUnaligned (d + 16, juce::ByteOrder::swapIfBigEndian (e.bpm));
+        juce::writeUnaligned (d + 24, juce::ByteOrder::swapIfBigEndian (e.deviationMs));
+        juce::writeUnaligned (d + 32, juce::ByteOrder::swapIfBigEndian ((juce::uint32) e.bar));
+        d[36] = (char) e.note;
+        d[37] = (char) e.velocity;
+        d[38] = (char) e.channel;
+        d[39] = (char) (e.isController ? 1 : 0);
+    }
+
+    inline TimingEvent readRecord (const void* src) noexcept
+    {
+        auto* s = static_cast<const char*> (src);
+        TimingEvent e;
+        e.sampleTime  = (juce::int64) juce::ByteOrder::swapIfBigEndian (juce::readUnaligned<juce::uint64> (s));
+        e.ppq         = juce::ByteOrder::swapIfBigEndian (juce::readUnaligned<double> (s + 8));
+        e.bpm         = juce::ByteOrder::swapIfBigEndian (juce::readUnaligned<double> (s + 16));
+        e.deviationMs = juce::ByteOrder::swapIfBigEndian (juce::readUnaligned<double> (s + 24));
+        e.bar         = (int) juce::ByteOrder::swapIfBigEndian (juce::readUnaligned<juce::uint32> (s + 32));
+        e.note        = (juce::uint8) s[36];
+        e.velocity    = (juce::uint8) s[37];
+        e.channel     = (juce::uint8) s[38];
+        e.isController = (s[39] & 1) != 0;
+        return e;
+    }
+
+    //==============================================================================
+    /** Summary of a contiguous run of records, used for seeking and zoomed-out drawing. */
+    struct IndexEntry
+    {
+        juce::int64 firstRecord = 0;
+        juce::int64 sampleTime = 0;     // Sample time of the first record
+        double sumDeviationMs = 0.0;
+        float minDeviationMs = 0.0f;
+        float maxDeviationMs = 0.0f;
+        int bar = 0;
+        int numRecords = 0;
+    };
+
+    inline void writeIndexEntry (void* dest, const IndexEntry& entry) noexcept
+    {
+        auto* d = static_cast<char*> (dest);
+        juce::writeUnaligned (d,      juce::ByteOrder::swapIfBigEndian ((juce::uint64) entry.firstRecord));
+        juce::writeUnaligned (d + 8,  juce::ByteOrder::swapIfBigEndian ((juce::uint64) entry.sampleTime));
+        juce::writeUnaligned (d + 16, juce::ByteOrder::swapIfBigEndian (entry.sumDeviationMs));
+        juce::writeUnaligned (d + 24, juce::ByteOrder::swapIfBigEndian (entry.minDeviationMs));
+        juce::writeUnaligned (d + 28, juce::ByteOrder::swapIfBigEndian (entry.maxDeviationMs));
+        juce::writeUnaligned (d + 32, juce::ByteOrder::swapIfBigEndian ((juce::uint32) entry.bar));
+        juce::writeUnaligned (d + 36, juce::ByteOrder::swapIfBigEndian ((juce::uint32) entry.numRecords));
+    }
+
+    inline IndexEntry readIndexEntry (const void* src) noexcept
+    {
+        auto* s = static_cast<const char*> (src);
+        IndexEntry entry;
+        entry.firstRecord    = (juce::int64) juce::ByteOrder::swapIfBigEndian (juce::readUnaligned<juce::uint64> (s));
+        entry.sampleTime     = (juce::int64) juce::ByteOrder::swapIfBigEndian (juce::readUnaligned<juce::uint64> (s + 8));
+        entry.sumDeviationMs = juce::ByteOrder::swapIfBigEndian (juce::readUnaligned<double> (s + 16));
+        entry.minDeviationMs = juce::ByteOrder::swapIfBigEndian (juce::readUnaligned<float> (s + 24));
+        entry.maxDeviationMs = juce::ByteOrder::swapIfBigEndian (juce::readUnaligned<float> (s + 28));
+        entry.bar            = (int) juce::ByteOrder::swapIfBigEndian (juce::readUnaligned<juce::uint32> (s + 32));
+        entry.numRecords     = (int) juce::ByteOrder::swapIfBigEndian (juce::readUnaligned<juce::uint32> (s + 36));
+        return entry;
+    }
+
+    inline void writeFooter (void* dest, juce::uint32 numEntries, juce::int64 numRecords) noexcept
+    {
+        auto* d = static_cast<char*> (dest);
+        juce::zeromem (d, footerSize);
+        std::memcpy (d, "PKTI", 4);
+        juce::writeUnaligned (d + 4, juce::ByteOrder::swapIfBigEndian (numEntries));
+        juce::writeUnaligned (d + 8, juce::ByteOrder::swapIfBigEndian ((juce::uint64) numRecords));
+    }
+
+    inline bool readFooter (const void* src, juce::uint32& numEntries, juce::int64& numRecords) noexcept
+    {
+        auto* s = static_cast<const char*> (src);
+
+        if (std::memcmp (s, "PKTI", 4) != 0)
+            return false;
+
+        numEntries = juce::ByteOrder::littleEndianInt (s + 4);
+        numRecords = (juce::int64) juce::ByteOrder::littleEndianInt64 (s + 8);
+        return true;
+    }
+
+    //==============================================================================
+    /** Builds the sparse index incrementally, one record at a time. */
+    class IndexBuilder
+    {
+    public:
+        void add (const TimingEvent& e)
+        {
+            if (entries.empty() || entries.back().bar != e.bar || entries.back().numRecords >= indexStride)
+            {
+                IndexEntry entry;
+                entry.firstRecord = numRecords;
+                entry.sampleTime = e.sampleTime;
+                entry.minDeviationMs = entry.maxDeviationMs = (float) e.deviationMs;
+                entry.bar = e.bar;
+                entries.push_back (entry);
+            }
+
+            auto& entry = entries.back();
+            entry.sumDeviationMs += e.deviationMs;
+            entry.minDeviationMs = juce::jmin (entry.minDeviationMs, (float) e.deviationMs);
+            entry.maxDeviationMs = juce::jmax (entry.maxDeviationMs, (float) e.deviationMs);
+            ++entry.numRecords;
+            ++numRecords;
+        }
+
+        void clear()
+        {
+            entries.clear();
+            numRecords = 0;
+        }
+
+        std::vector<IndexEntry> entries;
+        juce::int64 numRecords = 0;
+    };
+}
@@ -0,0 +1,166 @@
+/*
+  ==============================================================================
+
+    SessionLogReader.cpp
+
+  ==============================================================================
+*/
+
+#include "SessionLogReader.h"
+
+//==============================================================================
+bool SessionLogReader::open (const juce::File& file)
+{
+    mappedFile.reset();
+    index.clear();
+    numEvents = 0;
+
+    auto mapped = std::make_unique<juce::MemoryMappedFile> (file, juce::MemoryMappedFile::readOnly);
+    auto* data = static_cast<const char*> (mapped->getData());
+    const auto size = (juce::int64) mapped->getSize();
+
+    if (data == nullptr || size < SessionLogFormat::headerSize
+         || ! SessionLogFormat::readHeader (data, sampleRate))
+        return false;
+
+    mappedFile = std::move (mapped);
+
+    // Use the index block if the recording was closed cleanly...
+    juce::uint32 numEntries = 0;
+    juce::int64 numRecords = 0;
+
+    if (size >= SessionLogFormat::headerSize + SessionLogFormat::footerSize
+         && SessionLogFormat::readFooter (data + size - SessionLogFormat::footerSize, numEntries, numRecords)
+         && size == SessionLogFormat::headerSize
+                      + numRecords * SessionLogFormat::recordSize
+                      + (juce::int64) numEntries * SessionLogFormat::indexEntrySize
+                      + SessionLogFormat::footerSize)
+    {
+        numEvents = numRecords;
+        index.reserve (numEntries);
+
+        auto* entryData = data + SessionLogFormat::headerSize + numRecords * SessionLogFormat::recordSize;
+
+        for (juce::uint32 i = 0; i < numEntries; ++i)
+            index.push_back (SessionLogFormat::readIndexEntry (entryData + (size_t) i * SessionLogFormat::indexEntrySize));
+    }
+    else
+    {
+        // ...otherwise treat everything after the header as records (ignoring a torn
+        // final record) and rebuild the index in one pass.
+        numEvents = (size - SessionLogFormat::headerSize) / SessionLogFormat::recordSize;
+
+        SessionLogFormat::IndexBuilder builder;
+
+        for (juce::int64 i = 0; i < numEvents; ++i)
+            builder.add (getEvent (i));
+
+        index = std::move (builder.entries);
+    }
+
+    return true;
+}
+
+//==============================================================================
+const char* SessionLogReader::getRecordData (juce::int64 i) const noexcept
+{
+    jassert (juce::isPositiveAndBelow (i, numEvents));
+    return static_cast<const char*> (mappedFile->getData()) + SessionLogFormat::headerSize
+             + i * SessionLogFormat::recordSize;
+}
+
+TimingEvent SessionLogReader::getEvent (juce::int64 i) const noexcept
+{
+    return SessionLogFormat::readRecord (getRecordData (i));
+}
+
+juce::int64 SessionLogReader::getStartTime() const noexcept
+{
+    return numEvents > 0 ? getEvent (0).sampleTime : 0;
+}
+
+juce::int64 SessionLogReader::getEndTime() const noexcept
+{
+    return numEvents > 0 ? getEvent (numEvents - 1).sampleTime : 0;
+}
+
+int SessionLogReader::findEntryForRecord (juce::int64 i) const noexcept
+{
+    auto it = std::upper_bound (index.begin(), index.end(), i,
+                                [] (juce::int64 record, const auto& entry) { return record < entry.firstRecord; });
+
+    return juce::jmax (0, (int) std::distance (index.begin(), it) - 1);
+}
+
+juce::int64 SessionLogReader::findFirstEventAtTime (juce::int64 sampleTime) const noexcept
+{
+    if (index.empty())
+        return numEvents;
+
+    // Last entry starting at or before the requested time...
+    auto it = std::upper_bound (index.begin(), index.end(), sampleTime,
+                                [] (juce::int64 t, const auto& entry) { return t < entry.sampleTime; });
+
+    if (it == index.begin())
+        return 0;
+
+    // ...then a short scan inside it
+    const auto& entry = *std::prev (it);
+    const auto end = entry.firstRecord + entry.numRecords;
+
+    for (auto i = entry.firstRecord; i < end; ++i)
+        if (getEvent (i).sampleTime >= sampleTime)
+            return i;
+
+    return end;
+}
+
+juce::int64 SessionLogReader::findFirstEventInBar (int bar) const noexcept
+{
+    for (const auto& entry : index)
+        if (entry.bar == bar)
+            return entry.firstRecord;
+
+    return -1;
+}
+
+//==============================================================================
+SessionLogReader::Summary SessionLogReader::summarise (juce::int64 startIndex, juce::int64 endIndex) const noexcept
+{
+    Summary summary;
+    startIndex = juce::jmax ((juce::int64) 0, startIndex);
+    endIndex = juce::jmin (numEvents, endIndex);
+
+    const auto add = [&summary] (float minMs, float maxMs, double sumMs, juce::int64 count)
+    {
+        summary.minDeviationMs = summary.numEvents == 0 ? minMs : juce::jmin (summary.minDeviationMs, minMs);
+        summary.maxDeviationMs = summary.numEvents == 0 ? maxMs : juce::jmax (summary.maxDeviationMs, maxMs);
+        summary.sumDeviationMs += sumMs;
+        summary.numEvents += count;
+    };
+
+    auto i = startIndex;
+
+    for (auto e = (size_t) findEntryForRecord (startIndex); i < endIndex && e < index.size(); ++e)
+    {
+        const auto& entry = index[e];
+        const auto entryEnd = juce::jmin (endIndex, entry.firstRecord + entry.numRecords);
+
+        if (i == entry.firstRecord && entryEnd == entry.firstRecord + entry.numRecords)
+        {
+            add (entry.minDeviationMs, entry.maxDeviationMs, entry.sumDeviationMs, entry.numRecords);
+        }
+        else
+        {
+            for (; i < entryEnd; ++i)
+            {
+                const auto ms = getEvent (i).deviationMs;
+                add ((float) ms, (float) ms, ms, 1);
+            }
+        }
+
+        i = entryEnd;
+    }
+
+    return summary;
+}
@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    SessionLogReader.h
+
+    Random access to recorded session logs through a memory-mapped file.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SessionLogFormat.h"
+
+//==============================================================================
+/**
+    Opens a .pocketlog written by SessionRecorder without reading it into memory.
+
+    Events are decoded straight from the mapped file on demand, and seeking by bar
+    or by time goes through the sparse index (read from the log's footer, or rebuilt
+    with one pass if the recording wasn't closed cleanly), so it costs a binary search
+    over the index plus at most SessionLogFormat::indexStride record reads.
+*/
+class SessionLogReader
+{
+public:
+    SessionLogReader() = default;
+
+    /** Maps the file. Returns false if it isn't a readable session log. */
+    bool open (const juce::File& file);
+
+    bool isOpen() const noexcept                            { return mappedFile != nullptr; }
+    double getSampleRate() const noexcept                   { return sampleRate; }
+    juce::int64 getNumEvents() const noexcept               { return numEvents; }
+
+    /** Decodes a single event; index must be in the range [0, getNumEvents()). */
+    TimingEvent getEvent (juce::int64 index) const noexcept;
+
+    /** Returns the index of the first event at or after sampleTime (getNumEvents() if none). */
+    juce::int64 findFirstEventAtTime (juce::int64 sampleTime) const noexcept;
+
+    /** Returns the index of the first event in the given bar, or -1 if the bar wasn't played. */
+    juce::int64 findFirstEventInBar (int bar) const noexcept;
+
+    juce::int64 getStartTime() const noexcept;
+    juce::int64 getEndTime() const noexcept;
+
+    //==============================================================================
+    struct Summary
+    {
+        float minDeviationMs = 0.0f;
+        float maxDeviationMs = 0.0f;
+        double sumDeviationMs = 0.0;
+        juce::int64 numEvents = 0;
+    };
+
+    /** Summarises events [startIndex, endIndex). Whole index entries inside the range
+        are taken from the index, so the cost doesn't grow with the number of events.
+    */
+    Summary summarise (juce::int64 startIndex, juce::int64 endIndex) const noexcept;
+
+private:
+    const char* getRecordData (juce::int64 index) const noexcept;
+    int findEntryForRecord (juce::int64 index) const noexcept;
+
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    double sampleRate = 0.0;
+    juce::int64 numEvents = 0;
+    std::vector<SessionLogFormat::IndexEntry> index;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SessionLogReader)
+};
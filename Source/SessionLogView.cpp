@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    SessionLogView.cpp
+
+  ==============================================================================
+*/
+
+#include "SessionLogView.h"
+
+//==============================================================================
+bool SessionLogView::openLog (const juce::File& file)
+{
+    const auto opened = reader.open (file);
+    showWholeLog();
+    return opened;
+}
+
+void SessionLogView::showWholeLog()
+{
+    setVisibleRange ((double) reader.getStartTime(), (double) reader.getEndTime() + 1.0);
+}
+
+bool SessionLogView::showBar (int bar)
+{
+    const auto first = reader.findFirstEventInBar (bar);
+
+    if (first < 0)
+        return false;
+
+    // Show from the bar's first note up to the next bar's first note (or two seconds)
+    const auto start = (double) reader.getEvent (first).sampleTime;
+    const auto next = reader.findFirstEventInBar (bar + 1);
+    const auto end = next > first ? (double) reader.getEvent (next).sampleTime
+                                  : start + 2.0 * reader.getSampleRate();
+
+    const auto margin = (end - start) * 0.05;
+    setVisibleRange (start - margin, end + margin);
+    return true;
+}
+
+void SessionLogView::setVisibleRange (double start, double end)
+{
+    viewStart = start;
+    viewEnd = juce::jmax (start + 1.0, end);
+    repaint();
+}
+
+double SessionLogView::xToTime (float x) const noexcept
+{
+    return viewStart + (viewEnd - viewStart) * x / juce::jmax (1, getWidth());
+}
+
+//==============================================================================
+void SessionLogView::paint (juce::Graphics& g)
+{
+    POCKET_TRACE_SCOPE (*tracer, "log view paint");
+    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId).darker (0.2f));
+
+    if (! reader.isOpen() || reader.getNumEvents() == 0)
+    {
+        g.setColour (juce::Colours::grey);
+        g.drawText ("No session log open", getLocalBounds(), juce::Justification::centred);
+        return;
+    }
+
+    const auto height = (float) getHeight();
+    const auto msToY = [height] (float ms) { return height * 0.5f * (1.0f - ms / rangeMs); };
+
+    g.setColour (juce::Colours::grey.withAlpha (0.5f));
+    g.drawHorizontalLine (getHeight() / 2, 0.0f, (float) getWidth());
+
+    auto columnStart = reader.findFirstEventAtTime ((juce::int64) std::ceil (xToTime (0.0f)));
+
+    for (int x = 0; x < getWidth(); ++x)
+    {
+        const auto columnEnd = reader.findFirstEventAtTime ((juce::int64) std::ceil (xToTime ((float) (x + 1))));
+        const auto summary = reader.summarise (columnStart, columnEnd);
+        columnStart = columnEnd;
+
+        if (summary.numEvents == 0)
+            continue;
+
+        const auto meanMs = (float) (summary.sumDeviationMs / (double) summary.numEvents);
+
+        g.setColour (juce::Colours::lightblue.withAlpha (0.6f));
+        g.drawVerticalLine (x, msToY (summary.maxDeviationMs), msToY (summary.minDeviationMs) + 1.0f);
+
+        g.setColour (meanMs < 0.0f ? juce::Colours::orange : juce::Colours::lightgreen);
+        g.fillRect ((float) x, msToY (meanMs) - 1.0f, 1.0f, 2.0f);
+    }
+
+    g.setColour (juce::Colours::grey);
+    g.setFont (11.0f);
+    g.drawText (juce::String (reader.getNumEvents()) + " notes, +/- " + juce::String ((int) rangeMs) + " ms",
+                getLocalBounds().reduced (4, 2), juce::Justification::topLeft);
+}
+
+//==============================================================================
+void SessionLogView::mouseDown (const juce::MouseEvent&)
+{
+    dragStartViewStart = viewStart;
+}
+
+void SessionLogView::mouseDrag (const juce::MouseEvent& e)
+{
+    const auto length = viewEnd - viewStart;
+    const auto start = dragStartViewStart - length * e.getDistanceFromDragStartX() / juce::jmax (1, getWidth());
+    setVisibleRange (start, start + length);
+}
+
+void SessionLogView::mouseDoubleClick (const juce::MouseEvent&)
+{
+    showWholeLog();
+}
+
+void SessionLogView::mouseWheelMove (const juce::MouseEvent& e, const juce::MouseWheelDetails& wheel)
+{
+    const auto anchor = xToTime (e.position.x);
+    const auto scale = std::pow (2.0, -wheel.deltaY * 2.0);
+
+    setVisibleRange (anchor - (anchor - viewStart) * scale,
+                     anchor + (viewEnd - anchor) * scale);
+}
@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    SessionLogView.h
+
+    Zoomable timeline of a recorded session log.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SessionLogReader.h"
+#include "TraceRecorder.h"
+
+//==============================================================================
+/**
+    Draws the deviation of every note in a session log over time: one vertical
+    min/max bar per pixel column plus a dot at the column's mean.
+
+    Each column is drawn from SessionLogReader::summarise(), so repainting costs
+    roughly the same whether the view shows one bar or the whole session. Use the
+    mouse wheel to zoom around the cursor, drag to scroll, and double-click to
+    show the whole log again.
+*/
+class SessionLogView  : public juce::Component
+{
+public:
+    SessionLogView() = default;
+
+    /** Opens a log for display. Returns false if it couldn't be read. */
+    bool openLog (const juce::File& file);
+
+    /** Scrolls and zooms to show the given bar. Returns false if the bar isn't in the log. */
+    bool showBar (int bar);
+
+    void showWholeLog();
+
+    const SessionLogReader& getReader() const noexcept { return reader; }
+
+    //==============================================================================
+    void paint (juce::Graphics&) override;
+    void mouseDown (const juce::MouseEvent&) override;
+    void mouseDrag (const juce::MouseEvent&) override;
+    void mouseDoubleClick (const juce::MouseEvent&) override;
+    void mouseWheelMove (const juce::MouseEvent&, const juce::MouseWheelDetails&) override;
+
+private:
+    void setVisibleRange (double start, double end);
+    double xToTime (float x) const noexcept;
+
+    SessionLogReader reader;
+    juce::SharedResourcePointer<TraceRecorder> tracer;
+    double viewStart = 0.0, viewEnd = 1.0;  // Visible range in samples
+    double dragStartViewStart = 0.0;
+
+    static constexpr float rangeMs = 50.0f; // Deviation shown at the top and bottom edges
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SessionLogView)
+};
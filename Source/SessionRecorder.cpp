@@ -0,0 +1,139 @@
+/*
+  ==============================================================================
+
+    SessionRecorder.cpp
+
+  ==============================================================================
+*/
+
+#include "SessionRecorder.h"
+
+//==============================================================================
+SessionRecorder::~SessionRecorder()
+{
+    stop();
+}
+
+bool SessionRecorder::start (const juce::File& newFile, double sampleRate)
+{
+    stop();
+
+    if (! newFile.getParentDirectory().createDirectory())
+        return false;
+
+    newFile.deleteFile();
+
+    // A large buffer keeps the number of actual disk writes low during long sessions
+    auto newStream = std::make_unique<juce::FileOutputStream> (newFile, 64 * 1024);
+
+    if (newStream->failedToOpen())
+        return false;
+
+    char header[SessionLogFormat::headerSize];
+    SessionLogFormat::writeHeader (header, sampleRate);
+
+    if (! newStream->write (header, sizeof (header)))
+        return false;
+
+    const juce::ScopedLock sl (lock);
+    stream = std::move (newStream);
+    file = newFile;
+    error.clear();
+    index.clear();
+    numEventsWritten = 0;
+    recording = true;
+    return true;
+}
+
+void SessionRecorder::stop()
+{
+    const juce::ScopedLock sl (lock);
+    recording = false;
+
+    if (stream == nullptr)
+        return;
+
+    char entry[SessionLogFormat::indexEntrySize];
+
+    for (const auto& e : index.entries)
+    {
+        SessionLogFormat::writeIndexEntry (entry, e);
+
+        if (! stream->write (entry, sizeof (entry)))
+            return fail();
+    }
+
+    char footer[SessionLogFormat::footerSize];
+    SessionLogFormat::writeFooter (footer, (juce::uint32) index.entries.size(), index.numRecords);
+
+    if (! stream->write (footer, sizeof (footer)))
+        return fail();
+
+    stream->flush();
+
+    if (stream->getStatus().failed())
+        return fail();
+
+    stream.reset();
+    index.clear();
+}
+
+void SessionRecorder::fail()
+{
+    // Called with the lock held. Whatever reached the disk is still a readable log without a footer.
+    const auto message = stream->getStatus().getErrorMessage();
+    error = "Couldn't write " + file.getFileName() + (message.isNotEmpty() ? ": " + message : juce::String());
+
+    recording = false;
+    stream.reset();
+    index.clear();
+}
+
+juce::String SessionRecorder::getError() const
+{
+    const juce::ScopedLock sl (lock);
+    return error;
+}
+
+juce::File SessionRecorder::getFile() const
+{
+    const juce::ScopedLock sl (lock);
+    return file;
+}
+
+void SessionRecorder::write (const TimingEvent* events, int numEvents)
+{
+    if (! recording.load())
+        return;
+
+    const juce::ScopedLock sl (lock);
+
+    if (stream == nullptr)
+        return;
+
+    char record[SessionLogFormat::recordSize];
+
+    for (int i = 0; i < numEvents; ++i)
+    {
+        SessionLogFormat::writeRecord (record, events[i]);
+
+        if (! stream->write (record, sizeof (record)))
+        {
+            numEventsWritten += i;
+            return fail();
+        }
+
+        index.add (events[i]);
+    }
+
+    numEventsWritten += numEvents;
+}
+
+juce::File SessionRecorder::createDefaultFile()
+{
+    const auto name = "Session " + juce::Time::getCurrentTime().formatted ("%Y-%m-%d %H-%M-%S");
+
+    return juce::File::getSpecialLocation (juce::File::userDocumentsDirectory)
+               .getChildFile ("Pocket Sessions")
+               .getNonexistentChildFile (name, SessionLogFormat::fileExtension, false);
+}
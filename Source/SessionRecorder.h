@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    SessionRecorder.h
+
+    Streams every analysed note event to an append-only session log on disk.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SessionLogFormat.h"
+
+//==============================================================================
+/**
+    Writes TimingEvents to a .pocketlog file (see SessionLogFormat).
+
+    start() and stop() are called from the message thread, write() from the shared
+    analysis workers. The audio thread never calls into the recorder: events reach
+    it through the processor's TimingEventFifo, so a slow disk can only ever cause
+    that FIFO to overflow (and the processor to count dropped events), never block
+    the audio callback.
+
+    If the disk refuses a write (it's full, or was unplugged), recording stops and
+    getError() says why; the records already written stay readable.
+*/
+class SessionRecorder
+{
+public:
+    SessionRecorder() = default;
+    ~SessionRecorder();
+
+    /** Opens a new log, replacing any existing file. Returns false if it couldn't be created. */
+    bool start (const juce::File& file, double sampleRate);
+
+    /** Appends the sparse seek index and closes the log. */
+    void stop();
+
+    /** Why the last recording stopped by itself or failed to close, or an empty string. Cleared by start(). */
+    juce::String getError() const;
+
+    bool isRecording() const noexcept               { return recording.load(); }
+    juce::File getFile() const;
+
+    /** Number of events written since start() was called. */
+    juce::int64 getNumEventsWritten() const noexcept    { return numEventsWritten.load(); }
+
+    /** Worker thread: appends a batch of events, if a log is open. */
+    void write (const TimingEvent* events, int numEvents);
+
+    /** Returns a fresh file name in the default sessions folder. */
+    static juce::File createDefaultFile();
+
+private:
+    void fail();
+
+    juce::CriticalSection lock;
+    std::unique_ptr<juce::FileOutputStream> stream;
+    juce::File file;
+    juce::String error;
+    SessionLogFormat::IndexBuilder index;
+
+    std::atomic<bool> recording { false };
+    std::atomic<juce::int64> numEventsWritten { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SessionRecorder)
+};
@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    SessionStatistics.cpp
+
+  ==============================================================================
+*/
+
+#include "SessionStatistics.h"
+
+//==============================================================================
+void SessionStatistics::add (double deviationMs) noexcept
+{
+    ++numNotes;
+    sumMs += deviationMs;
+    sumSquaresMs += deviationMs * deviationMs;
+
+    if (deviationMs < 0.0)
+        ++numEarly;
+    else if (deviationMs > 0.0)
+        ++numLate;
+
+    ++histogram[(size_t) getHistogramBin (deviationMs)];
+}
+
+void SessionStatistics::remove (double deviationMs) noexcept
+{
+    --numNotes;
+    sumMs -= deviationMs;
+    sumSquaresMs -= deviationMs * deviationMs;
+
+    if (deviationMs < 0.0)
+        --numEarly;
+    else if (deviationMs > 0.0)
+        --numLate;
+
+    --histogram[(size_t) getHistogramBin (deviationMs)];
+}
+
+void SessionStatistics::merge (const SessionStatistics& other) noexcept
+{
+    numNotes += other.numNotes;
+    numEarly += other.numEarly;
+    numLate += other.numLate;
+    sumMs += other.sumMs;
+    sumSquaresMs += other.sumSquaresMs;
+
+    for (size_t i = 0; i < histogram.size(); ++i)
+        histogram[i] += other.histogram[i];
+}
+
+double SessionStatistics::getMeanMs() const noexcept
+{
+    return numNotes > 0 ? sumMs / (double) numNotes : 0.0;
+}
+
+double SessionStatistics::getStandardDeviationMs() const noexcept
+{
+    if (numNotes < 2)
+        return 0.0;
+
+    const auto mean = getMeanMs();
+    return std::sqrt (juce::jmax (0.0, sumSquaresMs / (double) numNotes - mean * mean));
+}
+
+double SessionStatistics::getPercentileMs (double fraction) const noexcept
+{
+    const auto total = std::accumulate (histogram.begin(), histogram.end(), (juce::int64) 0);
+
+    if (total == 0)
+        return 0.0;
+
+    const auto binWidthMs = 2.0 * histogramRangeMs / numHistogramBins;
+    const auto target = juce::jlimit (0.0, 1.0, fraction) * (double) total;
+    double below = 0.0;
+
+    for (int bin = 0; bin < numHistogramBins; ++bin)
+    {
+        const auto count = (double) histogram[(size_t) bin];
+
+        if (count > 0.0 && below + count >= target)
+            return -histogramRangeMs + binWidthMs * (bin + (target - below) / count);
+
+        below += count;
+    }
+
+    return histogramRangeMs;
+}
@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+
+    SessionStatistics.h
+
+    Mergeable summary statistics over a set of note deviations.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <numeric>
+
+//==============================================================================
+/** Summary of a set of deviations. Partial results can be merged. */
+struct SessionStatistics
+{
+    static constexpr int numHistogramBins = 50;
+    static constexpr double histogramRangeMs = 50.0;    // Bins cover -50 ms to +50 ms
+
+    juce::int64 numNotes = 0;
+    juce::int64 numEarly = 0;
+    juce::int64 numLate = 0;
+    double sumMs = 0.0;
+    double sumSquaresMs = 0.0;
+    std::array<juce::int64, numHistogramBins> histogram {};
+
+    void add (double deviationMs) noexcept;
+    void remove (double deviationMs) noexcept;      // Undoes an add() of the same value
+    void merge (const SessionStatistics& other) noexcept;
+
+    double getMeanMs() const noexcept;
+    double getStandardDeviationMs() const noexcept;
+
+    /** Estimates a percentile (fraction 0 to 1) from the histogram, interpolating
+        within the bin it falls in. Outliers are clamped to the histogram's range.
+    */
+    double getPercentileMs (double fraction) const noexcept;
+
+    static int getHistogramBin (double deviationMs) noexcept
+    {
+        const auto bin = (int) std::floor ((deviationMs + histogramRangeMs) * numHistogramBins / (2.0 * histogramRangeMs));
+        return juce::jlimit (0, numHistogramBins - 1, bin);
+    }
+};
@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    TimingEvent.h
+
+    A single analysed note event, and the lock-free FIFO the audio thread
+    uses to hand those events to the rest of the plugin.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+//==============================================================================
+/** One note-on (or controller crossing) as seen by the timing engine. */
+struct TimingEvent
+{
+    juce::int64 sampleTime = 0; // Processor sample clock at the note
+    double ppq = 0.0;           // Host position of the note, in quarter notes
+    double bpm = 0.0;           // Tempo at the time of the note
+    double deviationMs = 0.0;   // Distance to the nearest grid point (negative = early)
+    int bar = 0;                // Bar index derived from the host time signature
+    juce::uint16 take = 0;      // Incremented each time the transport starts, so the first take is 1
+    juce::uint8 note = 0;
+    juce::uint8 velocity = 0;
+    juce::uint8 channel = 0;
+    bool isController = false;  // A pedal crossing: note holds the controller number, velocity its value
+};
+
+//==============================================================================
+/**
+    Single-producer, single-consumer queue of events from the audio thread.
+
+    push() is called from the audio thread and never blocks or allocates; if the
+    consumer falls behind, new events are dropped rather than waiting for space.
+*/
+template <typename EventType, int fifoCapacity>
+class EventFifo
+{
+public:
+    EventFifo() = default;
+
+    /** Audio thread: returns false if the FIFO was full and the event was dropped. */
+    bool push (const EventType& event) noexcept
+    {
+        const auto scope = fifo.write (1);
+
+        if (scope.blockSize1 > 0)
+        {
+            events[(size_t) scope.startIndex1] = event;
+            return true;
+        }
+
+        return false;
+    }
+
+    /** Consumer thread: calls handler for up to maxEvents pending events, returns how many were read. */
+    template <typename Handler>
+    int pop (int maxEvents, Handler&& handler)
+    {
+        const auto numReady = juce::jmin (maxEvents, fifo.getNumReady());
+        const auto scope = fifo.read (numReady);
+
+        for (int i = 0; i < scope.blockSize1; ++i)
+            handler (events[(size_t) (scope.startIndex1 + i)]);
+
+        for (int i = 0; i < scope.blockSize2; ++i)
+            handler (events[(size_t) (scope.startIndex2 + i)]);
+
+        return numReady;
+    }
+
+    /** Either thread: the number of events waiting to be read. */
+    int getNumReady() const noexcept    { return fifo.getNumReady(); }
+
+    static constexpr int capacity = fifoCapacity;
+
+private:
+    juce::AbstractFifo fifo { capacity };
+    std::array<EventType, capacity> events;
+
+    JUCE_DECLARE_NON_COPYABLE (EventFifo)
+};
+
+using TimingEventFifo = EventFifo<TimingEvent, 4096>;
@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    TimingGrid.h
+
+    The reference grid notes are measured against, and the deviation kernel
+    shared by the audio thread and the background re-analysis.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <cmath>
+#include "ReferenceGroove.h"
+
+//==============================================================================
+/** Describes the grid a note's timing is judged against. */
+struct GridSettings
+{
+    double stepPpq = 1.0;       // Grid spacing in quarter notes (1.0 = quarter notes)
+    double swing = 0.5;         // Position of every second step within a pair: 0.5 = straight
+    double latencyMs = 0.0;     // Fixed input latency removed from every note before measuring
+
+    // When set, notes are measured against the nearest note of this reference
+    // instead of the grid (stepPpq and swing are ignored). Owned by the processor.
+    const ReferenceGroove* reference = nullptr;
+
+    // When set, each note is measured against the subdivision the RhythmTranscriber
+    // decided for it. computeDeviationMs() can't know that, so it uses stepPpq.
+    bool inferred = false;
+
+    bool operator== (const GridSettings& other) const noexcept
+    {
+        return stepPpq == other.stepPpq && swing == other.swing && latencyMs == other.latencyMs
+            && reference == other.reference && inferred == other.inferred;
+    }
+
+    bool operator!= (const GridSettings& other) const noexcept   { return ! operator== (other); }
+
+    //==============================================================================
+    /** Names and step sizes for the grid choices offered to the user. "Reference"
+        measures against the loaded reference groove instead, "Auto" uses the
+        division and swing detected from the playing, and "Inferred" the
+        subdivision the rhythm decoder decided the player meant for each note.
+    */
+    static juce::StringArray getDivisionNames()    { return { "1/4", "1/8", "1/16", "1/8T", "1/16T", "Reference", "Auto", "Inferred" }; }
+
+    static constexpr int referenceDivision = 5;
+    static constexpr int autoDivision = 6;
+    static constexpr int inferredDivision = 7;
+
+    static double getDivisionStepPpq (int index) noexcept
+    {
+        constexpr double steps[] = { 1.0, 0.5, 0.25, 1.0 / 3.0, 1.0 / 6.0 };
+        return juce::isPositiveAndBelow (index, (int) std::size (steps)) ? steps[index] : 1.0;
+    }
+};
+
+//==============================================================================
+/**
+    Returns how far a note at notePpq lies from the nearest grid point (or
+    reference note), in ms (negative = early). Swing delays every second grid
+    step, so the grid is laid out in pairs of steps.
+
+    Never allocates, so it's safe to call from the audio thread.
+*/
+inline double computeDeviationMs (double notePpq, double bpm, const GridSettings& grid) noexcept
+{
+    const auto msPerQuarter = 60000.0 / bpm;
+    const auto ppq = notePpq - grid.latencyMs / msPerQuarter;
+
+    if (grid.reference != nullptr)
+        return (ppq - grid.reference->findNearestPpq (ppq)) * msPerQuarter;
+
+    const auto pairLength = grid.stepPpq * 2.0;
+    const auto pairStart = std::floor (ppq / pairLength) * pairLength;
+    const auto swungStep = pairStart + pairLength * grid.swing;
+
+    // The nearest grid point is either the start of this pair, its swung step or the next pair
+    auto nearest = pairStart;
+
+    if (std::abs (ppq - swungStep) < std::abs (ppq - nearest))
+        nearest = swungStep;
+
+    if (std::abs (ppq - (pairStart + pairLength)) < std::abs (ppq - nearest))
+        nearest = pairStart + pairLength;
+
+    return (ppq - nearest) * msPerQuarter;
+}
@@ -0,0 +1,258 @@
+/*
+  ==============================================================================
+
+    TraceRecorder.cpp
+
+  ==============================================================================
+*/
+
+#include "TraceRecorder.h"
+
+namespace
+{
+    std::atomic<juce::uint32> nextGeneration { 1 };
+}
+
+//==============================================================================
+TraceRecorder::TraceRecorder() = default;
+
+TraceRecorder::~TraceRecorder()
+{
+    stopTimer();
+}
+
+void TraceRecorder::start()
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+
+    tracing = false;
+
+    for (auto& buffer : buffers)
+        if (buffer == nullptr)
+            buffer = std::make_unique<ThreadBuffer>();
+
+    // Throw away whatever is left from the last trace
+    collect();
+    collected.clear();
+    numDropped = 0;
+
+    // Threads claim their slots afresh, so ones that have gone away since don't keep them
+    for (auto& buffer : buffers)
+        buffer->threadId = nullptr;
+
+    generation = nextGeneration++;
+
+    traceStartTicks = juce::Time::getHighResolutionTicks();
+    tracing.store (true, std::memory_order_release);
+    startTimerHz (20);
+}
+
+bool TraceRecorder::stop (const juce::File& file)
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+
+    tracing = false;
+    stopTimer();
+    collect();
+
+    if (! file.getParentDirectory().createDirectory())
+        return false;
+
+    juce::FileOutputStream out (file);
+
+    if (out.failedToOpen())
+        return false;
+
+    out.setPosition (0);
+    out.truncate();
+
+    const auto ticksPerMicrosecond = (double) juce::Time::getHighResolutionTicksPerSecond() / 1.0e6;
+    const auto messageThread = juce::MessageManager::getInstance()->getCurrentMessageThread();
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    // Name each thread after its longest scope (on a tie, the later one, which encloses the other)
+    std::array<const Event*, maxThreads> longest {};
+
+    for (const auto& e : collected)
+        if (auto*& l = longest[(size_t) e.thread]; l == nullptr || e.event.endTicks - e.event.startTicks >= l->endTicks - l->startTicks)
+            l = &e.event;
+
+    for (int t = 0; t < maxThreads; ++t)
+    {
+        const auto* buffer = buffers[(size_t) t].get();
+
+        if (buffer == nullptr || longest[(size_t) t] == nullptr)
+            continue;
+
+        const auto name = buffer->threadId.load() == messageThread ? juce::String ("Message thread")
+                                                                   : juce::String (longest[(size_t) t]->name) + " thread";
+
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t
+            << ",\"args\":{\"name\":" << juce::JSON::toString (name) << "}},\n";
+    }
+
+    for (const auto& e : collected)
+    {
+        out << "{\"name\":" << juce::JSON::toString (juce::String (e.event.name))
+            << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread
+            << ",\"ts\":" << juce::String ((double) (e.event.startTicks - traceStartTicks) / ticksPerMicrosecond, 3)
+            << ",\"dur\":" << juce::String ((double) (e.event.endTicks - e.event.startTicks) / ticksPerMicrosecond, 3)
+            << "},\n";
+    }
+
+    // Chrome doesn't accept a trailing comma, so finish with an event that's always valid
+    out << "{\"name\":\"dropped events\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":0,\"args\":{\"count\":"
+        << (int) numDropped.load() << "}}\n]}\n";
+
+    out.flush();
+    return out.getStatus().wasOk();
+}
+
+//==============================================================================
+void TraceRecorder::add (const char* name, juce::int64 startTicks, juce::int64 endTicks) noexcept
+{
+    if (! tracing.load (std::memory_order_acquire))
+        return;
+
+    auto* buffer = getThreadBuffer();
+
+    if (buffer == nullptr || ! buffer->events.push ({ name, startTicks, endTicks }))
+        ++numDropped;
+}
+
+TraceRecorder::ThreadBuffer* TraceRecorder::getThreadBuffer() noexcept
+{
+    // Remembers this thread's slot for the current trace, so most events skip the search
+    thread_local juce::uint32 cachedGeneration = 0;
+    thread_local ThreadBuffer* cachedBuffer = nullptr;
+
+    const auto currentGeneration = generation.load (std::memory_order_acquire);
+
+    if (cachedGeneration == currentGeneration)
+        return cachedBuffer;
+
+    const auto thisThread = juce::Thread::getCurrentThreadId();
+
+    for (auto& slot : buffers)
+    {
+        auto* buffer = slot.get();
+        auto owner = buffer->threadId.load();
+
+        if (owner == thisThread
+             || (owner == nullptr && buffer->threadId.compare_exchange_strong (owner, thisThread)))
+        {
+            cachedGeneration = currentGeneration;
+            cachedBuffer = buffer;
+            return buffer;
+        }
+    }
+
+    return nullptr;
+}
+
+//==============================================================================
+void TraceRecorder::timerCallback()
+{
+    collect();
+}
+
+void TraceRecorder::collect()
+{
+    for (int t = 0; t < maxThreads; ++t)
+    {
+        auto* buffer = buffers[(size_t) t].get();
+
+        if (buffer == nullptr)
+            continue;
+
+        buffer->events.pop (buffer->events.capacity, [&] (const Event& e)
+        {
+            if ((int) collected.size() < maxEvents)
+                collected.push_back ({ e, t });
+            else
+                ++numDropped;
+        });
+    }
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class TraceRecorderTests  : public juce::UnitTest
+{
+public:
+    TraceRecorderTests()  : juce::UnitTest ("TraceRecorder", "Pocket") {}
+
+    void runTest() override
+    {
+        TraceRecorder recorder;
+        const auto file = juce::File::createTempFile (".json");
+
+        // Each thread records one scope and ends, as audio threads do when a host restarts its device.
+        // They all live until every one has recorded, so none can reuse another's thread ID.
+        const auto recordOnNewThreads = [&recorder] (int numThreads)
+        {
+            std::atomic<int> numRecorded { 0 };
+            juce::WaitableEvent allRecorded (true);
+            std::vector<std::thread> threads;
+
+            for (int i = 0; i < numThreads; ++i)
+                threads.emplace_back ([&]
+                {
+                    {
+                        POCKET_TRACE_SCOPE (recorder, "short-lived thread");
+                    }
+
+                    if (++numRecorded == numThreads)
+                        allRecorded.signal();
+
+                    allRecorded.wait();
+                });
+
+            for (auto& thread : threads)
+                thread.join();
+        };
+
+        beginTest ("Threads beyond the slots are dropped, not blocked");
+        {
+            onMessageThread ([&] { recorder.start(); });
+            recordOnNewThreads (TraceRecorder::maxThreads + 4);
+            onMessageThread ([&] { expect (recorder.stop (file)); });
+
+            expectEquals (recorder.getNumEvents(), TraceRecorder::maxThreads);
+            expectEquals ((int) recorder.getNumDropped(), 4);
+        }
+
+        beginTest ("A new trace gives the slots of threads that have gone back");
+        {
+            onMessageThread ([&] { recorder.start(); });
+            recordOnNewThreads (TraceRecorder::maxThreads);
+            onMessageThread ([&] { expect (recorder.stop (file)); });
+
+            expectEquals (recorder.getNumEvents(), TraceRecorder::maxThreads);
+            expectEquals ((int) recorder.getNumDropped(), 0);
+        }
+
+        file.deleteFile();
+    }
+
+private:
+    // start() and stop() belong to the message thread, which may be the one running the tests
+    static void onMessageThread (std::function<void()> function)
+    {
+        if (juce::MessageManager::getInstance()->isThisTheMessageThread())
+        {
+            function();
+            return;
+        }
+
+        juce::WaitableEvent done;
+        juce::MessageManager::callAsync ([&] { function(); done.signal(); });
+        done.wait();
+    }
+};
+
+static TraceRecorderTests traceRecorderTests;
+
+#endif
@@ -0,0 +1,134 @@
+/*
+  ==============================================================================
+
+    TraceRecorder.h
+
+    Records what the audio, analysis and message threads were doing, for
+    viewing as a timeline in Perfetto or chrome://tracing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+#include "TimingEvent.h"
+
+// Set to 0 to compile the trace scopes out as well as the block timing (see BlockProfiler.h)
+#ifndef POCKET_ENABLE_PROFILING
+ #define POCKET_ENABLE_PROFILING 1
+#endif
+
+//==============================================================================
+/**
+    Collects timed scopes from every thread while a trace is running, and writes
+    them as a Chrome trace-event JSON file.
+
+    Each thread that records gets its own single-producer FIFO, claimed on its
+    first event from a fixed set of slots, so recording never locks or allocates
+    and threads never contend. Every start() gives the slots back, so threads that
+    have gone away (or hosts that recreate their audio threads) don't keep them
+    from the threads of later traces. A timer on the message thread moves the events
+    into one list as they arrive; stop() writes that list out. When tracing is
+    off, a scope costs a single relaxed load.
+
+    There is one recorder per process, shared by every instance, so the trace
+    shows how all of them interleave. Share it with
+    juce::SharedResourcePointer<TraceRecorder>, and record with POCKET_TRACE_SCOPE.
+    Names must be string literals (or otherwise outlive the recorder).
+*/
+class TraceRecorder  : private juce::Timer
+{
+public:
+    TraceRecorder();
+    ~TraceRecorder() override;
+
+    /** Message thread: discards anything recorded earlier and starts collecting. */
+    void start();
+
+    /** Message thread: stops collecting and writes the trace to a file. */
+    bool stop (const juce::File& file);
+
+    bool isTracing() const noexcept             { return tracing.load (std::memory_order_relaxed); }
+
+    /** Message thread: events collected since start(). */
+    int getNumEvents() const noexcept           { return (int) collected.size(); }
+
+    /** Events lost because a FIFO filled up, a thread had no free slot, or the trace was full. */
+    juce::uint32 getNumDropped() const noexcept { return numDropped.load(); }
+
+    //==============================================================================
+    /** Any thread: records one scope, timed with Time::getHighResolutionTicks(). */
+    void add (const char* name, juce::int64 startTicks, juce::int64 endTicks) noexcept;
+
+    /** Times the enclosing scope. Use POCKET_TRACE_SCOPE rather than creating one
+        directly, so it disappears when profiling is compiled out.
+    */
+    struct Scope
+    {
+        Scope (TraceRecorder& r, const char* n, bool condition = true) noexcept
+            : recorder (condition && r.isTracing() ? &r : nullptr),
+              name (n),
+              start (recorder != nullptr ? juce::Time::getHighResolutionTicks() : 0) {}
+
+        ~Scope() noexcept
+        {
+            if (recorder != nullptr)
+                recorder->add (name, start, juce::Time::getHighResolutionTicks());
+        }
+
+        TraceRecorder* const recorder;
+        const char* const name;
+        const juce::int64 start;
+
+        JUCE_DECLARE_NON_COPYABLE (Scope)
+    };
+
+    static constexpr int maxThreads = 16;
+    static constexpr int maxEvents = 1 << 20;     // About 24 MB of trace
+
+private:
+    struct Event
+    {
+        const char* name = nullptr;
+        juce::int64 startTicks = 0, endTicks = 0;
+    };
+
+    struct ThreadBuffer
+    {
+        std::atomic<juce::Thread::ThreadID> threadId { nullptr };
+        EventFifo<Event, 8192> events;
+    };
+
+    struct CollectedEvent
+    {
+        Event event;
+        int thread = 0;
+    };
+
+    void timerCallback() override;
+    ThreadBuffer* getThreadBuffer() noexcept;
+    void collect();
+
+    // Only created once the first trace starts, and kept until the recorder goes away
+    std::array<std::unique_ptr<ThreadBuffer>, maxThreads> buffers;
+
+    // Changes with every start(), and is unique across recorders, so threads know when their cached slot is stale
+    std::atomic<juce::uint32> generation { 0 };
+    std::atomic<bool> tracing { false };
+    std::atomic<juce::uint32> numDropped { 0 };
+
+    std::vector<CollectedEvent> collected;
+    juce::int64 traceStartTicks = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TraceRecorder)
+};
+
+#if POCKET_ENABLE_PROFILING
+ #define POCKET_TRACE_SCOPE(recorder, ...) \
+    const TraceRecorder::Scope JUCE_JOIN_MACRO (traceScope, __LINE__) (recorder, __VA_ARGS__)
+#else
+ #define POCKET_TRACE_SCOPE(recorder, ...)
+#endif